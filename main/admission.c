@@ -0,0 +1,154 @@
+/*
+ * admission.c
+ *
+ * Per-address and global handshake rate limits.
+ *
+ * Each limit keeps a theoretical arrival time (TAT): the time at which
+ * the limit is back to a full burst. A handshake is admitted while the
+ * TAT is less than (burst - 1) intervals ahead of now, and each admitted
+ * handshake moves it one interval further. Times are kept in milliseconds
+ * since boot as uint32_t and compared by signed difference, so wrap-around
+ * after 49 days is harmless.
+ *
+ * Thread safety: None. All functions must be called from the same thread.
+ */
+
+#include "admission.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include <arpa/inet.h>     // inet_ntoa_r()
+#include "sdkconfig.h"
+
+static admission_stats_t stats;
+
+#if CONFIG_HANDSHAKE_SOURCE_BURST > 0 || CONFIG_HANDSHAKE_GLOBAL_BURST > 0
+
+static const char *TAG = "Admission";
+
+/* -------------- Token buckets -------------- */
+
+/**
+ * @brief Check whether a limit allows one more handshake
+ */
+static bool limit_allows(uint32_t tat_ms, uint32_t now_ms, uint32_t burst, uint32_t interval_ms)
+{
+    return (int32_t)(tat_ms - now_ms) <= (int32_t)((burst - 1) * interval_ms);
+}
+
+/**
+ * @brief Return the TAT after charging one handshake
+ */
+static uint32_t limit_charge(uint32_t tat_ms, uint32_t now_ms, uint32_t interval_ms)
+{
+    if ((int32_t)(tat_ms - now_ms) < 0) {
+        tat_ms = now_ms;
+    }
+    return tat_ms + interval_ms;
+}
+
+/* -------------- Client addresses -------------- */
+
+#if CONFIG_HANDSHAKE_SOURCE_BURST > 0
+
+/**
+ * @brief Recent client address
+ */
+typedef struct {
+    uint32_t addr;                 // IPv4 address, network byte order (0 if free)
+    uint32_t tat_ms;               // Back to a full burst at this time
+    bool refused;                  // Refusal already logged
+} source_t;
+
+static source_t sources[CONFIG_HANDSHAKE_SOURCES];
+
+/**
+ * @brief Find the entry of an address, or the one to reuse for it
+ *
+ * The entry to reuse is a free one or else the one that has been quiet
+ * longest. If that one is still limited, its address gets a fresh burst
+ * next time; the global limit still holds.
+ */
+static source_t *source_lookup(uint32_t addr)
+{
+    source_t *victim = NULL;
+    for (int i = 0; i < CONFIG_HANDSHAKE_SOURCES; i++) {
+        source_t *s = &sources[i];
+        if (s->addr == addr) {
+            return s;
+        }
+        if (!victim || (victim->addr != 0 &&
+                        (s->addr == 0 || (int32_t)(s->tat_ms - victim->tat_ms) < 0))) {
+            victim = s;
+        }
+    }
+    return victim;
+}
+
+#endif /* CONFIG_HANDSHAKE_SOURCE_BURST > 0 */
+
+/* -------------- Global limit -------------- */
+
+#if CONFIG_HANDSHAKE_GLOBAL_BURST > 0
+static uint32_t global_tat_ms;
+static bool global_refused;        // Refusal already logged
+#endif
+
+#endif /* any limit */
+
+/* -------------- Public API -------------- */
+
+bool admission_check(uint32_t addr)
+{
+#if CONFIG_HANDSHAKE_SOURCE_BURST > 0 || CONFIG_HANDSHAKE_GLOBAL_BURST > 0
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+#endif
+
+#if CONFIG_HANDSHAKE_SOURCE_BURST > 0
+    source_t *src = source_lookup(addr);
+    bool known = src->addr == addr;
+    if (known && !limit_allows(src->tat_ms, now_ms, CONFIG_HANDSHAKE_SOURCE_BURST,
+                               CONFIG_HANDSHAKE_SOURCE_INTERVAL_MS)) {
+        stats.refused_source++;
+        if (!src->refused) {
+            src->refused = true;
+            char ip[16];
+            struct in_addr in = { .s_addr = addr };
+            inet_ntoa_r(in, ip, sizeof(ip));
+            ESP_LOGW(TAG, "Too many handshakes from %s, resetting its connections", ip);
+        }
+        return false;
+    }
+#endif
+
+#if CONFIG_HANDSHAKE_GLOBAL_BURST > 0
+    if (!limit_allows(global_tat_ms, now_ms, CONFIG_HANDSHAKE_GLOBAL_BURST,
+                      CONFIG_HANDSHAKE_GLOBAL_INTERVAL_MS)) {
+        stats.refused_global++;
+        if (!global_refused) {
+            global_refused = true;
+            ESP_LOGW(TAG, "Handshake rate limit reached, resetting new connections");
+        }
+        return false;
+    }
+    global_refused = false;
+    global_tat_ms = limit_charge(global_tat_ms, now_ms, CONFIG_HANDSHAKE_GLOBAL_INTERVAL_MS);
+#endif
+
+#if CONFIG_HANDSHAKE_SOURCE_BURST > 0
+    if (!known) {
+        src->addr = addr;
+        src->tat_ms = now_ms;
+    }
+    src->refused = false;
+    src->tat_ms = limit_charge(src->tat_ms, now_ms, CONFIG_HANDSHAKE_SOURCE_INTERVAL_MS);
+#endif
+
+    stats.admitted++;
+    return true;
+}
+
+void admission_get_stats(admission_stats_t *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file admission.h
+ * @brief Handshake admission control
+ *
+ * Handshakes run in the main loop and cost CPU time and heap, so a port
+ * scan or a client reconnecting in a tight loop would keep every bridge
+ * from forwarding. Before a transport with a handshake takes over an
+ * accepted socket, the client address is checked against a per-address
+ * and a global rate limit; refused sockets are reset before any TLS state
+ * is allocated.
+ *
+ * Both limits are token buckets (kept as theoretical arrival times): a
+ * burst of handshakes is allowed at once, then one more per interval.
+ * Handshakes run one at a time in the main loop, so at most one is ever
+ * in progress and its duration is bounded by CONFIG_HANDSHAKE_TIMEOUT_MS.
+ *
+ * Thread safety: None. All functions must be called from the same thread.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Handshake admission counters
+ */
+typedef struct {
+    uint32_t admitted;             // Handshakes allowed to start
+    uint32_t refused_source;       // Refused by the per-address limit
+    uint32_t refused_global;       // Refused by the global limit
+} admission_stats_t;
+
+/**
+ * @brief Decide whether a client may start a handshake now
+ *
+ * Charges both limits if the handshake is admitted.
+ *
+ * @param addr Client IPv4 address, network byte order
+ * @return true to go ahead, false to reset the connection
+ */
+bool admission_check(uint32_t addr);
+
+/**
+ * @brief Get the admission counters for the diagnostics report
+ */
+void admission_get_stats(admission_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
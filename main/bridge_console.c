@@ -0,0 +1,357 @@
+/*
+ * bridge_console.c
+ *
+ * `bridge` console command for runtime bridge configuration, and `diag`
+ * for the diagnostics report.
+ *
+ * Thread safety: the command handlers run in the REPL task and only read
+ * bridge state for listing and the boot timeline, which is fixed once
+ * startup completes. Changes and full reports are posted to a queue and
+ * handled by bridge_console_poll() in the main loop, which reports the
+ * result back to the waiting REPL task.
+ */
+
+#include "bridge_console.h"
+#include "uart_manager.h"
+#include "tcp_server.h"
+#include "diagnostics.h"
+#include "driver/uart.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "BridgeConsole";
+
+#if defined(CONFIG_BRIDGE_CONSOLE)
+
+#include "esp_console.h"
+
+/** How long the REPL waits for the main loop to apply a request */
+#define REQUEST_TIMEOUT_MS 5000
+
+/**
+ * @brief Console requests applied by the main loop
+ */
+typedef enum {
+    REQ_SET,     // Apply cfg
+    REQ_SAVE,    // Save current settings to NVS
+    REQ_RESET,   // Apply Kconfig defaults and erase saved settings
+    REQ_REPORT,  // Log the full diagnostics report
+} request_type_t;
+
+typedef struct {
+    request_type_t type;
+    int bridge_idx;
+    uart_bridge_config_t cfg;    // REQ_SET only
+    TaskHandle_t waiter;         // REPL task to notify when done
+} console_request_t;
+
+static QueueHandle_t request_queue;
+
+/** Result of the last request, written by the main loop before notifying */
+static volatile esp_err_t request_result;
+
+/**
+ * Names of the hardware flow control modes, indexed by uart_hw_flowcontrol_t.
+ */
+static const char *const flow_names[] = {
+    [UART_HW_FLOWCTRL_DISABLE] = "none",
+    [UART_HW_FLOWCTRL_RTS]     = "rts",
+    [UART_HW_FLOWCTRL_CTS]     = "cts",
+    [UART_HW_FLOWCTRL_CTS_RTS] = "rtscts",
+};
+
+/**
+ * @brief Parse a complete decimal integer
+ *
+ * @return true if all of str is a number
+ */
+static bool parse_int(const char *str, int *out) {
+    char *end;
+    long value = strtol(str, &end, 10);
+    if (*str == '\0' || *end != '\0') {
+        return false;
+    }
+    *out = (int)value;
+    return true;
+}
+
+/**
+ * @brief Apply one key=value argument to a settings struct
+ *
+ * @return true if the key is known and the value parses
+ */
+static bool apply_setting(uart_bridge_config_t *cfg, const char *arg) {
+    const char *eq = strchr(arg, '=');
+    if (!eq) {
+        return false;
+    }
+    size_t key_len = eq - arg;
+    const char *val = eq + 1;
+    int n;
+
+#define KEY_IS(name) (key_len == strlen(name) && strncmp(arg, name, key_len) == 0)
+
+    if (KEY_IS("flow")) {
+        for (int i = 0; i < (int)(sizeof(flow_names) / sizeof(flow_names[0])); i++) {
+            if (strcasecmp(val, flow_names[i]) == 0) {
+                cfg->flow_ctrl = i;
+                return true;
+            }
+        }
+        return false;
+    }
+    if (!parse_int(val, &n)) {
+        return false;
+    }
+
+    if (KEY_IS("enabled"))        cfg->enabled = n != 0;
+    else if (KEY_IS("tx"))        cfg->tx_pin = n;
+    else if (KEY_IS("rx"))        cfg->rx_pin = n;
+    else if (KEY_IS("rts"))       cfg->rts_pin = n;
+    else if (KEY_IS("cts"))       cfg->cts_pin = n;
+    else if (KEY_IS("dtr"))       cfg->dtr_pin = n;
+    else if (KEY_IS("baud"))      cfg->baud_rate = n;
+    else if (KEY_IS("port"))      cfg->tcp_port = n;
+    else if (KEY_IS("rtsthresh")) cfg->rx_flow_thresh = n;
+    else if (KEY_IS("xonxoff"))   cfg->sw_flow = n != 0;
+    else if (KEY_IS("dma"))       cfg->dma_mode = n != 0;
+    else if (KEY_IS("rfc2217"))   cfg->rfc2217 = n != 0;
+    else if (KEY_IS("tls"))       cfg->tls = n != 0;
+    else if (KEY_IS("noise"))     cfg->noise = n != 0;
+    else if (KEY_IS("rxfifo"))    cfg->fifo.rxfifo_full_thresh = n;
+    else if (KEY_IS("rxtimeout")) cfg->fifo.rx_timeout = n;
+    else if (KEY_IS("txfifo"))    cfg->fifo.txfifo_empty_thresh = n;
+    else if (KEY_IS("char_us"))   cfg->pacing.char_delay_us = n;
+    else if (KEY_IS("line_ms"))   cfg->pacing.line_delay_us = n * 1000;
+    else if (KEY_IS("block"))     cfg->pacing.block_size = n;
+    else if (KEY_IS("block_ms"))  cfg->pacing.block_delay_us = n * 1000;
+    else return false;
+
+#undef KEY_IS
+    return true;
+}
+
+/**
+ * @brief Print one line per bridge
+ */
+static void list_bridges(void) {
+    uart_bridge_t *bridges = uart_manager_get_instances();
+
+    for (int i = 0; i < CONFIG_AVAILABLE_BRIDGE_UARTS; i++) {
+        uart_bridge_config_t cfg;
+        uart_manager_get_config(i, &cfg);
+        const char *state = !cfg.enabled ? "off" :
+                            !bridges[i].enabled ? "failed" :
+                            bridges[i].conn ? "connected" : "listening";
+
+        printf("UART%d %-9s tx=%d rx=%d rts=%d cts=%d dtr=%d baud=%d port=%d flow=%s"
+               " xonxoff=%d dma=%d rfc2217=%d tls=%d noise=%d rxfifo=%d rxtimeout=%d txfifo=%d"
+               " char_us=%lu line_ms=%lu block=%lu block_ms=%lu\n",
+               i + 1, state, cfg.tx_pin, cfg.rx_pin, cfg.rts_pin, cfg.cts_pin,
+               cfg.dtr_pin, cfg.baud_rate, cfg.tcp_port, flow_names[cfg.flow_ctrl & 3],
+               cfg.sw_flow, cfg.dma_mode, cfg.rfc2217, cfg.tls, cfg.noise,
+               cfg.fifo.rxfifo_full_thresh, cfg.fifo.rx_timeout, cfg.fifo.txfifo_empty_thresh,
+               (unsigned long)cfg.pacing.char_delay_us,
+               (unsigned long)(cfg.pacing.line_delay_us / 1000),
+               (unsigned long)cfg.pacing.block_size,
+               (unsigned long)(cfg.pacing.block_delay_us / 1000));
+    }
+}
+
+/**
+ * @brief Hand a request to the main loop and wait for its result
+ */
+static esp_err_t submit(console_request_t *req) {
+    req->waiter = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, 0);  // Drop a late reply to an earlier request
+
+    if (xQueueSend(request_queue, req, pdMS_TO_TICKS(REQUEST_TIMEOUT_MS)) != pdTRUE ||
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(REQUEST_TIMEOUT_MS)) == 0) {
+        return ESP_ERR_TIMEOUT;
+    }
+    return request_result;
+}
+
+/**
+ * @brief `bridge` command handler (REPL task)
+ */
+static int cmd_bridge(int argc, char **argv) {
+    if (argc == 1) {
+        list_bridges();
+        return 0;
+    }
+
+    int uart_num;
+    if (!parse_int(argv[1], &uart_num) || uart_num < 1 || uart_num > CONFIG_AVAILABLE_BRIDGE_UARTS) {
+        printf("Bridge must be 1..%d (UART number)\n", CONFIG_AVAILABLE_BRIDGE_UARTS);
+        return 1;
+    }
+    if (argc == 2) {
+        printf("Nothing to do; see 'help bridge'\n");
+        return 1;
+    }
+
+    console_request_t req = { .bridge_idx = uart_num - 1 };
+    if (argc == 3 && strcmp(argv[2], "save") == 0) {
+        req.type = REQ_SAVE;
+    } else if (argc == 3 && strcmp(argv[2], "reset") == 0) {
+        req.type = REQ_RESET;
+    } else {
+        req.type = REQ_SET;
+        uart_manager_get_config(req.bridge_idx, &req.cfg);
+        for (int i = 2; i < argc; i++) {
+            if (!apply_setting(&req.cfg, argv[i])) {
+                printf("Invalid setting '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+    }
+
+    esp_err_t ret = submit(&req);
+    if (ret != ESP_OK) {
+        printf("UART%d: %s\n", uart_num, esp_err_to_name(ret));
+        return 1;
+    }
+    printf("UART%d: OK%s\n", uart_num, req.type == REQ_SET ? " (not saved)" : "");
+    return 0;
+}
+
+/**
+ * @brief `diag` command handler (REPL task)
+ */
+static int cmd_diag(int argc, char **argv) {
+    if (argc == 2 && strcmp(argv[1], "boot") == 0) {
+        diag_boot_report();
+        return 0;
+    }
+    if (argc != 1) {
+        printf("Usage: diag [boot]\n");
+        return 1;
+    }
+
+    // The counters belong to the main loop, so it logs the report
+    console_request_t req = { .type = REQ_REPORT };
+    esp_err_t ret = submit(&req);
+    if (ret != ESP_OK) {
+        printf("diag: %s\n", esp_err_to_name(ret));
+        return 1;
+    }
+    return 0;
+}
+
+esp_err_t bridge_console_init(void) {
+    request_queue = xQueueCreate(1, sizeof(console_request_t));
+    if (!request_queue) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_console_repl_t *repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = "bridge>";
+    esp_err_t ret;
+
+#if defined(CONFIG_ESP_CONSOLE_UART_DEFAULT) || defined(CONFIG_ESP_CONSOLE_UART_CUSTOM)
+    esp_console_dev_uart_config_t hw_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    ret = esp_console_new_repl_uart(&hw_config, &repl_config, &repl);
+#elif defined(CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG)
+    esp_console_dev_usb_serial_jtag_config_t hw_config = ESP_CONSOLE_DEV_USB_SERIAL_JTAG_CONFIG_DEFAULT();
+    ret = esp_console_new_repl_usb_serial_jtag(&hw_config, &repl_config, &repl);
+#elif defined(CONFIG_ESP_CONSOLE_USB_CDC)
+    esp_console_dev_usb_cdc_config_t hw_config = ESP_CONSOLE_DEV_CDC_CONFIG_DEFAULT();
+    ret = esp_console_new_repl_usb_cdc(&hw_config, &repl_config, &repl);
+#else
+    ret = ESP_ERR_NOT_SUPPORTED;
+#endif
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    const esp_console_cmd_t cmd = {
+        .command = "bridge",
+        .help = "List bridges, or change, save or reset one bridge's settings.\n"
+                "  bridge                    list all bridges\n"
+                "  bridge <n> key=value ...  change UARTn and restart it\n"
+                "  bridge <n> save           save UARTn's settings to NVS\n"
+                "  bridge <n> reset          restore UARTn's Kconfig defaults\n"
+                "Keys: enabled tx rx rts cts dtr baud port flow(none|rts|cts|rtscts)\n"
+                "  rtsthresh xonxoff dma rfc2217 tls noise rxfifo rxtimeout txfifo\n"
+                "  char_us line_ms block block_ms",
+        .hint = "[<n> key=value...|save|reset]",
+        .func = cmd_bridge,
+    };
+    ret = esp_console_cmd_register(&cmd);
+    if (ret == ESP_OK) {
+        const esp_console_cmd_t diag_cmd = {
+            .command = "diag",
+            .help = "Log the diagnostics report.\n"
+                    "  diag        full report (boot timeline, UART, load, stalls...)\n"
+                    "  diag boot   boot timeline only",
+            .hint = "[boot]",
+            .func = cmd_diag,
+        };
+        ret = esp_console_cmd_register(&diag_cmd);
+    }
+    if (ret == ESP_OK) {
+        esp_console_register_help_command();
+        ret = esp_console_start_repl(repl);
+    }
+    return ret;
+}
+
+void bridge_console_poll(void) {
+    console_request_t req;
+    if (!request_queue || xQueueReceive(request_queue, &req, 0) != pdTRUE) {
+        return;
+    }
+
+    esp_err_t ret;
+    switch (req.type) {
+        case REQ_SET:
+            ret = tcp_reconfigure_bridge(req.bridge_idx, &req.cfg);
+            break;
+        case REQ_SAVE:
+            ret = uart_manager_save_config(req.bridge_idx);
+            break;
+        case REQ_RESET:
+            ret = uart_manager_get_default_config(req.bridge_idx, &req.cfg);
+            if (ret == ESP_OK) {
+                ret = tcp_reconfigure_bridge(req.bridge_idx, &req.cfg);
+            }
+            if (ret == ESP_OK) {
+                ret = uart_manager_erase_config(req.bridge_idx);
+            }
+            break;
+        case REQ_REPORT:
+            diag_report();
+            ret = ESP_OK;
+            break;
+        default:
+            ret = ESP_ERR_INVALID_ARG;
+            break;
+    }
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "UART%d request failed: %s", req.bridge_idx + 1, esp_err_to_name(ret));
+    }
+    request_result = ret;
+    xTaskNotifyGive(req.waiter);
+}
+
+#else /* !CONFIG_BRIDGE_CONSOLE */
+
+esp_err_t bridge_console_init(void) {
+    ESP_LOGE(TAG, "Bridge console is not enabled in this build");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void bridge_console_poll(void) {
+}
+
+#endif /* CONFIG_BRIDGE_CONSOLE */
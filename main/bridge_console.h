@@ -0,0 +1,39 @@
+/**
+ * @file bridge_console.h
+ * @brief Interactive bridge configuration on the debug console
+ *
+ * Adds a `bridge` command to an esp_console REPL on the debug console
+ * (UART0 or USB), to list the bridges and change, save or reset their
+ * settings without reflashing:
+ *
+ *   bridge                       list all bridges
+ *   bridge <n> key=value ...     change UARTn's settings and restart it
+ *   bridge <n> save              save UARTn's current settings to NVS
+ *   bridge <n> reset             restore UARTn's Kconfig defaults
+ *
+ * A `diag` command logs the diagnostics report on demand, or with
+ * `diag boot` only the boot timeline.
+ *
+ * The REPL runs in its own task. Changes are handed to the main loop,
+ * which applies them between forwarding passes with
+ * tcp_reconfigure_bridge(), so only the affected bridge restarts.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+
+/**
+ * @brief Start the console REPL and register the bridge and diag commands
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t bridge_console_init(void);
+
+/**
+ * @brief Apply a pending console request
+ *
+ * Must be called regularly from the main loop. Returns immediately when
+ * nothing is pending.
+ */
+void bridge_console_poll(void);
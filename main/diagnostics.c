@@ -0,0 +1,834 @@
+/*
+ * diagnostics.c
+ *
+ * Collects timing and counter data from the bridge components and
+ * reports it on the debug console.
+ *
+ * Thread safety: Boot phase markers may be called from the WiFi event
+ * task. The stall watchdog timer only reads the in-flight operation.
+ * The heap allocation hook may run in any task but only records
+ * allocations made by the main loop while a forwarding pass is armed.
+ * The flash write test task only updates its own counters. All other
+ * functions must be called from the main loop.
+ */
+
+#include "diagnostics.h"
+#include "uart_manager.h"
+#include "uart_tap.h"
+#include "tls_server.h"
+#include "noise_server.h"
+#include "admission.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+#include <stdlib.h>
+#if CONFIG_IDF_TARGET_ARCH_XTENSA
+#include "esp_debug_helpers.h"
+#endif
+#include <inttypes.h>
+#include <string.h>
+
+static const char *TAG = "Diagnostics";
+
+/**
+ * Human readable names for each boot phase, indexed by diag_boot_phase_t.
+ */
+static const char *const boot_phase_names[DIAG_BOOT_PHASE_MAX] = {
+    [DIAG_BOOT_NVS_INIT]     = "nvs_init",
+    [DIAG_BOOT_WIFI_INIT]    = "wifi_init",
+    [DIAG_BOOT_WIFI_ASSOC]   = "wifi_assoc",
+    [DIAG_BOOT_WIFI_DHCP]    = "wifi_dhcp",
+    [DIAG_BOOT_SPIFFS_MOUNT] = "spiffs_mount",
+    [DIAG_BOOT_LOAD_CERT]    = "load_cert",
+    [DIAG_BOOT_LOAD_KEY]     = "load_key",
+    [DIAG_BOOT_LOAD_CA]      = "load_ca",
+    [DIAG_BOOT_UART_INIT]    = "uart_init",
+    [DIAG_BOOT_TCP_INIT]     = "tcp_init",
+};
+
+/**
+ * Recorded boot timeline. Entries stay zero for phases that are
+ * not part of this build (e.g. certificate loading without TLS).
+ */
+static diag_boot_entry_t boot_timeline[DIAG_BOOT_PHASE_MAX];
+
+/**
+ * Time of the last periodic report, in microseconds since start.
+ */
+static int64_t last_report_us = 0;
+
+/**
+ * Throughput and CPU load sample taken at the previous report.
+ */
+static struct {
+    int64_t time_us;          // When the sample was taken (0 = none yet)
+    uint64_t bytes;           // Total UART rx + tx bytes over all bridges
+    uint32_t idle_time;       // Idle task run time on the main loop's core
+} load_sample;
+
+#if defined(CONFIG_SSCTE_TLS_ENABLE)
+/**
+ * TLS record counters at the previous report.
+ */
+static struct {
+    int64_t time_us;          // When the sample was taken (0 = none yet)
+    tls_record_stats_t stats; // Totals over all sessions
+} tls_sample;
+#endif
+
+/**
+ * Longest gap between the starts of two main loop iterations since the
+ * previous report. Received data can wait in the UART driver this long
+ * before it is forwarded.
+ */
+static struct {
+    int64_t prev_start_us;    // Start of the previous iteration (0 = none yet)
+    int64_t worst_gap_us;
+} loop_gap;
+
+#if CONFIG_DIAG_FLASH_WRITE_TEST
+/** Size of the blob rewritten by the flash write test */
+#define DIAG_FLASH_BLOB_SIZE 4000
+
+/**
+ * Flash write test results. Written by the test task, read by reports.
+ */
+static struct {
+    TaskHandle_t task;
+    volatile uint32_t writes;        // Completed writes since start
+    volatile uint32_t failures;      // Failed writes since start
+    volatile int64_t worst_us;       // Longest write since start
+    uint32_t fifo_overflow_base;     // FIFO overflows counted before the test
+} flash_test;
+#endif
+
+/**
+ * Human readable names for each main loop operation, indexed by diag_op_t.
+ */
+static const char *const op_names[DIAG_OP_MAX] = {
+    [DIAG_OP_NONE]       = "loop",
+    [DIAG_OP_ACCEPT]     = "accept",
+    [DIAG_OP_HANDSHAKE]  = "handshake",
+    [DIAG_OP_TCP_READ]   = "tcp_read",
+    [DIAG_OP_TCP_WRITE]  = "tcp_write",
+    [DIAG_OP_UART_READ]  = "uart_read",
+    [DIAG_OP_UART_WRITE] = "uart_write",
+};
+
+/**
+ * Operation currently in flight on the main loop. Written by the main
+ * loop and read by the watchdog timer, hence volatile.
+ */
+static volatile struct {
+    int64_t start_us;         // 0 when no operation is in flight
+    int uart_port;
+    diag_op_t op;
+    bool warned;              // Watchdog already warned about this operation
+} inflight;
+
+/**
+ * Slowest operation seen during the current loop iteration, used to
+ * attribute loop-level overruns.
+ */
+static struct {
+    int64_t start_us;
+    int64_t worst_us;
+    int uart_port;
+    diag_op_t op;
+    bool recorded;            // A stall was already recorded for this iteration
+} loop_state;
+
+/**
+ * Ring of the most recent stalls.
+ */
+static diag_stall_t stall_ring[CONFIG_DIAG_STALL_RING_SIZE];
+static size_t stall_head = 0;     // Next slot to write
+static size_t stall_count = 0;    // Number of valid entries
+static uint32_t stall_total = 0;  // Stalls recorded since boot
+
+static esp_timer_handle_t stall_timer = NULL;
+
+#if CONFIG_DIAG_ALLOC_CHECK
+/** Number of steady-state allocations kept for the report */
+#define DIAG_ALLOC_RING_SIZE 8
+
+/** Frames to skip in the allocation hook (hook + heap_caps internals + malloc) */
+#define DIAG_ALLOC_SKIP_FRAMES 4
+
+/**
+ * Steady-state allocation tracking. The armed flag and task handle are
+ * read by the heap hook, which can run in any task.
+ */
+static struct {
+    volatile bool armed;      // Forwarding pass in progress after warm-up
+    TaskHandle_t task;        // Task running the forwarding pass
+    int uart_port;            // Bridge being forwarded
+    uint32_t warmup;          // Forwarding passes since the last reset
+    uint32_t total;           // Allocations recorded since boot
+    uint32_t reported;        // Allocations already logged
+    size_t head;              // Next ring slot to write
+} alloc_state;
+
+static diag_alloc_t alloc_ring[DIAG_ALLOC_RING_SIZE];
+#endif
+
+void diag_boot_begin(diag_boot_phase_t phase) {
+    if (phase >= DIAG_BOOT_PHASE_MAX || boot_timeline[phase].start_us != 0) {
+        return;
+    }
+    boot_timeline[phase].start_us = esp_timer_get_time();
+}
+
+void diag_boot_end(diag_boot_phase_t phase) {
+    if (phase >= DIAG_BOOT_PHASE_MAX || boot_timeline[phase].start_us == 0 ||
+        boot_timeline[phase].end_us != 0) {
+        return;
+    }
+    boot_timeline[phase].end_us = esp_timer_get_time();
+}
+
+const diag_boot_entry_t* diag_get_boot_timeline(void) {
+    return boot_timeline;
+}
+
+void diag_boot_report(void) {
+    int64_t slowest_us = 0;
+    int slowest = -1;
+
+    ESP_LOGI(TAG, "Boot timeline (us since start):");
+    for (int i = 0; i < DIAG_BOOT_PHASE_MAX; i++) {
+        const diag_boot_entry_t *e = &boot_timeline[i];
+        if (e->start_us == 0) {
+            continue;
+        }
+
+        if (e->end_us == 0) {
+            ESP_LOGI(TAG, "  %-12s start %10" PRId64 "  (not completed)",
+                     boot_phase_names[i], e->start_us);
+            continue;
+        }
+
+        int64_t duration = e->end_us - e->start_us;
+        ESP_LOGI(TAG, "  %-12s start %10" PRId64 "  took %10" PRId64,
+                 boot_phase_names[i], e->start_us, duration);
+
+        if (duration > slowest_us) {
+            slowest_us = duration;
+            slowest = i;
+        }
+    }
+
+    if (slowest >= 0) {
+        ESP_LOGI(TAG, "Slowest boot phase: %s (%" PRId64 " us)",
+                 boot_phase_names[slowest], slowest_us);
+    }
+}
+
+/* -------------- Stall Detection -------------- */
+
+const char* diag_op_name(diag_op_t op) {
+    return (op < DIAG_OP_MAX) ? op_names[op] : "unknown";
+}
+
+/**
+ * @brief Capture the call chain of the current task
+ *
+ * On Xtensa targets the frame walker is used to collect several levels,
+ * starting skip_frames above this function. Other architectures have no
+ * frame walker without frame pointers, so only the given caller is kept.
+ *
+ * @param out Array of DIAG_STALL_BACKTRACE_DEPTH entries to fill
+ * @param skip_frames Number of frames above this function to skip
+ * @param caller Return address to record on architectures without a frame walker
+ */
+static void __attribute__((noinline)) capture_backtrace(uint32_t *out, int skip_frames, uint32_t caller) {
+    memset(out, 0, DIAG_STALL_BACKTRACE_DEPTH * sizeof(uint32_t));
+
+#if CONFIG_IDF_TARGET_ARCH_XTENSA
+    esp_backtrace_frame_t frame;
+    esp_backtrace_get_start(&frame.pc, &frame.sp, &frame.next_pc);
+
+    (void)caller;
+
+    for (int skip = 0; skip < skip_frames; skip++) {
+        if (!esp_backtrace_get_next_frame(&frame)) {
+            return;
+        }
+    }
+
+    for (int i = 0; i < DIAG_STALL_BACKTRACE_DEPTH; i++) {
+        // Strip the windowed-ABI call size bits and point at the call instruction
+        uint32_t pc = frame.pc;
+        if (pc & 0x80000000) {
+            pc = (pc & 0x3fffffff) | 0x40000000;
+        }
+        out[i] = pc - 3;
+        if (!esp_backtrace_get_next_frame(&frame)) {
+            break;
+        }
+    }
+#else
+    out[0] = caller;
+#endif
+}
+
+/**
+ * @brief Append a stall to the ring and log it
+ */
+static void __attribute__((noinline)) record_stall(int uart_port, diag_op_t op,
+                                                   int64_t duration_us, uint32_t caller) {
+    diag_stall_t *s = &stall_ring[stall_head];
+
+    s->timestamp_us = esp_timer_get_time();
+    s->duration_us = duration_us;
+    s->uart_port = uart_port;
+    s->op = op;
+    // Skip record_stall() and diag_op_end()/diag_loop_end()
+    capture_backtrace(s->backtrace, 2, caller);
+
+    stall_head = (stall_head + 1) % CONFIG_DIAG_STALL_RING_SIZE;
+    if (stall_count < CONFIG_DIAG_STALL_RING_SIZE) {
+        stall_count++;
+    }
+    stall_total++;
+    loop_state.recorded = true;
+
+    ESP_LOGW(TAG, "Main loop stall: %s on UART%d took %" PRId64 " ms "
+             "(backtrace 0x%08" PRIx32 " 0x%08" PRIx32 " 0x%08" PRIx32 " 0x%08" PRIx32 ")",
+             diag_op_name(op), uart_port, duration_us / 1000,
+             s->backtrace[0], s->backtrace[1], s->backtrace[2], s->backtrace[3]);
+}
+
+/**
+ * @brief Watchdog timer callback
+ *
+ * Warns once per operation when it is still in flight past the budget,
+ * so hangs are visible before the operation returns (if it ever does).
+ */
+static void stall_timer_cb(void *arg) {
+    int64_t start = inflight.start_us;
+    if (start == 0 || inflight.warned) {
+        return;
+    }
+
+    int64_t elapsed = esp_timer_get_time() - start;
+    if (elapsed >= (int64_t)CONFIG_DIAG_STALL_BUDGET_MS * 1000) {
+        inflight.warned = true;
+        ESP_LOGW(TAG, "Stall in progress: %s on UART%d for %" PRId64 " ms",
+                 diag_op_name(inflight.op), inflight.uart_port, elapsed / 1000);
+    }
+}
+
+esp_err_t diag_stall_init(void) {
+#if CONFIG_DIAG_STALL_BUDGET_MS > 0
+    if (stall_timer) {
+        return ESP_OK;
+    }
+
+    const esp_timer_create_args_t args = {
+        .callback = stall_timer_cb,
+        .name = "stall_wdt",
+    };
+    esp_err_t ret = esp_timer_create(&args, &stall_timer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // Check at half the budget so warnings are at most 1.5x late
+    uint64_t period_us = (uint64_t)CONFIG_DIAG_STALL_BUDGET_MS * 500;
+    return esp_timer_start_periodic(stall_timer, period_us);
+#else
+    return ESP_OK;
+#endif
+}
+
+void diag_loop_begin(void) {
+    int64_t now = esp_timer_get_time();
+    if (loop_gap.prev_start_us != 0 && now - loop_gap.prev_start_us > loop_gap.worst_gap_us) {
+        loop_gap.worst_gap_us = now - loop_gap.prev_start_us;
+    }
+    loop_gap.prev_start_us = now;
+
+#if CONFIG_DIAG_STALL_BUDGET_MS > 0
+    loop_state.start_us = now;
+    loop_state.worst_us = 0;
+    loop_state.uart_port = -1;
+    loop_state.op = DIAG_OP_NONE;
+    loop_state.recorded = false;
+#endif
+}
+
+void diag_loop_end(void) {
+#if CONFIG_DIAG_STALL_BUDGET_MS > 0
+    int64_t duration = esp_timer_get_time() - loop_state.start_us;
+    if (duration >= (int64_t)CONFIG_DIAG_STALL_BUDGET_MS * 1000 && !loop_state.recorded) {
+        // No single operation was over budget; blame the slowest one
+        record_stall(loop_state.uart_port, loop_state.op, duration,
+                     (uint32_t)(uintptr_t)__builtin_return_address(0));
+    }
+#endif
+}
+
+void diag_op_begin(int uart_port, diag_op_t op) {
+#if CONFIG_DIAG_STALL_BUDGET_MS > 0
+    inflight.uart_port = uart_port;
+    inflight.op = op;
+    inflight.warned = false;
+    inflight.start_us = esp_timer_get_time();
+#endif
+}
+
+void diag_op_end(void) {
+#if CONFIG_DIAG_STALL_BUDGET_MS > 0
+    int64_t start = inflight.start_us;
+    if (start == 0) {
+        return;
+    }
+    inflight.start_us = 0;
+
+    int64_t duration = esp_timer_get_time() - start;
+    if (duration > loop_state.worst_us) {
+        loop_state.worst_us = duration;
+        loop_state.uart_port = inflight.uart_port;
+        loop_state.op = inflight.op;
+    }
+
+    if (duration >= (int64_t)CONFIG_DIAG_STALL_BUDGET_MS * 1000) {
+        record_stall(inflight.uart_port, inflight.op, duration,
+                     (uint32_t)(uintptr_t)__builtin_return_address(0));
+    }
+#endif
+}
+
+size_t diag_get_stalls(diag_stall_t *out, size_t max_entries) {
+    if (!out) {
+        return 0;
+    }
+
+    size_t n = (stall_count < max_entries) ? stall_count : max_entries;
+    size_t first = (stall_head + CONFIG_DIAG_STALL_RING_SIZE - stall_count) % CONFIG_DIAG_STALL_RING_SIZE;
+
+    // Skip the oldest entries if the caller asked for fewer than we have
+    first = (first + (stall_count - n)) % CONFIG_DIAG_STALL_RING_SIZE;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = stall_ring[(first + i) % CONFIG_DIAG_STALL_RING_SIZE];
+    }
+    return n;
+}
+
+/**
+ * @brief Log the stall ring
+ */
+static void diag_stall_report(void) {
+    if (stall_total == 0) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Main loop stalls: %" PRIu32 " total, most recent:", stall_total);
+
+    diag_stall_t entries[CONFIG_DIAG_STALL_RING_SIZE];
+    size_t n = diag_get_stalls(entries, CONFIG_DIAG_STALL_RING_SIZE);
+    for (size_t i = 0; i < n; i++) {
+        const diag_stall_t *e = &entries[i];
+        ESP_LOGI(TAG, "  at %" PRId64 " ms: %s on UART%d took %" PRId64 " ms "
+                 "(0x%08" PRIx32 " 0x%08" PRIx32 " 0x%08" PRIx32 " 0x%08" PRIx32 ")",
+                 e->timestamp_us / 1000, diag_op_name(e->op), e->uart_port,
+                 e->duration_us / 1000, e->backtrace[0], e->backtrace[1],
+                 e->backtrace[2], e->backtrace[3]);
+    }
+}
+
+/* -------------- Flash Write Test -------------- */
+
+#if CONFIG_DIAG_FLASH_WRITE_TEST
+/**
+ * @brief Sum of FIFO overflows over all bridges
+ */
+static uint32_t total_fifo_overflows(void) {
+    uart_bridge_t *bridges = uart_manager_get_instances();
+    uint32_t total = 0;
+
+    for (int i = 0; i < CONFIG_AVAILABLE_BRIDGE_UARTS; i++) {
+        if (bridges[i].enabled) {
+            total += bridges[i].line_stats.fifo_overflow;
+        }
+    }
+    return total;
+}
+
+/**
+ * @brief Flash write test task: keep rewriting an NVS blob
+ *
+ * Each write changes the blob so NVS really programs (and regularly
+ * erases) flash, disabling the flash cache while it does.
+ */
+static void flash_test_task(void *arg) {
+    static uint8_t blob[DIAG_FLASH_BLOB_SIZE];
+    nvs_handle_t nvs;
+
+    if (nvs_open("diag", NVS_READWRITE, &nvs) != ESP_OK) {
+        ESP_LOGE(TAG, "Flash write test: cannot open NVS");
+        flash_test.task = NULL;
+        vTaskDelete(NULL);
+        return;
+    }
+
+    for (uint32_t round = 0;; round++) {
+        memset(blob, (int)(round & 0xFF), sizeof(blob));
+
+        int64_t start = esp_timer_get_time();
+        esp_err_t ret = nvs_set_blob(nvs, "flash_test", blob, sizeof(blob));
+        if (ret == ESP_OK) {
+            ret = nvs_commit(nvs);
+        }
+        int64_t duration = esp_timer_get_time() - start;
+
+        if (ret != ESP_OK) {
+            flash_test.failures++;
+        } else {
+            flash_test.writes++;
+            if (duration > flash_test.worst_us) {
+                flash_test.worst_us = duration;
+            }
+        }
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_DIAG_FLASH_WRITE_INTERVAL_MS));
+    }
+}
+#endif
+
+esp_err_t diag_flash_test_start(void) {
+#if CONFIG_DIAG_FLASH_WRITE_TEST
+    if (flash_test.task) {
+        return ESP_OK;
+    }
+
+    flash_test.fifo_overflow_base = total_fifo_overflows();
+    // Below the main loop, like a logger or settings writer would be
+    if (xTaskCreate(flash_test_task, "diag_flash", 3072, NULL,
+                    tskIDLE_PRIORITY + 1, &flash_test.task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGW(TAG, "Flash write test running: NVS blob rewritten every %d ms",
+             CONFIG_DIAG_FLASH_WRITE_INTERVAL_MS);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+/**
+ * @brief Log the worst-case RX service latency and flash write test results
+ */
+static void diag_latency_report(void) {
+#if defined(CONFIG_UART_HOT_PATH_IN_IRAM)
+    const char *placement = "IRAM";
+#else
+    const char *placement = "flash";
+#endif
+    ESP_LOGI(TAG, "Worst main loop gap (RX service latency) %" PRId64 " us, UART hot path in %s",
+             loop_gap.worst_gap_us, placement);
+    loop_gap.worst_gap_us = 0;
+
+#if CONFIG_DIAG_FLASH_WRITE_TEST
+    ESP_LOGI(TAG, "Flash write test: %" PRIu32 " writes (%" PRIu32 " failed), worst %" PRId64
+             " us, FIFO overflows during test %" PRIu32,
+             flash_test.writes, flash_test.failures, flash_test.worst_us,
+             total_fifo_overflows() - flash_test.fifo_overflow_base);
+#endif
+}
+
+/* -------------- Steady-State Allocation Check -------------- */
+
+#if CONFIG_DIAG_ALLOC_CHECK
+/**
+ * @brief Heap allocation hook (CONFIG_HEAP_USE_HOOKS)
+ *
+ * Called by the heap component after every successful allocation.
+ * Must not log or allocate itself.
+ */
+void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps) {
+    (void)ptr;
+    (void)caps;
+
+    if (!alloc_state.armed || xTaskGetCurrentTaskHandle() != alloc_state.task) {
+        return;
+    }
+
+    diag_alloc_t *a = &alloc_ring[alloc_state.head];
+    a->size = size;
+    a->uart_port = alloc_state.uart_port;
+    capture_backtrace(a->backtrace, DIAG_ALLOC_SKIP_FRAMES,
+                      (uint32_t)(uintptr_t)__builtin_return_address(0));
+
+    alloc_state.head = (alloc_state.head + 1) % DIAG_ALLOC_RING_SIZE;
+    alloc_state.total++;
+}
+
+/**
+ * @brief Heap free hook (CONFIG_HEAP_USE_HOOKS)
+ *
+ * Frees are harmless in steady state; only allocations are tracked.
+ */
+void IRAM_ATTR esp_heap_trace_free_hook(void *ptr) {
+    (void)ptr;
+}
+#endif
+
+void diag_alloc_warmup_reset(void) {
+#if CONFIG_DIAG_ALLOC_CHECK
+    alloc_state.armed = false;
+    alloc_state.warmup = 0;
+#endif
+}
+
+void diag_alloc_region_begin(int uart_port) {
+#if CONFIG_DIAG_ALLOC_CHECK
+    if (alloc_state.warmup < CONFIG_DIAG_ALLOC_WARMUP_ITERATIONS) {
+        alloc_state.warmup++;
+        return;
+    }
+
+    alloc_state.task = xTaskGetCurrentTaskHandle();
+    alloc_state.uart_port = uart_port;
+    alloc_state.armed = true;
+#endif
+}
+
+void diag_alloc_region_end(void) {
+#if CONFIG_DIAG_ALLOC_CHECK
+    if (!alloc_state.armed) {
+        return;
+    }
+    alloc_state.armed = false;
+
+    if (alloc_state.reported == alloc_state.total) {
+        return;
+    }
+
+    // Log whatever is still in the ring since the last pass
+    uint32_t missed = alloc_state.total - alloc_state.reported;
+    uint32_t shown = (missed < DIAG_ALLOC_RING_SIZE) ? missed : DIAG_ALLOC_RING_SIZE;
+    size_t first = (alloc_state.head + DIAG_ALLOC_RING_SIZE - shown) % DIAG_ALLOC_RING_SIZE;
+    for (uint32_t i = 0; i < shown; i++) {
+        const diag_alloc_t *a = &alloc_ring[(first + i) % DIAG_ALLOC_RING_SIZE];
+        ESP_LOGE(TAG, "Steady-state allocation of %u bytes on UART%d "
+                 "(backtrace 0x%08" PRIx32 " 0x%08" PRIx32 " 0x%08" PRIx32 " 0x%08" PRIx32 ")",
+                 (unsigned)a->size, a->uart_port,
+                 a->backtrace[0], a->backtrace[1], a->backtrace[2], a->backtrace[3]);
+    }
+    alloc_state.reported = alloc_state.total;
+
+#if CONFIG_DIAG_ALLOC_CHECK_ABORT
+    ESP_LOGE(TAG, "Heap allocation in the forwarding path after warm-up, aborting");
+    abort();
+#endif
+#endif
+}
+
+size_t diag_get_steady_allocs(diag_alloc_t *out, size_t max_entries) {
+#if CONFIG_DIAG_ALLOC_CHECK
+    if (!out) {
+        return 0;
+    }
+
+    size_t avail = (alloc_state.total < DIAG_ALLOC_RING_SIZE) ? alloc_state.total : DIAG_ALLOC_RING_SIZE;
+    size_t n = (avail < max_entries) ? avail : max_entries;
+    size_t first = (alloc_state.head + DIAG_ALLOC_RING_SIZE - n) % DIAG_ALLOC_RING_SIZE;
+    for (size_t i = 0; i < n; i++) {
+        out[i] = alloc_ring[(first + i) % DIAG_ALLOC_RING_SIZE];
+    }
+    return n;
+#else
+    (void)out;
+    (void)max_entries;
+    return 0;
+#endif
+}
+
+/**
+ * @brief Log the steady-state allocation check result
+ */
+static void diag_alloc_report(void) {
+#if CONFIG_DIAG_ALLOC_CHECK
+    ESP_LOGI(TAG, "Steady-state allocations: %" PRIu32 "%s", alloc_state.total,
+             alloc_state.warmup < CONFIG_DIAG_ALLOC_WARMUP_ITERATIONS ? " (warming up)" : "");
+#endif
+}
+
+/**
+ * @brief Log TLS record rate and overhead, TLS and Noise session counts
+ *        and heap use, handshake refusals and the state of the heap
+ *
+ * Record overhead is the share of bytes on the wire spent on record
+ * headers, MACs and padding; compare it with the load report's CPU per
+ * Mbit/s when tuning record coalescing. The largest free block shrinking
+ * while free heap stays level means session churn is fragmenting the heap.
+ */
+static void diag_secure_report(void) {
+#if defined(CONFIG_SSCTE_TLS_ENABLE)
+    tls_record_stats_t rec;
+    tls_server_get_record_stats(&rec);
+    int64_t now = esp_timer_get_time();
+    uint64_t records = rec.records - tls_sample.stats.records;
+    uint64_t payload = rec.payload_bytes - tls_sample.stats.payload_bytes;
+    uint64_t wire = rec.wire_bytes - tls_sample.stats.wire_bytes;
+    if (tls_sample.time_us != 0 && records > 0 && now > tls_sample.time_us) {
+        ESP_LOGI(TAG, "TLS records: %.1f/s, %" PRIu64 " B payload each, overhead %.1f%%",
+                 (double)records * 1e6 / (double)(now - tls_sample.time_us),
+                 payload / records, 100.0 * (double)(wire - payload) / (double)payload);
+    }
+    tls_sample.time_us = now;
+    tls_sample.stats = rec;
+
+    tls_heap_stats_t st;
+    tls_server_get_heap_stats(&st);
+    if (st.handshakes > 0) {
+        ESP_LOGI(TAG, "TLS: %d open, %" PRIu32 " handshakes, last session %u B "
+                 "(free %u -> %u B), max %u B",
+                 st.open, st.handshakes, (unsigned)st.session_last,
+                 (unsigned)st.free_before, (unsigned)st.free_after, (unsigned)st.session_max);
+    }
+#endif
+
+#if defined(CONFIG_NOISE_ENABLE)
+    noise_stats_t ns;
+    noise_server_get_stats(&ns);
+    if (ns.handshakes > 0 || ns.failed > 0) {
+        ESP_LOGI(TAG, "Noise: %d open, %" PRIu32 " handshakes, %" PRIu32 " failed, %u B per session",
+                 ns.open, ns.handshakes, ns.failed, (unsigned)ns.session_bytes);
+    }
+#endif
+
+#if defined(CONFIG_SSCTE_TLS_ENABLE) || defined(CONFIG_NOISE_ENABLE)
+    admission_stats_t adm;
+    admission_get_stats(&adm);
+    if (adm.refused_source > 0 || adm.refused_global > 0) {
+        ESP_LOGI(TAG, "Handshakes: %" PRIu32 " admitted, refused %" PRIu32
+                 " per address, %" PRIu32 " global",
+                 adm.admitted, adm.refused_source, adm.refused_global);
+    }
+    ESP_LOGI(TAG, "Heap: free %u B, largest block %u B, minimum %u B",
+             (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+             (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT),
+             (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+#endif
+}
+
+/**
+ * @brief Log UART line error counters for all active bridges
+ */
+static void diag_uart_report(void) {
+    uart_bridge_t *bridges = uart_manager_get_instances();
+
+    for (int i = 0; i < CONFIG_AVAILABLE_BRIDGE_UARTS; i++) {
+        uart_line_stats_t st;
+        if (!bridges[i].enabled || uart_get_line_stats(&bridges[i], &st) != ESP_OK) {
+            continue;
+        }
+
+        if (bridges[i].dma_mode) {
+            ESP_LOGI(TAG, "UART%d: DMA mode, rx %" PRIu64 " B, tx %" PRIu64
+                     " B, dropped chunks %" PRIu32 ", flow pauses %" PRIu32
+                     ", rx discarded %" PRIu64 " B",
+                     bridges[i].uart_port, st.rx_bytes, st.tx_bytes,
+                     uart_dma_get_dropped(bridges[i].dma), st.flow_pauses, st.rx_discarded);
+            continue;
+        }
+
+        ESP_LOGI(TAG, "UART%d: rx %" PRIu64 " B, fifo_ovf %" PRIu32 ", buf_full %" PRIu32
+                 ", frame %" PRIu32 ", parity %" PRIu32 ", break %" PRIu32
+                 ", flow pauses %" PRIu32 ", tx discarded %" PRIu64
+                 " B, rx discarded %" PRIu64 " B",
+                 bridges[i].uart_port, st.rx_bytes, st.fifo_overflow, st.buffer_full,
+                 st.frame_errors, st.parity_errors, st.breaks, st.flow_pauses, st.tx_discarded,
+                 st.rx_discarded);
+        if (st.last_error_type >= 0) {
+            ESP_LOGI(TAG, "UART%d: last error type %d at offset %" PRIu64,
+                     bridges[i].uart_port, st.last_error_type, st.last_error_offset);
+        }
+    }
+
+#if defined(CONFIG_UART_TAP_MODE)
+    ESP_LOGI(TAG, "Tap: %" PRIu32 " records dropped", uart_tap_get_dropped());
+#endif
+}
+
+/**
+ * @brief Log forwarding throughput and CPU load since the previous report
+ *
+ * CPU load is derived from the idle task's run time on the core running the
+ * main loop, so it needs FreeRTOS run time stats clocked by esp_timer.
+ */
+static void diag_load_report(void) {
+    uart_bridge_t *bridges = uart_manager_get_instances();
+    int64_t now = esp_timer_get_time();
+    uint64_t bytes = 0;
+
+    for (int i = 0; i < CONFIG_AVAILABLE_BRIDGE_UARTS; i++) {
+        uart_line_stats_t st;
+        if (bridges[i].enabled && uart_get_line_stats(&bridges[i], &st) == ESP_OK) {
+            bytes += st.rx_bytes + st.tx_bytes;
+        }
+    }
+
+#if defined(CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS) && defined(CONFIG_FREERTOS_RUN_TIME_STATS_USING_ESP_TIMER)
+    uint32_t idle_time = (uint32_t)ulTaskGetIdleRunTimeCounter();
+#else
+    uint32_t idle_time = 0;
+#endif
+
+    if (load_sample.time_us != 0 && now > load_sample.time_us) {
+        int64_t elapsed_us = now - load_sample.time_us;
+        // Bits per microsecond is Mbit/s
+        float mbps = (float)((bytes - load_sample.bytes) * 8) / (float)elapsed_us;
+
+#if defined(CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS) && defined(CONFIG_FREERTOS_RUN_TIME_STATS_USING_ESP_TIMER)
+        float idle_pct = 100.0f * (float)(uint32_t)(idle_time - load_sample.idle_time) / (float)elapsed_us;
+        float load_pct = idle_pct > 100.0f ? 0.0f : 100.0f - idle_pct;
+        if (mbps > 0.01f) {
+            ESP_LOGI(TAG, "Throughput %.2f Mbit/s, CPU load %.1f%% (%.1f%% per Mbit/s)",
+                     mbps, load_pct, load_pct / mbps);
+        } else {
+            ESP_LOGI(TAG, "Throughput %.2f Mbit/s, CPU load %.1f%%", mbps, load_pct);
+        }
+#else
+        ESP_LOGI(TAG, "Throughput %.2f Mbit/s (enable FreeRTOS run time stats for CPU load)", mbps);
+#endif
+    }
+
+    load_sample.time_us = now;
+    load_sample.bytes = bytes;
+    load_sample.idle_time = idle_time;
+}
+
+void diag_report(void) {
+    ESP_LOGI(TAG, "---- Diagnostics report (uptime %" PRId64 " ms) ----",
+             esp_timer_get_time() / 1000);
+    diag_boot_report();
+    diag_uart_report();
+    diag_load_report();
+    diag_latency_report();
+    diag_stall_report();
+    diag_alloc_report();
+    diag_secure_report();
+}
+
+void diag_poll(void) {
+#if CONFIG_DIAG_REPORT_INTERVAL_S > 0
+    int64_t now = esp_timer_get_time();
+    if (last_report_us == 0) {
+        // First call from the main loop; the boot report was just logged
+        last_report_us = now;
+    } else if (now - last_report_us >=(int64_t)CONFIG_DIAG_REPORT_INTERVAL_S * 1000000) {
+        last_report_us = now;
+        diag_report();
+    }
+#else
+    (void)last_report_us;
+#endif
+}
@@ -0,0 +1,238 @@
+/**
+ * @file diagnostics.h
+ * @brief Runtime diagnostics and statistics reporting
+ *
+ * Collects timing information and counters from the other components
+ * and reports them on the debug console. A report can be requested at
+ * any time with diag_report(), or produced periodically by calling
+ * diag_poll() from the main loop.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Startup phases recorded in the boot timeline
+ */
+typedef enum {
+    DIAG_BOOT_NVS_INIT = 0,   // nvs_flash_init() (including erase on version change)
+    DIAG_BOOT_WIFI_INIT,      // wifi_init()
+    DIAG_BOOT_WIFI_ASSOC,     // STA start until associated with the AP
+    DIAG_BOOT_WIFI_DHCP,      // Association until an IP address is obtained
+    DIAG_BOOT_SPIFFS_MOUNT,   // esp_vfs_spiffs_register()
+    DIAG_BOOT_LOAD_CERT,      // load_cert_file() for the server certificate
+    DIAG_BOOT_LOAD_KEY,       // load_cert_file() for the server private key
+    DIAG_BOOT_LOAD_CA,        // load_cert_file() for the CA certificate or client pins
+    DIAG_BOOT_UART_INIT,      // uart_manager_init()
+    DIAG_BOOT_TCP_INIT,       // tcp_server_init()
+    DIAG_BOOT_PHASE_MAX
+} diag_boot_phase_t;
+
+/**
+ * @brief Timing of a single boot phase
+ *
+ * Timestamps are in microseconds since the application started.
+ * A value of 0 means the event has not been recorded.
+ */
+typedef struct {
+    int64_t start_us;      // When the phase began
+    int64_t end_us;        // When the phase completed
+} diag_boot_entry_t;
+
+/**
+ * @brief Main loop operations tracked by the stall detector
+ */
+typedef enum {
+    DIAG_OP_NONE = 0,         // No operation in flight (loop overhead)
+    DIAG_OP_ACCEPT,           // Polling/accepting a new connection
+    DIAG_OP_HANDSHAKE,        // Transport setup for a new client (TLS handshake)
+    DIAG_OP_TCP_READ,         // Reading from the client socket
+    DIAG_OP_TCP_WRITE,        // Writing to the client socket
+    DIAG_OP_UART_READ,        // Reading from the UART driver
+    DIAG_OP_UART_WRITE,       // Writing to the UART driver
+    DIAG_OP_MAX
+} diag_op_t;
+
+/** Number of return addresses captured for each stall */
+#define DIAG_STALL_BACKTRACE_DEPTH 4
+
+/**
+ * @brief A recorded main loop stall
+ */
+typedef struct {
+    int64_t timestamp_us;     // When the stall ended, in microseconds since start
+    int64_t duration_us;      // How long the operation (or loop iteration) took
+    int uart_port;            // UART of the bridge being serviced (-1 if none)
+    diag_op_t op;             // Operation in flight
+    uint32_t backtrace[DIAG_STALL_BACKTRACE_DEPTH]; // Call site PCs (0 = unused)
+} diag_stall_t;
+
+/**
+ * @brief A heap allocation seen during steady-state forwarding
+ */
+typedef struct {
+    size_t size;              // Requested allocation size
+    int uart_port;            // UART of the bridge being forwarded
+    uint32_t backtrace[DIAG_STALL_BACKTRACE_DEPTH]; // Call site PCs (0 = unused)
+} diag_alloc_t;
+
+/**
+ * @brief Mark the start of a boot phase
+ *
+ * Only the first call for a phase is recorded, so event handlers that
+ * fire again after boot (e.g. WiFi reconnects) don't overwrite the timeline.
+ *
+ * @param phase Phase that is starting
+ */
+void diag_boot_begin(diag_boot_phase_t phase);
+
+/**
+ * @brief Mark the end of a boot phase
+ *
+ * Ignored if the phase was never started or has already completed.
+ *
+ * @param phase Phase that has completed
+ */
+void diag_boot_end(diag_boot_phase_t phase);
+
+/**
+ * @brief Get the recorded boot timeline
+ *
+ * @return Pointer to an array of DIAG_BOOT_PHASE_MAX entries
+ */
+const diag_boot_entry_t* diag_get_boot_timeline(void);
+
+/**
+ * @brief Log the boot timeline to the console
+ */
+void diag_boot_report(void);
+
+/**
+ * @brief Initialize the stall detector
+ *
+ * Starts the timer that warns about operations still in flight after
+ * CONFIG_DIAG_STALL_BUDGET_MS. Does nothing when the budget is 0.
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t diag_stall_init(void);
+
+/**
+ * @brief Mark the start of a main loop iteration
+ */
+void diag_loop_begin(void);
+
+/**
+ * @brief Mark the end of a main loop iteration
+ *
+ * Records a stall if the iteration exceeded the budget and no single
+ * operation was already recorded for it.
+ */
+void diag_loop_end(void);
+
+/**
+ * @brief Mark the start of a potentially blocking operation
+ *
+ * @param uart_port UART of the bridge being serviced
+ * @param op Operation about to be performed
+ */
+void diag_op_begin(int uart_port, diag_op_t op);
+
+/**
+ * @brief Mark the end of the operation started with diag_op_begin()
+ *
+ * Records a stall, with the caller's backtrace, if the operation
+ * exceeded CONFIG_DIAG_STALL_BUDGET_MS.
+ */
+void diag_op_end(void);
+
+/**
+ * @brief Copy recorded stalls, oldest first
+ *
+ * @param out Array to receive the entries
+ * @param max_entries Capacity of out
+ * @return Number of entries copied
+ */
+size_t diag_get_stalls(diag_stall_t *out, size_t max_entries);
+
+/**
+ * @brief Get the name of a main loop operation
+ *
+ * @param op Operation
+ * @return Static string naming the operation
+ */
+const char* diag_op_name(diag_op_t op);
+
+/**
+ * @brief Restart the steady-state allocation warm-up
+ *
+ * Called when a client connects or disconnects. Allocation checking is
+ * suspended until CONFIG_DIAG_ALLOC_WARMUP_ITERATIONS forwarding passes
+ * have completed again.
+ */
+void diag_alloc_warmup_reset(void);
+
+/**
+ * @brief Mark the start of a forwarding pass for a bridge
+ *
+ * After warm-up, every heap allocation made by the calling task until
+ * diag_alloc_region_end() is recorded with its call site.
+ *
+ * @param uart_port UART of the bridge being forwarded
+ */
+void diag_alloc_region_begin(int uart_port);
+
+/**
+ * @brief Mark the end of a forwarding pass
+ *
+ * Logs allocations recorded during the pass. With
+ * CONFIG_DIAG_ALLOC_CHECK_ABORT, aborts if there were any.
+ */
+void diag_alloc_region_end(void);
+
+/**
+ * @brief Copy recorded steady-state allocations, oldest first
+ *
+ * @param out Array to receive the entries
+ * @param max_entries Capacity of out
+ * @return Number of entries copied
+ */
+size_t diag_get_steady_allocs(diag_alloc_t *out, size_t max_entries);
+
+/**
+ * @brief Start the flash write test
+ *
+ * With CONFIG_DIAG_FLASH_WRITE_TEST, a low-priority task keeps rewriting
+ * an NVS blob so worst-case RX latency and FIFO overflows can be measured
+ * while the flash cache is repeatedly disabled. Results are part of the
+ * diagnostics report.
+ *
+ * @return ESP_OK if the test is running, ESP_ERR_NOT_SUPPORTED if it is
+ *         not enabled in this build, another error code on failure
+ */
+esp_err_t diag_flash_test_start(void);
+
+/**
+ * @brief Log all collected diagnostics to the console
+ */
+void diag_report(void);
+
+/**
+ * @brief Periodic diagnostics hook for the main loop
+ *
+ * Produces a full report every CONFIG_DIAG_REPORT_INTERVAL_S seconds.
+ * Does nothing when the interval is set to 0.
+ */
+void diag_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,772 @@
+/*
+ * noise_server.c
+ *
+ * Noise_IK_25519_AESGCM_SHA256 responder on mbedTLS primitives.
+ *
+ * The handshake follows the Noise specification (revision 34): a
+ * symmetric state of chaining key ck, handshake hash h and cipher key k
+ * is carried through the tokens of the IK pattern, then split into one
+ * AES-GCM key per direction. X25519 uses mbedTLS's Curve25519 group and
+ * AES-GCM runs on the AES accelerator where the chip has one.
+ *
+ * Each session is a single allocation holding both cipher contexts and
+ * one message buffer per direction, so its heap use is fixed.
+ *
+ * Thread safety: None. All functions must be called from the same thread.
+ */
+
+#include "noise_server.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+#if defined(CONFIG_NOISE_ENABLE)
+
+#include "lwip/sockets.h"
+#include <unistd.h>        // close(), shutdown()
+#include "mbedtls/ecp.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/gcm.h"
+#include "mbedtls/md.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/platform_util.h"
+
+static const char *TAG = "NoiseServer";
+
+#define PROTOCOL_NAME   "Noise_IK_25519_AESGCM_SHA256"
+#define HASH_LEN        32
+#define TAG_LEN         16
+#define LEN_PREFIX      2
+
+/** Client's first message: e, encrypted s, tag of the empty payload */
+#define MSG1_LEN        (NOISE_KEY_LEN + NOISE_KEY_LEN + TAG_LEN + TAG_LEN)
+/** Bridge's reply: e, tag of the empty payload */
+#define MSG2_LEN        (NOISE_KEY_LEN + TAG_LEN)
+
+/**
+ * @brief Allowed client
+ */
+typedef struct {
+    char name[NOISE_NAME_MAX + 1];
+    uint8_t pub[NOISE_KEY_LEN];    // X25519 public key
+    uint32_t uarts;                // Bit n allows UARTn, 0 allows all
+} noise_client_t;
+
+struct noise_session {
+    int sock;
+    int uart_port;
+    const noise_client_t *client;
+    mbedtls_gcm_context rx;        // Client to bridge
+    mbedtls_gcm_context tx;        // Bridge to client
+    uint64_t rx_nonce;
+    uint64_t tx_nonce;
+    size_t rx_off;                 // Next unread byte in rx_buf
+    size_t rx_len;                 // Decrypted bytes in rx_buf
+    size_t rx_have;                // Bytes of the incoming message so far, prefix included
+    size_t rx_msg_len;             // Length of the incoming message, once its prefix is in
+    uint8_t rx_prefix[LEN_PREFIX];
+    uint8_t rx_buf[CONFIG_NOISE_MAX_MESSAGE + TAG_LEN];
+    uint8_t tx_buf[LEN_PREFIX + CONFIG_NOISE_MAX_MESSAGE + TAG_LEN];
+};
+
+/**
+ * @brief Handshake symmetric state
+ */
+typedef struct {
+    uint8_t ck[HASH_LEN];          // Chaining key
+    uint8_t h[HASH_LEN];           // Handshake hash
+    uint8_t k[HASH_LEN];           // Current cipher key
+    uint64_t n;                    // Nonce for k
+    mbedtls_gcm_context gcm;       // Keyed with k
+} symmetric_t;
+
+static struct {
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    mbedtls_ecp_group grp;         // Curve25519
+    mbedtls_mpi s_priv;            // Static private key
+    uint8_t s_pub[NOISE_KEY_LEN];
+    noise_client_t clients[CONFIG_NOISE_MAX_CLIENTS];
+    int client_count;
+    bool ready;
+} server;
+
+static noise_stats_t stats;
+
+/* -------------- Keys -------------- */
+
+/**
+ * @brief Decode exactly NOISE_KEY_LEN bytes of hex
+ *
+ * @return true on success
+ */
+static bool parse_key(const char *str, uint8_t *out) {
+    if (strlen(str) != 2 * NOISE_KEY_LEN) {
+        return false;
+    }
+    for (int i = 0; i < NOISE_KEY_LEN; i++) {
+        unsigned int byte;
+        if (!isxdigit((unsigned char)str[2 * i]) || !isxdigit((unsigned char)str[2 * i + 1]) ||
+            sscanf(str + 2 * i, "%2x", &byte) != 1) {
+            return false;
+        }
+        out[i] = (uint8_t)byte;
+    }
+    return true;
+}
+
+/**
+ * @brief Parse a comma-separated list of UART numbers into a bit mask
+ *
+ * @return true on success
+ */
+static bool parse_uart_list(const char *str, uint32_t *mask) {
+    *mask = 0;
+    while (*str) {
+        char *end;
+        long n = strtol(str, &end, 10);
+        if (end == str || n < 1 || n > 31) {
+            return false;
+        }
+        *mask |= 1UL << n;
+        str = (*end == ',') ? end + 1 : end;
+        if (*end != ',' && *end != '\0') {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Load the static private key and derive the public key
+ *
+ * The file holds the key as 64 hex digits; lines starting with '#' are
+ * skipped. The key is clamped as X25519 requires.
+ */
+static esp_err_t load_static_key(void) {
+    FILE *file = fopen(CONFIG_NOISE_KEY_PATH, "r");
+    if (!file) {
+        ESP_LOGE(TAG, "Failed to open %s", CONFIG_NOISE_KEY_PATH);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    char line[2 * NOISE_KEY_LEN + 8];
+    uint8_t key[NOISE_KEY_LEN];
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), file)) {
+        char *save;
+        char *hex = strtok_r(line, " \t\r\n", &save);
+        if (hex && hex[0] != '#') {
+            found = parse_key(hex, key);
+            if (!found) {
+                break;
+            }
+        }
+    }
+    mbedtls_platform_zeroize(line, sizeof(line));
+    fclose(file);
+    if (!found) {
+        ESP_LOGE(TAG, "%s: no valid key", CONFIG_NOISE_KEY_PATH);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    mbedtls_ecp_point pub;
+    mbedtls_ecp_point_init(&pub);
+    size_t olen;
+    int ret = mbedtls_mpi_read_binary_le(&server.s_priv, key, sizeof(key));
+    mbedtls_platform_zeroize(key, sizeof(key));
+    if (ret == 0) ret = mbedtls_mpi_set_bit(&server.s_priv, 0, 0);
+    if (ret == 0) ret = mbedtls_mpi_set_bit(&server.s_priv, 1, 0);
+    if (ret == 0) ret = mbedtls_mpi_set_bit(&server.s_priv, 2, 0);
+    if (ret == 0) ret = mbedtls_mpi_set_bit(&server.s_priv, 255, 0);
+    if (ret == 0) ret = mbedtls_mpi_set_bit(&server.s_priv, 254, 1);
+    if (ret == 0) {
+        ret = mbedtls_ecp_mul(&server.grp, &pub, &server.s_priv, &server.grp.G,
+                              mbedtls_ctr_drbg_random, &server.ctr_drbg);
+    }
+    if (ret == 0) {
+        ret = mbedtls_ecp_point_write_binary(&server.grp, &pub, MBEDTLS_ECP_PF_UNCOMPRESSED,
+                                             &olen, server.s_pub, sizeof(server.s_pub));
+    }
+    mbedtls_ecp_point_free(&pub);
+    if (ret != 0) {
+        ESP_LOGE(TAG, "Invalid static key: -0x%04x", -ret);
+        return ESP_FAIL;
+    }
+
+    // Clients need this to connect
+    char hex[2 * NOISE_KEY_LEN + 1];
+    for (int i = 0; i < NOISE_KEY_LEN; i++) {
+        sprintf(hex + 2 * i, "%02x", server.s_pub[i]);
+    }
+    ESP_LOGI(TAG, "Bridge public key %s", hex);
+    return ESP_OK;
+}
+
+/**
+ * @brief Load the allowed client keys
+ *
+ * One client per line: `<name> <hex public key> [<uart>,<uart>...]`.
+ * Empty lines and lines starting with '#' are skipped.
+ */
+static void load_clients(void) {
+    FILE *file = fopen(CONFIG_NOISE_CLIENTS_PATH, "r");
+    if (!file) {
+        ESP_LOGE(TAG, "Failed to open %s", CONFIG_NOISE_CLIENTS_PATH);
+        return;
+    }
+
+    char line[NOISE_NAME_MAX + 2 * NOISE_KEY_LEN + 48];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_no++;
+        char *save;
+        char *name = strtok_r(line, " \t\r\n", &save);
+        if (!name || name[0] == '#') {
+            continue;
+        }
+        char *hex = strtok_r(NULL, " \t\r\n", &save);
+        char *uart_list = strtok_r(NULL, " \t\r\n", &save);
+
+        noise_client_t c = { 0 };
+        if (strlen(name) > NOISE_NAME_MAX || !hex || !parse_key(hex, c.pub) ||
+            (uart_list && !parse_uart_list(uart_list, &c.uarts))) {
+            ESP_LOGW(TAG, "%s:%d: invalid entry, ignoring", CONFIG_NOISE_CLIENTS_PATH, line_no);
+            continue;
+        }
+        if (server.client_count >= CONFIG_NOISE_MAX_CLIENTS) {
+            ESP_LOGW(TAG, "Too many Noise clients, ignoring \"%s\"", name);
+            continue;
+        }
+        strcpy(c.name, name);
+        server.clients[server.client_count++] = c;
+    }
+    fclose(file);
+}
+
+/**
+ * @brief Find an allowed client by its static public key
+ */
+static const noise_client_t *find_client(const uint8_t *pub) {
+    for (int i = 0; i < server.client_count; i++) {
+        if (memcmp(server.clients[i].pub, pub, NOISE_KEY_LEN) == 0) {
+            return &server.clients[i];
+        }
+    }
+    return NULL;
+}
+
+/* -------------- Primitives -------------- */
+
+/**
+ * @brief AES-GCM nonce: 32 zero bits, then the counter big-endian
+ */
+static void make_nonce(uint64_t n, uint8_t iv[12]) {
+    memset(iv, 0, 4);
+    for (int i = 0; i < 8; i++) {
+        iv[4 + i] = (uint8_t)(n >> (56 - 8 * i));
+    }
+}
+
+/**
+ * @brief X25519 of a private scalar and a peer public key
+ */
+static int dh(const mbedtls_mpi *priv, const uint8_t *peer, uint8_t out[NOISE_KEY_LEN]) {
+    mbedtls_ecp_point q;
+    mbedtls_mpi z;
+    mbedtls_ecp_point_init(&q);
+    mbedtls_mpi_init(&z);
+
+    // Fails on low-order points, which give an all-zero secret
+    int ret = mbedtls_ecp_point_read_binary(&server.grp, &q, peer, NOISE_KEY_LEN);
+    if (ret == 0) {
+        ret = mbedtls_ecdh_compute_shared(&server.grp, &z, &q, priv,
+                                          mbedtls_ctr_drbg_random, &server.ctr_drbg);
+    }
+    if (ret == 0) {
+        ret = mbedtls_mpi_write_binary_le(&z, out, NOISE_KEY_LEN);
+    }
+
+    mbedtls_mpi_free(&z);
+    mbedtls_ecp_point_free(&q);
+    return ret;
+}
+
+static int hmac(const uint8_t *key, const uint8_t *in, size_t in_len, uint8_t out[HASH_LEN]) {
+    return mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                           key, HASH_LEN, in, in_len, out);
+}
+
+/**
+ * @brief Noise HKDF with two outputs
+ */
+static int hkdf(const uint8_t *ck, const uint8_t *ikm, size_t ikm_len,
+                uint8_t out1[HASH_LEN], uint8_t out2[HASH_LEN]) {
+    uint8_t temp[HASH_LEN];
+    uint8_t in[HASH_LEN + 1];
+    int ret = hmac(ck, ikm, ikm_len, temp);
+    in[0] = 0x01;
+    if (ret == 0) ret = hmac(temp, in, 1, out1);
+    memcpy(in, out1, HASH_LEN);
+    in[HASH_LEN] = 0x02;
+    if (ret == 0) ret = hmac(temp, in, sizeof(in), out2);
+    mbedtls_platform_zeroize(temp, sizeof(temp));
+    mbedtls_platform_zeroize(in, sizeof(in));
+    return ret;
+}
+
+/* -------------- Symmetric state -------------- */
+
+static void mix_hash(symmetric_t *ss, const uint8_t *data, size_t len) {
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    mbedtls_sha256_update(&sha, ss->h, HASH_LEN);
+    mbedtls_sha256_update(&sha, data, len);
+    mbedtls_sha256_finish(&sha, ss->h);
+    mbedtls_sha256_free(&sha);
+}
+
+static int mix_key(symmetric_t *ss, const uint8_t *ikm) {
+    uint8_t ck[HASH_LEN];
+    int ret = hkdf(ss->ck, ikm, NOISE_KEY_LEN, ck, ss->k);
+    memcpy(ss->ck, ck, HASH_LEN);
+    mbedtls_platform_zeroize(ck, sizeof(ck));
+    ss->n = 0;
+    if (ret == 0) {
+        ret = mbedtls_gcm_setkey(&ss->gcm, MBEDTLS_CIPHER_ID_AES, ss->k, 256);
+    }
+    return ret;
+}
+
+/** DecryptAndHash; out receives len - TAG_LEN bytes */
+static int decrypt_and_hash(symmetric_t *ss, const uint8_t *in, size_t len, uint8_t *out) {
+    uint8_t iv[12];
+    make_nonce(ss->n++, iv);
+    int ret = mbedtls_gcm_auth_decrypt(&ss->gcm, len - TAG_LEN, iv, sizeof(iv), ss->h, HASH_LEN,
+                                       in + len - TAG_LEN, TAG_LEN, in, out);
+    if (ret == 0) {
+        mix_hash(ss, in, len);
+    }
+    return ret;
+}
+
+/** EncryptAndHash; out receives len + TAG_LEN bytes */
+static int encrypt_and_hash(symmetric_t *ss, const uint8_t *in, size_t len, uint8_t *out) {
+    uint8_t iv[12];
+    make_nonce(ss->n++, iv);
+    int ret = mbedtls_gcm_crypt_and_tag(&ss->gcm, MBEDTLS_GCM_ENCRYPT, len, iv, sizeof(iv),
+                                        ss->h, HASH_LEN, in, out, TAG_LEN, out + len);
+    if (ret == 0) {
+        mix_hash(ss, out, len + TAG_LEN);
+    }
+    return ret;
+}
+
+/* -------------- Socket I/O -------------- */
+
+/**
+ * @brief Bound blocking reads and writes on a socket
+ */
+static void set_sock_timeout(int sock, int64_t us) {
+    // lwIP keeps socket timeouts in whole milliseconds and takes 0 as no
+    // timeout at all, so the last fraction is rounded up
+    us = (us + 999) / 1000 * 1000;
+    struct timeval tv = { .tv_sec = us / 1000000, .tv_usec = us % 1000000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+/**
+ * @brief Receive exactly len bytes before a deadline
+ *
+ * Each recv() is limited to the time left.
+ *
+ * @return len, 0 if the peer closed before the first byte, -errno otherwise
+ */
+static int recv_all(int sock, uint8_t *buf, size_t len, int64_t deadline) {
+    size_t got = 0;
+    while (got < len) {
+        int64_t left = deadline - esp_timer_get_time();
+        if (left <= 0) {
+            return -ETIMEDOUT;
+        }
+        set_sock_timeout(sock, left);
+        int ret = recv(sock, buf + got, len - got, 0);
+        if (ret == 0) {
+            return got == 0 ? 0 : -ECONNRESET;
+        }
+        if (ret < 0) {
+            return -errno;
+        }
+        got += ret;
+    }
+    return (int)len;
+}
+
+/**
+ * @brief Receive the rest of the incoming message without blocking
+ *
+ * Takes only what the socket already holds, so a client that stops in
+ * the middle of a message can't stall the main loop; the next call goes
+ * on where this one left off.
+ *
+ * @return Message length once it is all in rx_buf, -EAGAIN while more is
+ *         to come, 0 if the peer closed between messages, other negative
+ *         error code otherwise
+ */
+static int recv_message(noise_session_t *session) {
+    while (1) {
+        uint8_t *dst;
+        size_t want;
+        if (session->rx_have < LEN_PREFIX) {
+            dst = session->rx_prefix + session->rx_have;
+            want = LEN_PREFIX - session->rx_have;
+        } else {
+            size_t got = session->rx_have - LEN_PREFIX;
+            if (got == session->rx_msg_len) {
+                session->rx_have = 0;
+                return (int)session->rx_msg_len;
+            }
+            dst = session->rx_buf + got;
+            want = session->rx_msg_len - got;
+        }
+
+        int ret = recv(session->sock, dst, want, MSG_DONTWAIT);
+        if (ret == 0) {
+            return session->rx_have == 0 ? 0 : -ECONNRESET;
+        }
+        if (ret < 0) {
+            return (errno == EWOULDBLOCK) ? -EAGAIN : -errno;
+        }
+        session->rx_have += ret;
+
+        if (session->rx_have == LEN_PREFIX) {
+            session->rx_msg_len = session->rx_prefix[0] << 8 | session->rx_prefix[1];
+            if (session->rx_msg_len <= TAG_LEN || session->rx_msg_len > sizeof(session->rx_buf)) {
+                ESP_LOGW(TAG, "Bad message length %u on UART%d",
+                         (unsigned)session->rx_msg_len, session->uart_port);
+                return MBEDTLS_ERR_GCM_BAD_INPUT;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Send exactly len bytes
+ *
+ * @return len, or -errno
+ */
+static int send_all(int sock, const uint8_t *buf, size_t len) {
+    size_t sent = 0;
+    while (sent < len) {
+        int ret = send(sock, buf + sent, len - sent, 0);
+        if (ret <= 0) {
+            return ret < 0 ? -errno : -ECONNRESET;
+        }
+        sent += ret;
+    }
+    return (int)len;
+}
+
+/* -------------- Handshake -------------- */
+
+/**
+ * @brief Run the IK responder handshake
+ *
+ * @return 0 on success, negative error code otherwise
+ */
+static int handshake(noise_session_t *session, int64_t deadline) {
+    symmetric_t ss;
+    uint8_t msg[LEN_PREFIX + MSG1_LEN];
+    uint8_t out_msg[LEN_PREFIX + MSG2_LEN];
+    uint8_t re[NOISE_KEY_LEN];
+    uint8_t rs[NOISE_KEY_LEN];
+    uint8_t shared[NOISE_KEY_LEN];
+    uint8_t k1[HASH_LEN], k2[HASH_LEN];
+    int64_t left;
+    mbedtls_mpi e_priv;
+    mbedtls_ecp_point e_pub;
+    size_t olen;
+
+    memset(&ss, 0, sizeof(ss));
+    mbedtls_gcm_init(&ss.gcm);
+    mbedtls_mpi_init(&e_priv);
+    mbedtls_ecp_point_init(&e_pub);
+
+    // Initialize: h = protocol name (fits in HASH_LEN), empty prologue,
+    // then the pre-message: the bridge's static key
+    memcpy(ss.h, PROTOCOL_NAME, sizeof(PROTOCOL_NAME) - 1);
+    memcpy(ss.ck, ss.h, HASH_LEN);
+    mix_hash(&ss, (const uint8_t *)"", 0);
+    mix_hash(&ss, server.s_pub, NOISE_KEY_LEN);
+
+    // <- e, es, s, ss
+    int ret = recv_all(session->sock, msg, LEN_PREFIX + MSG1_LEN, deadline);
+    if (ret == LEN_PREFIX + MSG1_LEN) {
+        ret = (msg[0] << 8 | msg[1]) == MSG1_LEN ? 0 : MBEDTLS_ERR_GCM_BAD_INPUT;
+    } else if (ret >= 0) {
+        ret = -ECONNRESET;
+    }
+    const uint8_t *body = msg + LEN_PREFIX;
+    if (ret == 0) {
+        memcpy(re, body, NOISE_KEY_LEN);
+        mix_hash(&ss, re, NOISE_KEY_LEN);
+        ret = dh(&server.s_priv, re, shared);
+    }
+    if (ret == 0) ret = mix_key(&ss, shared);
+    if (ret == 0) ret = decrypt_and_hash(&ss, body + NOISE_KEY_LEN, NOISE_KEY_LEN + TAG_LEN, rs);
+    if (ret == 0) ret = dh(&server.s_priv, rs, shared);
+    if (ret == 0) ret = mix_key(&ss, shared);
+    if (ret == 0) {
+        // Empty payload; the tag proves the client holds its static key
+        ret = decrypt_and_hash(&ss, body + 2 * NOISE_KEY_LEN + TAG_LEN, TAG_LEN, shared);
+    }
+    if (ret != 0) {
+        goto out;
+    }
+
+    session->client = find_client(rs);
+    if (!session->client) {
+        ESP_LOGW(TAG, "Unknown client key on UART%d", session->uart_port);
+        ret = MBEDTLS_ERR_GCM_AUTH_FAILED;
+        goto out;
+    }
+    if (session->client->uarts != 0 && !(session->client->uarts & (1UL << session->uart_port))) {
+        ESP_LOGW(TAG, "Client \"%s\" is not allowed on UART%d",
+                 session->client->name, session->uart_port);
+        ret = MBEDTLS_ERR_GCM_AUTH_FAILED;
+        goto out;
+    }
+
+    // -> e, ee, se
+    out_msg[0] = 0;
+    out_msg[1] = MSG2_LEN;
+    ret = mbedtls_ecdh_gen_public(&server.grp, &e_priv, &e_pub,
+                                  mbedtls_ctr_drbg_random, &server.ctr_drbg);
+    if (ret == 0) {
+        ret = mbedtls_ecp_point_write_binary(&server.grp, &e_pub, MBEDTLS_ECP_PF_UNCOMPRESSED,
+                                             &olen, out_msg + LEN_PREFIX, NOISE_KEY_LEN);
+    }
+    if (ret == 0) {
+        mix_hash(&ss, out_msg + LEN_PREFIX, NOISE_KEY_LEN);
+        ret = dh(&e_priv, re, shared);
+    }
+    if (ret == 0) ret = mix_key(&ss, shared);
+    if (ret == 0) ret = dh(&e_priv, rs, shared);
+    if (ret == 0) ret = mix_key(&ss, shared);
+    if (ret == 0) ret = encrypt_and_hash(&ss, shared, 0, out_msg + LEN_PREFIX + NOISE_KEY_LEN);
+    if (ret == 0) {
+        left = deadline - esp_timer_get_time();
+        if (left <= 0) {
+            ret = -ETIMEDOUT;
+        } else {
+            set_sock_timeout(session->sock, left);
+            ret = send_all(session->sock, out_msg, LEN_PREFIX + MSG2_LEN);
+            ret = ret < 0 ? ret : 0;
+        }
+    }
+
+    // Split: the client sends with the first key, the bridge with the second
+    if (ret == 0) ret = hkdf(ss.ck, NULL, 0, k1, k2);
+    if (ret == 0) ret = mbedtls_gcm_setkey(&session->rx, MBEDTLS_CIPHER_ID_AES, k1, 256);
+    if (ret == 0) ret = mbedtls_gcm_setkey(&session->tx, MBEDTLS_CIPHER_ID_AES, k2, 256);
+
+out:
+    mbedtls_platform_zeroize(shared, sizeof(shared));
+    mbedtls_platform_zeroize(k1, sizeof(k1));
+    mbedtls_platform_zeroize(k2, sizeof(k2));
+    mbedtls_platform_zeroize(ss.k, sizeof(ss.k));
+    mbedtls_platform_zeroize(ss.ck, sizeof(ss.ck));
+    mbedtls_gcm_free(&ss.gcm);
+    mbedtls_mpi_free(&e_priv);
+    mbedtls_ecp_point_free(&e_pub);
+    return ret;
+}
+
+/* -------------- Public API -------------- */
+
+esp_err_t noise_server_init(void) {
+    memset(&server, 0, sizeof(server));
+    mbedtls_entropy_init(&server.entropy);
+    mbedtls_ctr_drbg_init(&server.ctr_drbg);
+    mbedtls_ecp_group_init(&server.grp);
+    mbedtls_mpi_init(&server.s_priv);
+
+    int ret = mbedtls_ctr_drbg_seed(&server.ctr_drbg, mbedtls_entropy_func, &server.entropy,
+                                    (const unsigned char *)TAG, strlen(TAG));
+    if (ret == 0) {
+        ret = mbedtls_ecp_group_load(&server.grp, MBEDTLS_ECP_DP_CURVE25519);
+    }
+    if (ret != 0) {
+        ESP_LOGE(TAG, "Failed to set up X25519: -0x%04x", -ret);
+        noise_server_deinit();
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = load_static_key();
+    if (err != ESP_OK) {
+        noise_server_deinit();
+        return err;
+    }
+    load_clients();
+    if (server.client_count == 0) {
+        ESP_LOGE(TAG, "No Noise client keys configured");
+        noise_server_deinit();
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    stats.session_bytes = sizeof(noise_session_t);
+    server.ready = true;
+    ESP_LOGI(TAG, "Noise channel ready, %d client keys, %u B per session",
+             server.client_count, (unsigned)sizeof(noise_session_t));
+    return ESP_OK;
+}
+
+void noise_server_deinit(void) {
+    mbedtls_mpi_free(&server.s_priv);
+    mbedtls_ecp_group_free(&server.grp);
+    mbedtls_ctr_drbg_free(&server.ctr_drbg);
+    mbedtls_entropy_free(&server.entropy);
+    mbedtls_platform_zeroize(&server, sizeof(server));
+}
+
+noise_session_t *noise_server_accept(int sock, int uart_port) {
+    if (!server.ready) {
+        return NULL;
+    }
+
+    noise_session_t *session = calloc(1, sizeof(*session));
+    if (!session) {
+        ESP_LOGE(TAG, "Failed to allocate Noise session");
+        return NULL;
+    }
+    session->sock = sock;
+    session->uart_port = uart_port;
+    mbedtls_gcm_init(&session->rx);
+    mbedtls_gcm_init(&session->tx);
+
+    struct timeval io_timeout;
+    socklen_t optlen = sizeof(io_timeout);
+    bool restore = getsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &io_timeout, &optlen) == 0;
+
+    int64_t start = esp_timer_get_time();
+    int ret = handshake(session, start + (int64_t)CONFIG_HANDSHAKE_TIMEOUT_MS * 1000);
+
+    if (restore) {
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &io_timeout, sizeof(io_timeout));
+        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &io_timeout, sizeof(io_timeout));
+    }
+
+    if (ret != 0) {
+        ESP_LOGE(TAG, "Noise handshake failed for UART%d after %lld ms: %d", uart_port,
+                 (long long)((esp_timer_get_time() - start) / 1000), ret);
+        // The socket belongs to the caller until the handshake succeeds
+        mbedtls_gcm_free(&session->rx);
+        mbedtls_gcm_free(&session->tx);
+        free(session);
+        stats.failed++;
+        return NULL;
+    }
+
+    stats.handshakes++;
+    stats.open++;
+    ESP_LOGI(TAG, "Noise handshake completed for UART%d in %lld ms, client \"%s\"",
+             uart_port, (long long)((esp_timer_get_time() - start) / 1000),
+             session->client->name);
+    return session;
+}
+
+/* -------------- Sessions -------------- */
+
+int noise_session_read(noise_session_t *session, uint8_t *buf, size_t len) {
+    if (session->rx_off == session->rx_len) {
+        int ret = recv_message(session);
+        if (ret <= 0) {
+            return ret;
+        }
+        size_t msg_len = ret;
+
+        uint8_t iv[12];
+        make_nonce(session->rx_nonce++, iv);
+        size_t plain_len = msg_len - TAG_LEN;
+        ret = mbedtls_gcm_auth_decrypt(&session->rx, plain_len, iv, sizeof(iv), NULL, 0,
+                                       session->rx_buf + plain_len, TAG_LEN,
+                                       session->rx_buf, session->rx_buf);
+        if (ret != 0) {
+            return ret;
+        }
+        session->rx_off = 0;
+        session->rx_len = plain_len;
+    }
+
+    size_t n = session->rx_len - session->rx_off;
+    if (n > len) {
+        n = len;
+    }
+    memcpy(buf, session->rx_buf + session->rx_off, n);
+    session->rx_off += n;
+    return (int)n;
+}
+
+int noise_session_write(noise_session_t *session, const uint8_t *buf, size_t len) {
+    size_t written = 0;
+    while (written < len) {
+        size_t n = len - written;
+        if (n > CONFIG_NOISE_MAX_MESSAGE) {
+            n = CONFIG_NOISE_MAX_MESSAGE;
+        }
+        uint8_t *msg = session->tx_buf;
+        msg[0] = (uint8_t)((n + TAG_LEN) >> 8);
+        msg[1] = (uint8_t)(n + TAG_LEN);
+
+        uint8_t iv[12];
+        make_nonce(session->tx_nonce++, iv);
+        int ret = mbedtls_gcm_crypt_and_tag(&session->tx, MBEDTLS_GCM_ENCRYPT, n, iv, sizeof(iv),
+                                            NULL, 0, buf + written, msg + LEN_PREFIX,
+                                            TAG_LEN, msg + LEN_PREFIX + n);
+        if (ret == 0) {
+            ret = send_all(session->sock, msg, LEN_PREFIX + n + TAG_LEN);
+        }
+        if (ret < 0) {
+            return ret;
+        }
+        written += n;
+    }
+    return (int)written;
+}
+
+size_t noise_session_get_bytes_avail(noise_session_t *session) {
+    return session->rx_len - session->rx_off;
+}
+
+size_t noise_session_get_max_record(const noise_session_t *session) {
+    return session ? CONFIG_NOISE_MAX_MESSAGE : 0;
+}
+
+int noise_session_get_sockfd(const noise_session_t *session) {
+    return session->sock;
+}
+
+void noise_session_close(noise_session_t *session) {
+    shutdown(session->sock, SHUT_RDWR);
+    close(session->sock);
+    mbedtls_gcm_free(&session->rx);
+    mbedtls_gcm_free(&session->tx);
+    mbedtls_platform_zeroize(session, sizeof(*session));
+    free(session);
+    stats.open--;
+}
+
+void noise_server_get_stats(noise_stats_t *out) {
+    *out = stats;
+}
+
+#endif /* CONFIG_NOISE_ENABLE */
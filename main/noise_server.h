@@ -0,0 +1,135 @@
+/**
+ * @file noise_server.h
+ * @brief Noise protocol secure channel for bridge clients
+ *
+ * A lighter alternative to TLS for links where both ends are ours:
+ * Noise_IK_25519_AESGCM_SHA256. The client knows the bridge's static
+ * public key beforehand, so the handshake is one message each way and
+ * serial data can flow after a single round trip. There are no
+ * certificates and no TLS framing.
+ *
+ * Wire format: every message is a 2-byte big-endian length followed by
+ * that many bytes. The handshake messages carry empty payloads:
+ *
+ *   client -> bridge   e, es, s, ss    96 bytes
+ *   bridge -> client   e, ee, se       48 bytes
+ *
+ * After that each message is AES-256-GCM ciphertext of 1 to
+ * CONFIG_NOISE_MAX_MESSAGE bytes of serial data plus a 16-byte tag, so
+ * a message costs 18 bytes more than its payload. Nonces count up from 0
+ * in each direction; the prologue is empty.
+ *
+ * The bridge's static key and the allowed client public keys are read
+ * from text files in SPIFFS at startup. Each client key may be limited
+ * to a set of UARTs, as with TLS-PSK identities.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Length of X25519 keys */
+#define NOISE_KEY_LEN 32
+
+/** Longest client name in the client key file */
+#define NOISE_NAME_MAX 32
+
+/** Opaque Noise session for one client */
+typedef struct noise_session noise_session_t;
+
+/**
+ * @brief Noise channel counters
+ */
+typedef struct {
+    uint32_t handshakes;           // Handshakes completed
+    uint32_t failed;               // Handshakes refused or failed
+    int open;                      // Sessions currently open
+    size_t session_bytes;          // Heap held by each session (fixed)
+} noise_stats_t;
+
+/**
+ * @brief Load the static key and the allowed client keys
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if the key or the client
+ *         list is missing, other error codes on failure
+ */
+esp_err_t noise_server_init(void);
+
+/**
+ * @brief Forget the keys
+ *
+ * All sessions must have been closed first.
+ */
+void noise_server_deinit(void);
+
+/**
+ * @brief Run the responder handshake on an accepted socket
+ *
+ * Blocks until the handshake completes, fails or runs over
+ * CONFIG_HANDSHAKE_TIMEOUT_MS. On failure the socket is left open for
+ * the caller to close.
+ *
+ * @param sock Connected client socket
+ * @param uart_port UART the client connected to, matched against the
+ *                  client key's allowed UARTs
+ * @return New session, or NULL if the handshake failed
+ */
+noise_session_t *noise_server_accept(int sock, int uart_port);
+
+/**
+ * @brief Read decrypted data
+ *
+ * If no decrypted data is buffered, takes what the socket holds of the
+ * next message without blocking and decrypts it once it is complete.
+ *
+ * @return Bytes read, -EAGAIN if the next message has not fully arrived
+ *         yet, 0 if the peer closed the connection, other negative error
+ *         code (-errno or mbedTLS error) otherwise
+ */
+int noise_session_read(noise_session_t *session, uint8_t *buf, size_t len);
+
+/**
+ * @brief Encrypt and send data
+ *
+ * Data larger than CONFIG_NOISE_MAX_MESSAGE is split into several
+ * messages.
+ *
+ * @return len on success, negative error code on failure
+ */
+int noise_session_write(noise_session_t *session, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Decrypted bytes buffered from the current message
+ */
+size_t noise_session_get_bytes_avail(noise_session_t *session);
+
+/**
+ * @brief Largest payload of one message, 0 for a NULL session
+ */
+size_t noise_session_get_max_record(const noise_session_t *session);
+
+/**
+ * @brief Socket underlying a session
+ */
+int noise_session_get_sockfd(const noise_session_t *session);
+
+/**
+ * @brief Close the socket and free the session
+ */
+void noise_session_close(noise_session_t *session);
+
+/**
+ * @brief Get counters for the diagnostics report
+ */
+void noise_server_get_stats(noise_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
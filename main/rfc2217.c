@@ -0,0 +1,804 @@
+/*
+ * rfc2217.c
+ *
+ * Telnet (RFC 854) option negotiation and the COM-PORT-OPTION (RFC 2217)
+ * for UART bridges.
+ *
+ * The parser runs in place on the TCP receive buffer: payload bytes are
+ * compacted towards the start of the buffer while commands are executed,
+ * so no extra copy is needed. Parser state is kept per bridge, so commands
+ * split across TCP reads are handled. Replies are collected in a small
+ * per-bridge buffer and sent once per call.
+ *
+ * Thread safety: None. All functions must be called from the main loop.
+ */
+
+#include "rfc2217.h"
+#include "driver/uart.h"
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include <string.h>
+#include <inttypes.h>
+
+static const char *TAG = "RFC2217";
+
+/* Telnet commands (RFC 854) */
+#define TN_SE    240
+#define TN_BRK   243
+#define TN_IP    244
+#define TN_AO    245
+#define TN_SB    250
+#define TN_WILL  251
+#define TN_WONT  252
+#define TN_DO    253
+#define TN_DONT  254
+#define TN_IAC   255
+
+/* Telnet options */
+#define TN_OPT_BINARY    0
+#define TN_OPT_SGA       3
+#define TN_OPT_COM_PORT  44
+
+/* COM-PORT-OPTION commands from the client; replies add CPO_SERVER_OFFSET */
+#define CPO_SIGNATURE            0
+#define CPO_SET_BAUDRATE         1
+#define CPO_SET_DATASIZE         2
+#define CPO_SET_PARITY           3
+#define CPO_SET_STOPSIZE         4
+#define CPO_SET_CONTROL          5
+#define CPO_NOTIFY_LINESTATE     6
+#define CPO_NOTIFY_MODEMSTATE    7
+#define CPO_FLOWCONTROL_SUSPEND  8
+#define CPO_FLOWCONTROL_RESUME   9
+#define CPO_SET_LINESTATE_MASK   10
+#define CPO_SET_MODEMSTATE_MASK  11
+#define CPO_PURGE_DATA           12
+#define CPO_SERVER_OFFSET        100
+
+/* SET-CONTROL values */
+#define CTL_FLOW_REQUEST     0
+#define CTL_FLOW_NONE        1
+#define CTL_FLOW_XONXOFF     2
+#define CTL_FLOW_HARDWARE    3
+#define CTL_BREAK_REQUEST    4
+#define CTL_BREAK_ON         5
+#define CTL_BREAK_OFF        6
+#define CTL_DTR_REQUEST      7
+#define CTL_DTR_ON           8
+#define CTL_DTR_OFF          9
+#define CTL_RTS_REQUEST      10
+#define CTL_RTS_ON           11
+#define CTL_RTS_OFF          12
+#define CTL_INFLOW_REQUEST   13
+#define CTL_INFLOW_NONE      14
+#define CTL_INFLOW_XONXOFF   15
+#define CTL_INFLOW_HARDWARE  16
+
+/* SET-PARITY values */
+#define PARITY_NONE  1
+#define PARITY_ODD   2
+#define PARITY_EVEN  3
+
+/* SET-STOPSIZE values */
+#define STOPSIZE_1    1
+#define STOPSIZE_2    2
+#define STOPSIZE_1_5  3
+
+/* PURGE-DATA values */
+#define PURGE_RX    1
+#define PURGE_TX    2
+#define PURGE_BOTH  3
+
+/* NOTIFY-MODEMSTATE bits */
+#define MODEMSTATE_CTS  0x10
+
+/** Signature reported to clients that ask for it */
+#define RFC2217_SIGNATURE "Secure Super Cereal Tap"
+
+/** Longest subnegotiation kept; the rest is discarded */
+#define RFC2217_SB_MAX 32
+
+/** Longest value sent in a single COM-PORT-OPTION reply */
+#define RFC2217_VALUE_MAX 24
+
+/** Size of the per-bridge reply buffer */
+#define RFC2217_REPLY_MAX 96
+
+/** Options we agree to enable on our side (DO from the client) */
+#define LOCAL_OPTIONS   (OPT_BINARY | OPT_SGA)
+
+/** Options we let the client enable on its side (WILL from the client) */
+#define REMOTE_OPTIONS  (OPT_BINARY | OPT_SGA | OPT_COM_PORT)
+
+/* Option state bits */
+#define OPT_BINARY    0x01
+#define OPT_SGA       0x02
+#define OPT_COM_PORT  0x04
+
+/**
+ * @brief Telnet parser states
+ */
+typedef enum {
+    TN_STATE_DATA = 0,     // Payload
+    TN_STATE_IAC,          // After IAC
+    TN_STATE_OPTION,       // After IAC WILL/WONT/DO/DONT, waiting for the option
+    TN_STATE_SB,           // Inside a subnegotiation
+    TN_STATE_SB_IAC,       // After IAC inside a subnegotiation
+} tn_state_t;
+
+/**
+ * @brief Telnet session state for one bridge
+ */
+typedef struct {
+    tn_state_t state;
+    uint8_t verb;                    // Negotiation verb awaiting its option
+    uint8_t sb[RFC2217_SB_MAX];      // Subnegotiation being collected
+    size_t sb_len;
+    uint8_t reply[RFC2217_REPLY_MAX]; // Replies not yet sent
+    size_t reply_len;
+    uint8_t local_opts;              // OPT_* enabled on our side
+    uint8_t remote_opts;             // OPT_* enabled on the client's side
+    bool suspended;                  // Client sent FLOWCONTROL-SUSPEND
+    bool dtr;                        // DTR asserted by the client
+    bool rts;                        // RTS asserted by the client
+    bool brk;                        // Break in progress
+    bool line_changed;               // Line settings differ from the saved ones
+    uart_flow_config_t saved_flow;   // Flow control when the client connected
+    uart_bridge_t *bridge;           // Bridge being processed
+    rfc2217_send_fn send;            // Reply sender for the current call
+} rfc2217_session_t;
+
+static rfc2217_session_t sessions[CONFIG_AVAILABLE_BRIDGE_UARTS];
+
+/**
+ * @brief Find the session of a bridge
+ *
+ * @param bridge Bridge instance
+ * @return Session, or NULL if the bridge is not part of the bridge table
+ */
+static rfc2217_session_t *get_session(uart_bridge_t *bridge) {
+    int idx = bridge - uart_manager_get_instances();
+    if (idx < 0 || idx >= CONFIG_AVAILABLE_BRIDGE_UARTS) {
+        return NULL;
+    }
+    return &sessions[idx];
+}
+
+/* -------------- Replies -------------- */
+
+/**
+ * @brief Send all collected replies to the client
+ */
+static void flush_replies(rfc2217_session_t *s) {
+    if (s->reply_len > 0 && s->send) {
+        s->send(s->bridge, s->reply, s->reply_len);
+    }
+    s->reply_len = 0;
+}
+
+/**
+ * @brief Append raw bytes to the reply buffer
+ */
+static void add_reply(rfc2217_session_t *s, const uint8_t *data, size_t len) {
+    if (s->reply_len + len > sizeof(s->reply)) {
+        flush_replies(s);
+    }
+    memcpy(s->reply + s->reply_len, data, len);
+    s->reply_len += len;
+}
+
+/**
+ * @brief Queue an option negotiation reply (IAC verb option)
+ */
+static void reply_option(rfc2217_session_t *s, uint8_t verb, uint8_t opt) {
+    uint8_t msg[3] = { TN_IAC, verb, opt };
+    add_reply(s, msg, sizeof(msg));
+}
+
+/**
+ * @brief Queue a COM-PORT-OPTION reply, escaping IAC in the value
+ *
+ * @param s Session
+ * @param cmd Client command being answered
+ * @param value Value bytes
+ * @param len Number of value bytes (truncated to RFC2217_VALUE_MAX)
+ */
+static void reply_com_port(rfc2217_session_t *s, uint8_t cmd, const uint8_t *value, size_t len) {
+    uint8_t msg[6 + 2 * RFC2217_VALUE_MAX];
+    size_t n = 0;
+
+    if (len > RFC2217_VALUE_MAX) {
+        len = RFC2217_VALUE_MAX;
+    }
+
+    msg[n++] = TN_IAC;
+    msg[n++] = TN_SB;
+    msg[n++] = TN_OPT_COM_PORT;
+    msg[n++] = cmd + CPO_SERVER_OFFSET;
+    for (size_t i = 0; i < len; i++) {
+        msg[n++] = value[i];
+        if (value[i] == TN_IAC) {
+            msg[n++] = TN_IAC;
+        }
+    }
+    msg[n++] = TN_IAC;
+    msg[n++] = TN_SE;
+
+    add_reply(s, msg, n);
+}
+
+/* -------------- Option Negotiation -------------- */
+
+/**
+ * @brief Map a Telnet option to its state bit
+ *
+ * @return OPT_* bit, or 0 for unsupported options
+ */
+static uint8_t option_bit(uint8_t opt) {
+    switch (opt) {
+        case TN_OPT_BINARY:   return OPT_BINARY;
+        case TN_OPT_SGA:      return OPT_SGA;
+        case TN_OPT_COM_PORT: return OPT_COM_PORT;
+        default:              return 0;
+    }
+}
+
+/**
+ * @brief Answer a WILL/WONT/DO/DONT request
+ *
+ * Only replies when the option state actually changes, or to refuse an
+ * unsupported option, so negotiation cannot loop (RFC 854).
+ */
+static void handle_negotiation(rfc2217_session_t *s, uint8_t verb, uint8_t opt) {
+    uint8_t bit = option_bit(opt);
+
+    switch (verb) {
+        case TN_WILL:
+            if (bit & REMOTE_OPTIONS) {
+                if (!(s->remote_opts & bit)) {
+                    s->remote_opts |= bit;
+                    reply_option(s, TN_DO, opt);
+                }
+            } else {
+                reply_option(s, TN_DONT, opt);
+            }
+            break;
+
+        case TN_WONT:
+            if (s->remote_opts & bit) {
+                s->remote_opts &= ~bit;
+                reply_option(s, TN_DONT, opt);
+            }
+            break;
+
+        case TN_DO:
+            if (bit & LOCAL_OPTIONS) {
+                if (!(s->local_opts & bit)) {
+                    s->local_opts |= bit;
+                    reply_option(s, TN_WILL, opt);
+                }
+            } else {
+                reply_option(s, TN_WONT, opt);
+            }
+            break;
+
+        case TN_DONT:
+            if (s->local_opts & bit) {
+                s->local_opts &= ~bit;
+                reply_option(s, TN_WONT, opt);
+            }
+            break;
+    }
+}
+
+/* -------------- COM Port Control -------------- */
+
+/**
+ * @brief Current flow control as a SET-CONTROL value
+ *
+ * @param bridge Bridge instance
+ * @param inbound Report the inbound (CTL_INFLOW_*) value instead
+ */
+static uint8_t flow_control_state(const uart_bridge_t *bridge, bool inbound) {
+    uint8_t code = CTL_FLOW_NONE;
+    if (bridge->flow.sw_flow) {
+        code = CTL_FLOW_XONXOFF;
+    } else if (bridge->flow.flow_ctrl != UART_HW_FLOWCTRL_DISABLE) {
+        code = CTL_FLOW_HARDWARE;
+    }
+    return inbound ? code + (CTL_INFLOW_NONE - CTL_FLOW_NONE) : code;
+}
+
+/**
+ * @brief Apply a SET-CONTROL flow control request
+ *
+ * Inbound and outbound flow control are not independent on this hardware,
+ * so both directions change together. Hardware flow control uses whichever
+ * of the RTS/CTS pins are configured.
+ *
+ * @param s Session
+ * @param code CTL_FLOW_NONE, CTL_FLOW_XONXOFF or CTL_FLOW_HARDWARE
+ */
+static void set_flow_control(rfc2217_session_t *s, uint8_t code) {
+    uart_bridge_t *bridge = s->bridge;
+    uart_flow_config_t cfg = bridge->flow;
+
+    cfg.sw_flow = (code == CTL_FLOW_XONXOFF);
+    cfg.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    if (code == CTL_FLOW_HARDWARE) {
+        if (cfg.rts_pin >= 0) {
+            cfg.flow_ctrl |= UART_HW_FLOWCTRL_RTS;
+        }
+        if (cfg.cts_pin >= 0) {
+            cfg.flow_ctrl |= UART_HW_FLOWCTRL_CTS;
+        }
+        if (cfg.flow_ctrl == UART_HW_FLOWCTRL_DISABLE) {
+            ESP_LOGW(TAG, "UART%d hardware flow control requested but no RTS/CTS pins", bridge->uart_port);
+            return;
+        }
+    }
+
+    if (uart_set_flow_control(bridge, &cfg) == ESP_OK) {
+        s->line_changed = true;
+    }
+}
+
+/**
+ * @brief Execute a SET-CONTROL request
+ *
+ * @param s Session
+ * @param value Requested control value
+ * @return Value to report back to the client
+ */
+static uint8_t handle_set_control(rfc2217_session_t *s, uint8_t value) {
+    uart_bridge_t *bridge = s->bridge;
+
+    switch (value) {
+        case CTL_FLOW_NONE:
+        case CTL_FLOW_XONXOFF:
+        case CTL_FLOW_HARDWARE:
+            set_flow_control(s, value);
+            return flow_control_state(bridge, false);
+        case CTL_FLOW_REQUEST:
+            return flow_control_state(bridge, false);
+
+        case CTL_INFLOW_NONE:
+        case CTL_INFLOW_XONXOFF:
+        case CTL_INFLOW_HARDWARE:
+            set_flow_control(s, value - (CTL_INFLOW_NONE - CTL_FLOW_NONE));
+            return flow_control_state(bridge, true);
+        case CTL_INFLOW_REQUEST:
+            return flow_control_state(bridge, true);
+
+        case CTL_BREAK_ON:
+        case CTL_BREAK_OFF:
+            if (uart_set_break(bridge, value == CTL_BREAK_ON) == ESP_OK) {
+                s->brk = (value == CTL_BREAK_ON);
+            }
+            return s->brk ? CTL_BREAK_ON : CTL_BREAK_OFF;
+        case CTL_BREAK_REQUEST:
+            return s->brk ? CTL_BREAK_ON : CTL_BREAK_OFF;
+
+        case CTL_DTR_ON:
+        case CTL_DTR_OFF:
+            if (uart_set_dtr(bridge, value == CTL_DTR_ON) == ESP_OK) {
+                s->dtr = (value == CTL_DTR_ON);
+            }
+            return s->dtr ? CTL_DTR_ON : CTL_DTR_OFF;
+        case CTL_DTR_REQUEST:
+            return s->dtr ? CTL_DTR_ON : CTL_DTR_OFF;
+
+        case CTL_RTS_ON:
+        case CTL_RTS_OFF:
+            if (uart_set_rts_line(bridge, value == CTL_RTS_ON) == ESP_OK) {
+                s->rts = (value == CTL_RTS_ON);
+            }
+            return s->rts ? CTL_RTS_ON : CTL_RTS_OFF;
+        case CTL_RTS_REQUEST:
+            return s->rts ? CTL_RTS_ON : CTL_RTS_OFF;
+
+        default:
+            // DCD/DSR flow control and other values are not supported
+            return value;
+    }
+}
+
+/**
+ * @brief Current modem line state as a NOTIFY-MODEMSTATE value
+ */
+static uint8_t modem_state(const uart_bridge_t *bridge) {
+    uint8_t state = 0;
+    // CTS is active low on the pin
+    if (bridge->flow.cts_pin >= 0 && gpio_get_level(bridge->flow.cts_pin) == 0) {
+        state |= MODEMSTATE_CTS;
+    }
+    return state;
+}
+
+/**
+ * @brief Execute a COM-PORT-OPTION subnegotiation
+ *
+ * Every setting request is answered with the value actually in effect
+ * afterwards, so clients can tell when a request was not honoured.
+ *
+ * @param s Session
+ * @param data Command byte followed by its value
+ * @param len Number of bytes in data
+ */
+static void handle_com_port(rfc2217_session_t *s, const uint8_t *data, size_t len) {
+    if (len < 1) {
+        return;
+    }
+
+    uart_bridge_t *bridge = s->bridge;
+    int port = bridge->uart_port;
+    uint8_t cmd = data[0];
+    const uint8_t *arg = data + 1;
+    size_t arg_len = len - 1;
+
+    switch (cmd) {
+        case CPO_SIGNATURE:
+            if (arg_len == 0) {
+                reply_com_port(s, cmd, (const uint8_t *)RFC2217_SIGNATURE, strlen(RFC2217_SIGNATURE));
+            } else {
+                ESP_LOGI(TAG, "UART%d client signature: %.*s", port, (int)arg_len, (const char *)arg);
+            }
+            break;
+
+        case CPO_SET_BAUDRATE: {
+            if (arg_len < 4) {
+                break;
+            }
+            uint32_t baud = ((uint32_t)arg[0] << 24) | ((uint32_t)arg[1] << 16) |
+                            ((uint32_t)arg[2] << 8) | arg[3];
+            if (baud != 0) {
+                if (uart_set_baudrate(port, baud) == ESP_OK) {
+                    s->line_changed = true;
+                    ESP_LOGI(TAG, "UART%d baud rate set to %" PRIu32, port, baud);
+                } else {
+                    ESP_LOGW(TAG, "UART%d rejected baud rate %" PRIu32, port, baud);
+                }
+            }
+            uint32_t actual = 0;
+            uart_get_baudrate(port, &actual);
+            uint8_t value[4] = { actual >> 24, actual >> 16, actual >> 8, actual };
+            reply_com_port(s, cmd, value, sizeof(value));
+            break;
+        }
+
+        case CPO_SET_DATASIZE: {
+            if (arg_len < 1) {
+                break;
+            }
+            if (arg[0] >= 5 && arg[0] <= 8 &&
+                uart_set_word_length(port, UART_DATA_5_BITS + (arg[0] - 5)) == ESP_OK) {
+                s->line_changed = true;
+            }
+            uart_word_length_t bits = UART_DATA_8_BITS;
+            uart_get_word_length(port, &bits);
+            uint8_t value = 5 + (bits - UART_DATA_5_BITS);
+            reply_com_port(s, cmd, &value, 1);
+            break;
+        }
+
+        case CPO_SET_PARITY: {
+            if (arg_len < 1) {
+                break;
+            }
+            // Mark and space parity are not supported by the hardware
+            uart_parity_t parity = UART_PARITY_DISABLE;
+            bool valid = true;
+            switch (arg[0]) {
+                case PARITY_NONE: parity = UART_PARITY_DISABLE; break;
+                case PARITY_ODD:  parity = UART_PARITY_ODD; break;
+                case PARITY_EVEN: parity = UART_PARITY_EVEN; break;
+                default:          valid = false; break;
+            }
+            if (valid && uart_set_parity(port, parity) == ESP_OK) {
+                s->line_changed = true;
+            }
+            uart_get_parity(port, &parity);
+            uint8_t value = parity == UART_PARITY_ODD ? PARITY_ODD :
+                            parity == UART_PARITY_EVEN ? PARITY_EVEN : PARITY_NONE;
+            reply_com_port(s, cmd, &value, 1);
+            break;
+        }
+
+        case CPO_SET_STOPSIZE: {
+            if (arg_len < 1) {
+                break;
+            }
+            uart_stop_bits_t stop = UART_STOP_BITS_1;
+            bool valid = true;
+            switch (arg[0]) {
+                case STOPSIZE_1:   stop = UART_STOP_BITS_1; break;
+                case STOPSIZE_2:   stop = UART_STOP_BITS_2; break;
+                case STOPSIZE_1_5: stop = UART_STOP_BITS_1_5; break;
+                default:           valid = false; break;
+            }
+            if (valid && uart_set_stop_bits(port, stop) == ESP_OK) {
+                s->line_changed = true;
+            }
+            uart_get_stop_bits(port, &stop);
+            uint8_t value = stop == UART_STOP_BITS_2 ? STOPSIZE_2 :
+                            stop == UART_STOP_BITS_1_5 ? STOPSIZE_1_5 : STOPSIZE_1;
+            reply_com_port(s, cmd, &value, 1);
+            break;
+        }
+
+        case CPO_SET_CONTROL: {
+            if (arg_len < 1) {
+                break;
+            }
+            uint8_t value = handle_set_control(s, arg[0]);
+            reply_com_port(s, cmd, &value, 1);
+            break;
+        }
+
+        case CPO_NOTIFY_LINESTATE: {
+            uint8_t value = 0;
+            reply_com_port(s, cmd, &value, 1);
+            break;
+        }
+
+        case CPO_NOTIFY_MODEMSTATE: {
+            uint8_t value = modem_state(bridge);
+            reply_com_port(s, cmd, &value, 1);
+            break;
+        }
+
+        case CPO_FLOWCONTROL_SUSPEND:
+            s->suspended = true;
+            break;
+
+        case CPO_FLOWCONTROL_RESUME:
+            s->suspended = false;
+            break;
+
+        case CPO_SET_LINESTATE_MASK:
+        case CPO_SET_MODEMSTATE_MASK:
+            // State changes are not notified; acknowledge the mask
+            if (arg_len >= 1) {
+                reply_com_port(s, cmd, arg, 1);
+            }
+            break;
+
+        case CPO_PURGE_DATA:
+            if (arg_len < 1) {
+                break;
+            }
+            if (arg[0] == PURGE_TX || arg[0] == PURGE_BOTH) {
+                uart_flush_tx(bridge);
+            }
+            if (arg[0] == PURGE_RX || arg[0] == PURGE_BOTH) {
+                uart_flush_rx(bridge);
+            }
+            reply_com_port(s, cmd, arg, 1);
+            break;
+
+        default:
+            ESP_LOGD(TAG, "UART%d unknown COM-PORT-OPTION command %u", port, cmd);
+            break;
+    }
+}
+
+/**
+ * @brief Execute an urgent Telnet command
+ *
+ * Data still queued for the target is discarded first, so the interrupt
+ * character or break reaches it without waiting behind a large paste.
+ * That includes payload that arrived ahead of the command in the same
+ * read, which is counted as discarded too. Payload after the command is
+ * forwarded as usual.
+ *
+ * @param s Session
+ * @param cmd TN_IP or TN_BRK
+ * @param dropped Payload bytes ahead of the command that are not forwarded
+ */
+static void handle_urgent(rfc2217_session_t *s, uint8_t cmd, int dropped) {
+    uart_bridge_t *bridge = s->bridge;
+
+    uart_flush_tx(bridge);
+    bridge->line_stats.tx_discarded += dropped;
+    if (cmd == TN_IP) {
+        uint8_t c = CONFIG_RFC2217_INTERRUPT_CHAR;
+        uart_write_urgent(bridge, &c, 1);
+    } else if (cmd == TN_BRK) {
+        uart_send_break(bridge, CONFIG_RFC2217_BREAK_MS);
+    }
+
+    ESP_LOGI(TAG, "UART%d urgent %s, %d bytes of payload ahead of it dropped", bridge->uart_port,
+             cmd == TN_IP ? "interrupt" : "break", dropped);
+}
+
+/**
+ * @brief Execute Telnet Abort Output
+ *
+ * RFC 854 AO discards output on its way to the user, here the client:
+ * data received from the target and not yet forwarded is dropped. Data
+ * for the target is left alone.
+ *
+ * @param s Session
+ */
+static void handle_abort_output(rfc2217_session_t *s) {
+    size_t dropped = uart_flush_rx(s->bridge);
+    ESP_LOGI(TAG, "UART%d abort output, %u bytes for the client dropped",
+             s->bridge->uart_port, (unsigned)dropped);
+}
+
+/**
+ * @brief Handle a completed subnegotiation
+ */
+static void handle_subnegotiation(rfc2217_session_t *s) {
+    if (s->sb_len >= 1 && s->sb[0] == TN_OPT_COM_PORT) {
+        handle_com_port(s, s->sb + 1, s->sb_len - 1);
+    }
+}
+
+/* -------------- Public API -------------- */
+
+void rfc2217_begin(uart_bridge_t *bridge) {
+    rfc2217_session_t *s = get_session(bridge);
+    if (!bridge->rfc2217 || !s) {
+        return;
+    }
+
+    memset(s, 0, sizeof(*s));
+    s->state = TN_STATE_DATA;
+    s->saved_flow = bridge->flow;
+}
+
+void rfc2217_end(uart_bridge_t *bridge) {
+    rfc2217_session_t *s = get_session(bridge);
+    if (!bridge->rfc2217 || !s) {
+        return;
+    }
+
+    // Don't leave the target held in reset or in a break
+    if (s->brk) {
+        uart_set_break(bridge, false);
+    }
+    if (s->dtr) {
+        uart_set_dtr(bridge, false);
+    }
+    if (s->rts) {
+        uart_set_rts_line(bridge, false);
+    }
+
+    if (s->line_changed) {
+        int port = bridge->uart_port;
+        uart_set_baudrate(port, bridge->baud_rate);
+        uart_set_word_length(port, UART_DATA_8_BITS);
+        uart_set_parity(port, UART_PARITY_DISABLE);
+        uart_set_stop_bits(port, UART_STOP_BITS_1);
+        uart_set_flow_control(bridge, &s->saved_flow);
+        ESP_LOGI(TAG, "UART%d line settings restored", port);
+    }
+
+    memset(s, 0, sizeof(*s));
+}
+
+int UART_HOT_ATTR rfc2217_process(uart_bridge_t *bridge, uint8_t *buf, int len, rfc2217_send_fn send) {
+    rfc2217_session_t *s = get_session(bridge);
+    if (!bridge->rfc2217 || !s || len <= 0) {
+        return len;
+    }
+
+    // Fast path: plain payload with no command in it
+    if (s->state == TN_STATE_DATA && !memchr(buf, TN_IAC, len)) {
+        return len;
+    }
+
+    s->bridge = bridge;
+    s->send = send;
+
+    // A failed reply disconnects the client and ends the session, which
+    // clears send; stop parsing then
+    int out = 0;
+    for (int i = 0; i < len && s->send; i++) {
+        uint8_t c = buf[i];
+
+        switch (s->state) {
+            case TN_STATE_DATA:
+                if (c == TN_IAC) {
+                    s->state = TN_STATE_IAC;
+                } else {
+                    buf[out++] = c;
+                }
+                break;
+
+            case TN_STATE_IAC:
+                if (c == TN_IAC) {
+                    // Escaped 0xFF data byte
+                    buf[out++] = c;
+                    s->state = TN_STATE_DATA;
+                } else if (c >= TN_WILL && c <= TN_DONT) {
+                    s->verb = c;
+                    s->state = TN_STATE_OPTION;
+                } else if (c == TN_SB) {
+                    s->sb_len = 0;
+                    s->state = TN_STATE_SB;
+                } else if (c == TN_IP || c == TN_BRK) {
+                    // Payload before the command is dropped along with the
+                    // data already queued for the target
+                    handle_urgent(s, c, out);
+                    out = 0;
+                    s->state = TN_STATE_DATA;
+                } else if (c == TN_AO) {
+                    handle_abort_output(s);
+                    s->state = TN_STATE_DATA;
+                } else {
+                    // NOP, GA and other commands have no effect on a serial port
+                    s->state = TN_STATE_DATA;
+                }
+                break;
+
+            case TN_STATE_OPTION:
+                handle_negotiation(s, s->verb, c);
+                s->state = TN_STATE_DATA;
+                break;
+
+            case TN_STATE_SB:
+                if (c == TN_IAC) {
+                    s->state = TN_STATE_SB_IAC;
+                } else if (s->sb_len < sizeof(s->sb)) {
+                    s->sb[s->sb_len++] = c;
+                }
+                break;
+
+            case TN_STATE_SB_IAC:
+                if (c == TN_SE) {
+                    handle_subnegotiation(s);
+                    s->state = TN_STATE_DATA;
+                } else if (c == TN_IAC) {
+                    if (s->sb_len < sizeof(s->sb)) {
+                        s->sb[s->sb_len++] = c;
+                    }
+                    s->state = TN_STATE_SB;
+                } else {
+                    // Malformed subnegotiation; drop it
+                    s->state = TN_STATE_DATA;
+                }
+                break;
+        }
+    }
+
+    flush_replies(s);
+    s->send = NULL;
+    return out;
+}
+
+int UART_HOT_ATTR rfc2217_escape(uart_bridge_t *bridge, uint8_t *buf, int len) {
+    if (!bridge->rfc2217 || len <= 0) {
+        return len;
+    }
+
+    const uint8_t *first = memchr(buf, TN_IAC, len);
+    if (!first) {
+        return len;
+    }
+
+    int extra = 0;
+    for (int i = first - buf; i < len; i++) {
+        extra += (buf[i] == TN_IAC);
+    }
+
+    // Expand from the end so nothing is overwritten before it is moved
+    int total = len + extra;
+    int j = total;
+    for (int i = len - 1; extra > 0; i--) {
+        buf[--j] = buf[i];
+        if (buf[i] == TN_IAC) {
+            buf[--j] = TN_IAC;
+            extra--;
+        }
+    }
+
+    return total;
+}
+
+bool rfc2217_is_suspended(uart_bridge_t *bridge) {
+    rfc2217_session_t *s = get_session(bridge);
+    return bridge->rfc2217 && s && s->suspended;
+}
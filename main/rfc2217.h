@@ -0,0 +1,86 @@
+/**
+ * @file rfc2217.h
+ * @brief Telnet COM port control (RFC 2217) for UART bridges
+ *
+ * Lets clients such as pyserial's rfc2217:// and esptool change the baud
+ * rate, framing, flow control and modem lines of a bridge at runtime.
+ * Telnet commands are stripped from the TCP → UART stream in place, and
+ * 0xFF bytes in the UART → TCP stream are escaped as IAC IAC.
+ *
+ * Only bridges with CONFIG_UARTx_RFC2217 enabled speak Telnet; for all
+ * others these functions pass data through unchanged.
+ */
+
+#pragma once
+
+#include "uart_manager.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Function used to send Telnet replies to the bridge's client
+ *
+ * @param bridge Bridge whose client should receive the data
+ * @param data Data to send
+ * @param len Number of bytes
+ * @return Number of bytes sent, or -1 on error
+ */
+typedef int (*rfc2217_send_fn)(uart_bridge_t *bridge, const uint8_t *data, size_t len);
+
+/**
+ * @brief Start a Telnet session for a newly connected client
+ *
+ * Resets the parser and option state and remembers the bridge's current
+ * line settings so they can be restored by rfc2217_end().
+ *
+ * @param bridge Bridge the client connected to
+ */
+void rfc2217_begin(uart_bridge_t *bridge);
+
+/**
+ * @brief End the Telnet session when the client disconnects
+ *
+ * Restores the line settings saved by rfc2217_begin() and releases DTR,
+ * RTS and any break the client left asserted.
+ *
+ * @param bridge Bridge whose client disconnected
+ */
+void rfc2217_end(uart_bridge_t *bridge);
+
+/**
+ * @brief Process data received from the client
+ *
+ * Executes Telnet commands and COM port requests found in the data and
+ * compacts the remaining payload in place. Replies are sent with send.
+ * Commands split across calls are handled.
+ *
+ * @param bridge Bridge the data was received on
+ * @param buf Received data, compacted in place
+ * @param len Number of bytes in buf
+ * @param send Function used to send replies
+ * @return Number of payload bytes left in buf for the UART
+ */
+int rfc2217_process(uart_bridge_t *bridge, uint8_t *buf, int len, rfc2217_send_fn send);
+
+/**
+ * @brief Escape data read from the UART for the client
+ *
+ * Doubles every 0xFF byte in place. buf must have room for 2 * len bytes.
+ *
+ * @param bridge Bridge the data was read on
+ * @param buf Data to escape
+ * @param len Number of bytes in buf
+ * @return Number of bytes in buf after escaping
+ */
+int rfc2217_escape(uart_bridge_t *bridge, uint8_t *buf, int len);
+
+/**
+ * @brief Check whether the client asked us to stop sending data
+ *
+ * Set by FLOWCONTROL-SUSPEND and cleared by FLOWCONTROL-RESUME.
+ *
+ * @param bridge Bridge to check
+ * @return true while UART → TCP forwarding should be held
+ */
+bool rfc2217_is_suspended(uart_bridge_t *bridge);
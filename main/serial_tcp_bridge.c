@@ -17,6 +17,8 @@
 #include "wifi_manager.h"  /* WiFi connection management */
 #include "uart_manager.h"  /* UART communication handling */
 #include "tcp_server.h"    /* TCP server implementation */
+#include "diagnostics.h"   /* Boot timeline and statistics */
+#include "bridge_console.h" /* Runtime bridge configuration */
 
 /**
  * @file serial_tcp_bridge.c
@@ -27,13 +29,21 @@
  * UART devices simultaneously. Each UART is connected to its own TCP port.
  */
 
+/* SPIFFS holds the PEM files, the PSK identity file and the Noise keys */
+#if defined(CONFIG_TLS_CERT_SOURCE_SPIFFS) || defined(CONFIG_TLS_PSK_SOURCE_FILE) || \
+    defined(CONFIG_NOISE_ENABLE)
+#define USE_SPIFFS 1
+#endif
+
 /* ----------------- Global variables ----------------- */
 static const char *TAG = "SerialTCP";    // Logging tag
 
 /* ----------------- Function prototypes ----------------- */
 static void cleanup_resources(void);
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
+#if defined(CONFIG_TLS_CERT_SOURCE_SPIFFS)
 static char* load_cert_file(const char* file_path);
+#endif
+#if defined(CONFIG_SSCTE_TLS_ENABLE)
 static void free_tls_files(tcp_server_tls_config_t *cfg);
 #endif
 
@@ -44,7 +54,7 @@ static void free_tls_files(tcp_server_tls_config_t *cfg);
  * @return Pointer to null-terminated string with file contents, or NULL on error
  *         Caller must free this memory
  */
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
+#if defined(CONFIG_TLS_CERT_SOURCE_SPIFFS)
 static char* load_cert_file(const char* file_path) {
     FILE* file = fopen(file_path, "r");
     if (file == NULL) {
@@ -75,13 +85,15 @@ static char* load_cert_file(const char* file_path) {
     buffer[file_size] = '\0';
     return buffer;
 }
+#endif
 
+#if defined(CONFIG_SSCTE_TLS_ENABLE)
 /**
  * @brief Frees memory allocated for TLS certificate and key files
  *
  * Releases memory allocated for the server certificate, server key,
- * and CA certificate files, then zeros out the entire configuration
- * structure.
+ * CA certificate and client pin files, then zeros out the entire
+ * configuration structure.
  *
  * @param cfg Pointer to the TLS configuration structure
  */
@@ -89,6 +101,7 @@ static void free_tls_files(tcp_server_tls_config_t *cfg) {
     if (cfg->server_cert_pem) free((void*)cfg->server_cert_pem);
     if (cfg->server_key_pem)  free((void*)cfg->server_key_pem);
     if (cfg->ca_cert_pem)     free((void*)cfg->ca_cert_pem);
+    if (cfg->client_pins)     free((void*)cfg->client_pins);
     memset(cfg, 0, sizeof(*cfg));
 }
 #endif
@@ -105,7 +118,7 @@ static void cleanup_resources(void) {
     uart_manager_cleanup();
     wifi_cleanup();
 
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
+#if defined(USE_SPIFFS)
     esp_vfs_spiffs_unregister("spiffs");
 #endif
 
@@ -123,6 +136,7 @@ void app_main(void) {
     esp_log_level_set("esp_netif_handlers", ESP_LOG_WARN);
     esp_log_level_set("system_api", ESP_LOG_WARN);
 
+    diag_boot_begin(DIAG_BOOT_NVS_INIT);
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         ESP_LOGW(TAG, "Erasing NVS flash");
@@ -130,18 +144,21 @@ void app_main(void) {
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+    diag_boot_end(DIAG_BOOT_NVS_INIT);
 
     esp_register_shutdown_handler(cleanup_resources);
 
+    diag_boot_begin(DIAG_BOOT_WIFI_INIT);
     ESP_ERROR_CHECK(wifi_init());
+    diag_boot_end(DIAG_BOOT_WIFI_INIT);
 
     if (!wifi_wait_connected(30)) {
         ESP_LOGE(TAG, "WiFi connection failed, aborting");
         return;
     }
 
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
-    // Mount filesystem for certificates
+#if defined(USE_SPIFFS)
+    // Mount filesystem for certificates and keys
     esp_vfs_spiffs_conf_t spiffs_conf = {
         .base_path = "/spiffs",
         .partition_label = "spiffs",
@@ -149,7 +166,9 @@ void app_main(void) {
         .format_if_mount_failed = true
     };
 
+    diag_boot_begin(DIAG_BOOT_SPIFFS_MOUNT);
     ret = esp_vfs_spiffs_register(&spiffs_conf);
+    diag_boot_end(DIAG_BOOT_SPIFFS_MOUNT);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to mount SPIFFS (%s)", esp_err_to_name(ret));
         return;
@@ -157,7 +176,10 @@ void app_main(void) {
 #endif
 
     ESP_LOGI(TAG, "Initializing UART bridges");
-    if (uart_manager_init() != ESP_OK) {
+    diag_boot_begin(DIAG_BOOT_UART_INIT);
+    ret = uart_manager_init();
+    diag_boot_end(DIAG_BOOT_UART_INIT);
+    if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize UART manager, aborting");
         return;
     }
@@ -170,21 +192,48 @@ void app_main(void) {
     tcp_server_tls_config_t tls_config = {0};
     bool cert_loaded = false;
 
+#if defined(CONFIG_TLS_AUTH_PSK)
+    // PSK identities are loaded by the TLS server itself
+    ESP_LOGI(TAG, "TLS enabled with pre-shared keys");
+#elif defined(CONFIG_TLS_CERT_SOURCE_PARTITION)
+    // DER credentials are used in place from their flash partition
+#ifdef CONFIG_TLS_CLIENT_VERIFY
+    tls_config.verify_client = true;
+#endif
+    ESP_LOGI(TAG, "TLS enabled with credentials from partition \"%s\"",
+             CONFIG_TLS_CERT_PARTITION_LABEL);
+#else
+    diag_boot_begin(DIAG_BOOT_LOAD_CERT);
     tls_config.server_cert_pem = load_cert_file(CONFIG_TLS_SERVER_CERT_PATH);
+    diag_boot_end(DIAG_BOOT_LOAD_CERT);
     if (!tls_config.server_cert_pem) {
         ESP_LOGE(TAG, "Failed to load server certificate");
         goto cleanup;
     }
 
+    diag_boot_begin(DIAG_BOOT_LOAD_KEY);
     tls_config.server_key_pem = load_cert_file(CONFIG_TLS_SERVER_KEY_PATH);
+    diag_boot_end(DIAG_BOOT_LOAD_KEY);
     if (!tls_config.server_key_pem) {
         ESP_LOGE(TAG, "Failed to load server key");
         goto cleanup;
     }
 
-#ifdef CONFIG_TLS_CLIENT_VERIFY
+#if defined(CONFIG_TLS_CLIENT_VERIFY_PINNED)
     tls_config.verify_client = true;
+    diag_boot_begin(DIAG_BOOT_LOAD_CA);
+    tls_config.client_pins = load_cert_file(CONFIG_TLS_CLIENT_PINS_PATH);
+    diag_boot_end(DIAG_BOOT_LOAD_CA);
+    if (!tls_config.client_pins) {
+        ESP_LOGE(TAG, "Failed to load pinned client fingerprints");
+        goto cleanup;
+    }
+    ESP_LOGI(TAG, "TLS enabled with pinned client certificates");
+#elif defined(CONFIG_TLS_CLIENT_VERIFY)
+    tls_config.verify_client = true;
+    diag_boot_begin(DIAG_BOOT_LOAD_CA);
     tls_config.ca_cert_pem = load_cert_file(CONFIG_TLS_CA_CERT_PATH);
+    diag_boot_end(DIAG_BOOT_LOAD_CA);
     if (!tls_config.ca_cert_pem) {
         ESP_LOGE(TAG, "Failed to load CA certificate");
         goto cleanup;
@@ -195,15 +244,26 @@ void app_main(void) {
     tls_config.ca_cert_pem = NULL;
     ESP_LOGI(TAG, "TLS enabled without client verification");
 #endif
+#endif /* CONFIG_TLS_AUTH_PSK / CONFIG_TLS_CERT_SOURCE_PARTITION */
 
     cert_loaded = true;
 
-    if (tcp_server_init(&tls_config) != ESP_OK) {
+    diag_boot_begin(DIAG_BOOT_TCP_INIT);
+    ret = tcp_server_init(&tls_config);
+    diag_boot_end(DIAG_BOOT_TCP_INIT);
+    if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize TLS servers, aborting");
         goto cleanup;
     }
+
+    // The TLS server keeps its own parsed copies
+    free_tls_files(&tls_config);
+    cert_loaded = false;
 #else
-    if (tcp_server_init(NULL) != ESP_OK) {
+    diag_boot_begin(DIAG_BOOT_TCP_INIT);
+    ret = tcp_server_init(NULL);
+    diag_boot_end(DIAG_BOOT_TCP_INIT);
+    if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to initialize TCP servers, aborting");
         return;
     }
@@ -212,9 +272,27 @@ void app_main(void) {
 
     // Main processing loop
     ESP_LOGI(TAG, "Startup complete, entering main loop");
+    diag_boot_report();
+    if (diag_stall_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start stall detector");
+    }
+#if CONFIG_DIAG_FLASH_WRITE_TEST
+    if (diag_flash_test_start() != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start flash write test");
+    }
+#endif
+#if defined(CONFIG_BRIDGE_CONSOLE)
+    if (bridge_console_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start bridge console");
+    }
+#endif
     while (1) {
+        diag_loop_begin();
         tcp_handle_new_connections();
         tcp_process_data();
+        bridge_console_poll();
+        diag_loop_end();
+        diag_poll();
         vTaskDelay(pdMS_TO_TICKS(CONFIG_TASK_DELAY_MS));
     }
 
@@ -223,7 +301,9 @@ cleanup:
     if (cert_loaded) {
         free_tls_files(&tls_config);
     }
+#if defined(USE_SPIFFS)
     esp_vfs_spiffs_unregister(spiffs_conf.partition_label);
+#endif
     return;
 #endif
 }
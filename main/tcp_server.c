@@ -2,13 +2,14 @@
  * tcp_server.c
  *
  * Provides a TCP server implementation with optional mutual TLS (mTLS) support
- * for multiple UART-TCP bridges.
+ * for multiple UART-TCP bridges. Client I/O goes through the transport
+ * chosen when the client connects (see transport.h).
  *
  * Features:
  * - Multiple server instances, one per UART bridge
  * - Single client handling per server at a time
  * - Non-blocking accept/receive operations
- * - Runtime selection between secure (TLS) and plain TCP modes
+ * - Per-bridge selection between secure (TLS or Noise) and plain TCP transports
  * - Client certificate verification option (for mTLS)
  * - Proper resource management and error handling
  *
@@ -17,12 +18,18 @@
 
 #include "tcp_server.h"
 #include "uart_manager.h"
+#include "transport.h"
+#include "admission.h"
+#include "diagnostics.h"
+#include "rfc2217.h"
+#include "uart_tap.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "lwip/sockets.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <unistd.h>        // close(), shutdown()
-#include <stdlib.h>        // strdup(), free()
+#include <fcntl.h>         // fcntl(), O_NONBLOCK
 #include <netinet/tcp.h>   // TCP_NODELAY
 #include <arpa/inet.h>     // inet_ntoa_r()
 #include <string.h>
@@ -30,31 +37,37 @@
 #include "sdkconfig.h"
 
 #if defined(CONFIG_SSCTE_TLS_ENABLE)
-#include "esp_tls.h"
-#include "esp_tls_errors.h"
+#include "tls_server.h"
+#endif
+
+#if defined(CONFIG_NOISE_ENABLE)
+#include "noise_server.h"
 #endif
 
 static const char *TAG = "TCPServer";
 
 /**
- * Global flag indicating whether TLS mode is enabled for all servers.
- * When true, all TCP servers use TLS; when false, they use plain TCP.
+ * Most DMA-received bytes forwarded per bridge in one main loop pass: the
+ * whole buffer pool, so a full pool is drained without starving the other
+ * bridges behind a continuous stream.
  */
-static bool g_secure_mode = false;
+#if UART_DMA_SUPPORTED
+#define DMA_FORWARD_BUDGET (CONFIG_UART_DMA_BUF_SIZE * CONFIG_UART_DMA_BUF_COUNT)
+#else
+#define DMA_FORWARD_BUDGET CONFIG_UART_BUF_SIZE
+#endif
 
 #if defined(CONFIG_SSCTE_TLS_ENABLE)
 /**
- * Global TLS configuration copied from user input.
- * Contains certificates and keys needed for TLS operation.
- * Memory for certificates is owned by this struct and must be freed.
+ * Whether the shared TLS configuration is set up, so bridges with
+ * TLS enabled can accept clients.
  */
-static tcp_server_tls_config_t g_tls_config;
+static bool g_tls_ready = false;
+#endif
 
-/**
- * ESP-TLS server configuration structure built from our TLS config.
- * This is passed to ESP-TLS APIs for secure connection handling.
- */
-static esp_tls_cfg_server_t g_esp_tls_cfg;
+#if defined(CONFIG_NOISE_ENABLE)
+/** Whether the Noise keys are loaded, so Noise bridges can accept clients */
+static bool g_noise_ready = false;
 #endif
 
 /**
@@ -102,73 +115,214 @@ static esp_tls_cfg_server_t g_esp_tls_cfg;
 //}
 
 /**
- * @brief Free any internally-duplicated PEM buffers
+ * @brief Get the transport for clients of a bridge
  *
- * Releases memory allocated for certificate and key strings.
- * Sets all pointers to NULL to prevent use-after-free.
+ * @param bridge Pointer to the bridge
+ * @return Transport, or NULL if the bridge requires TLS or Noise and
+ *         that server is not set up (clients are never downgraded to
+ *         plain TCP)
  */
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
-static void free_tls_config(void)
+static const transport_ops_t *bridge_transport(const uart_bridge_t *bridge)
 {
-    free((void*)g_tls_config.ca_cert_pem);
-    free((void*)g_tls_config.server_cert_pem);
-    free((void*)g_tls_config.server_key_pem);
-    memset(&g_tls_config, 0, sizeof(g_tls_config));
+    if (bridge->noise) {
+#if defined(CONFIG_NOISE_ENABLE)
+        if (g_noise_ready) {
+            return &transport_noise;
+        }
+#endif
+        return NULL;
+    }
+    if (!bridge->tls) {
+        return &transport_tcp;
+    }
+#if defined(CONFIG_SSCTE_TLS_ENABLE)
+    if (g_tls_ready) {
+        return &transport_tls;
+    }
+#endif
+    return NULL;
 }
 
 /**
- * @brief Clean up TLS client connection
+ * @brief Decide whether to leave UART data waiting for a fuller record
  *
- * Closes and frees resources associated with a TLS connection.
+ * Only record-based transports (TLS, Noise) are held. Every record costs
+ * a header, a MAC and a cipher setup, so a trickle of small reads
+ * (keystroke echo, slow log output) is mostly overhead. Data stays in
+ * the UART driver until a record's worth has arrived or the oldest byte
+ * has waited CONFIG_TLS_COALESCE_MS. The wait is checked once per main
+ * loop pass, so the bound is rounded up to CONFIG_TASK_DELAY_MS.
  *
- * @param bridge Pointer to the bridge whose TLS connection should be cleaned up
+ * @param bridge Pointer to the bridge
+ * @param available Bytes waiting in the UART driver
+ * @param max_read Most that will be read in one pass
+ * @return true to skip reading the UART on this pass
  */
-static void cleanup_client_tls(uart_bridge_t *bridge)
+static bool coalesce_hold(uart_bridge_t *bridge, size_t available, size_t max_read)
 {
-    if (bridge->tls_handle) {
-        esp_tls_conn_destroy(bridge->tls_handle);
-        bridge->tls_handle = NULL;
+#if CONFIG_TLS_COALESCE_MS > 0
+    if (!bridge->conn) {
+        return false;
+    }
+    size_t target = bridge->transport->max_record(bridge->conn);
+    if (target == 0) {
+        return false;
+    }
+    if (target > CONFIG_TLS_COALESCE_BYTES) {
+        target = CONFIG_TLS_COALESCE_BYTES;
+    }
+    if (target > max_read) {
+        target = max_read;
+    }
+
+    int64_t now = esp_timer_get_time();
+    if (available < target) {
+        if (bridge->coalesce_since_us == 0) {
+            bridge->coalesce_since_us = now;
+            return true;
+        }
+        if (now - bridge->coalesce_since_us < CONFIG_TLS_COALESCE_MS * 1000) {
+            return true;
+        }
     }
+    bridge->coalesce_since_us = 0;
+#endif
+    return false;
 }
-#endif /* CONFIG_SSCTE_TLS_ENABLE */
 
 /**
  * @brief Clean up client connection resources
  *
- * Closes the client connection (TLS or plain TCP) and resets
+ * Closes the client connection through its transport and resets
  * associated fields in the bridge structure.
  *
  * @param bridge Pointer to the bridge whose client should be cleaned up
  */
 static void cleanup_client(uart_bridge_t *bridge)
 {
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
-    if (g_secure_mode && bridge->tls_handle) {
-        cleanup_client_tls(bridge);
+    diag_alloc_warmup_reset();
+    rfc2217_end(bridge);
+    if (bridge->conn) {
+        bridge->transport->close(bridge->conn);
+        bridge->conn = NULL;
     }
+    bridge->coalesce_since_us = 0;
+}
+
+/**
+ * @brief Close a refused client socket with a reset
+ *
+ * With CONFIG_LWIP_SO_LINGER the connection is aborted with RST, so it
+ * doesn't hold a PCB in TIME_WAIT; otherwise it is closed normally.
+ *
+ * @param sock Accepted client socket
+ */
+static void reset_client(int sock)
+{
+#if defined(CONFIG_LWIP_SO_LINGER)
+    struct linger lg = { .l_onoff = 1, .l_linger = 0 };
+    setsockopt(sock, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
 #endif
-    if (!g_secure_mode && bridge->client_sock >= 0) {
-        shutdown(bridge->client_sock, SHUT_RDWR);
-        close(bridge->client_sock);
+    close(sock);
+}
+
+/**
+ * @brief Open the listening socket of a bridge
+ *
+ * The second tap input has no port of its own and is skipped.
+ *
+ * @param bridge Pointer to the bridge
+ * @return ESP_OK on success, ESP_FAIL on error
+ */
+static esp_err_t open_listener(uart_bridge_t *bridge)
+{
+    if (bridge->tap && !uart_tap_is_output(bridge)) {
+        return ESP_OK;
+    }
+
+    const transport_ops_t *transport = bridge_transport(bridge);
+    if (!transport) {
+        ESP_LOGE(TAG, "UART%d requires %s but it is not set up",
+                 bridge->uart_port, bridge->noise ? "Noise" : "TLS");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Initializing %s server for UART%d on port %d",
+            transport->name, bridge->uart_port, bridge->tcp_port);
+
+    // Create listening socket
+    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "socket(): errno %d", errno);
+        return ESP_FAIL;
+    }
+
+    // Allow reuse of local address
+    int opt = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    // Set 5-second send/recv timeouts
+    struct timeval t = { .tv_sec = 5, .tv_usec = 0 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &t, sizeof(t));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &t, sizeof(t));
+
+    // Bind to all interfaces on the configured port
+    struct sockaddr_in addr = {
+        .sin_family      = AF_INET,
+        .sin_port        = htons(bridge->tcp_port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        ESP_LOGE(TAG, "bind(): errno %d", errno);
+        close(sock);
+        return ESP_FAIL;
+    }
+
+    // Listen for one connection
+    if (listen(sock, 1) < 0) {
+        ESP_LOGE(TAG, "listen(): errno %d", errno);
+        close(sock);
+        return ESP_FAIL;
     }
 
-    bridge->client_sock = -1;
+    // Poll for new clients with accept() instead of select()
+    int flags = fcntl(sock, F_GETFL, 0);
+    fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+
+    bridge->server_sock = sock;
+    bridge->transport = transport;
+    bridge->conn = NULL;
+    bridge->coalesce_since_us = 0;
+    return ESP_OK;
+}
+
+/**
+ * @brief Close the listening socket of a bridge
+ *
+ * @param bridge Pointer to the bridge
+ */
+static void close_listener(uart_bridge_t *bridge)
+{
+    if (bridge->server_sock >= 0) {
+        close(bridge->server_sock);
+        bridge->server_sock = -1;
+    }
 }
 
 /**
  * @brief Shut down all TCP servers and free all resources
  *
- * Disconnects clients, closes listening sockets, and frees TLS resources.
+ * Disconnects clients, closes listening sockets, and frees TLS and Noise
+ * resources.
  * After calling this, servers must be reinitialized before use.
  */
 void tcp_cleanup(void)
 {
     // Get all bridge instances
     uart_bridge_t *bridges = uart_manager_get_instances();
-    int num_bridges = uart_manager_get_active_count();
 
     // Clean up each bridge's TCP/TLS resources
-    for (int i = 0; i < num_bridges; i++) {
+    for (int i = 0; i < CONFIG_AVAILABLE_BRIDGE_UARTS; i++) {
         uart_bridge_t *bridge = &bridges[i];
 
         if (!bridge->enabled) {
@@ -179,17 +333,21 @@ void tcp_cleanup(void)
         cleanup_client(bridge);
 
         // Close server socket
-        if (bridge->server_sock >= 0) {
-            close(bridge->server_sock);
-            bridge->server_sock = -1;
-        }
+        close_listener(bridge);
     }
 
 #if defined(CONFIG_SSCTE_TLS_ENABLE)
     // Clean up global TLS resources
-    if (g_secure_mode) {
-        free_tls_config();
-        g_secure_mode = false;
+    if (g_tls_ready) {
+        tls_server_deinit();
+        g_tls_ready = false;
+    }
+#endif
+
+#if defined(CONFIG_NOISE_ENABLE)
+    if (g_noise_ready) {
+        noise_server_deinit();
+        g_noise_ready = false;
     }
 #endif
 
@@ -199,8 +357,9 @@ void tcp_cleanup(void)
 /**
  * @brief Initialize TCP servers for all active bridges
  *
- * Sets up listening sockets for each bridge. If TLS is enabled,
- * configures all servers for secure mode with the provided certificates.
+ * Sets up the shared TLS configuration if given and the Noise keys if a
+ * bridge uses them, then listening sockets for each bridge. Bridges with
+ * TLS or Noise enabled fail to start without it.
  *
  * @param tls_config TLS configuration (NULL for plain TCP mode)
  * @return ESP_OK on success, ESP_FAIL on error
@@ -220,92 +379,41 @@ esp_err_t tcp_server_init(const tcp_server_tls_config_t *tls_config)
 
 #if defined(CONFIG_SSCTE_TLS_ENABLE)
     if (tls_config) {
-        /* Enable TLS mode and copy PEM strings */
-        g_secure_mode = true;
-        g_tls_config.verify_client = tls_config->verify_client;
-        g_tls_config.ca_cert_pem = tls_config->ca_cert_pem ? strdup(tls_config->ca_cert_pem) : NULL;
-        g_tls_config.server_cert_pem = tls_config->server_cert_pem ? strdup(tls_config->server_cert_pem) : NULL;
-        g_tls_config.server_key_pem = tls_config->server_key_pem ? strdup(tls_config->server_key_pem) : NULL;
-
-        /* Set up ESP-TLS configuration structure */
-        memset(&g_esp_tls_cfg, 0, sizeof(g_esp_tls_cfg));
-        g_esp_tls_cfg.cacert_buf = (const unsigned char*)g_tls_config.ca_cert_pem;
-        g_esp_tls_cfg.cacert_bytes = g_tls_config.ca_cert_pem
-                                    ? strlen(g_tls_config.ca_cert_pem) + 1
-                                    : 0;
-        g_esp_tls_cfg.servercert_buf = (const unsigned char*)g_tls_config.server_cert_pem;
-        g_esp_tls_cfg.servercert_bytes = g_tls_config.server_cert_pem
-                                    ? strlen(g_tls_config.server_cert_pem) + 1
-                                    : 0;
-        g_esp_tls_cfg.serverkey_buf = (const unsigned char*)g_tls_config.server_key_pem;
-        g_esp_tls_cfg.serverkey_bytes = g_tls_config.server_key_pem
-                                    ? strlen(g_tls_config.server_key_pem) + 1
-                                    : 0;
-
-        ESP_LOGI(TAG, "TLS enabled (client verify: %s)",
-                g_tls_config.verify_client ? "yes" : "no");
+        /* Parse certificates (or load PSK identities) once for all bridges */
+        if (tls_server_init(tls_config) != ESP_OK) {
+            goto err;
+        }
+        g_tls_ready = true;
     } else {
         /* Plain TCP mode */
-        g_secure_mode = false;
         ESP_LOGI(TAG, "TLS disabled");
     }
 #else
     /* TLS not available in this build */
-    g_secure_mode = false;
     ESP_LOGI(TAG, "TLS disabled (not configured in build)");
 #endif
 
-    // Initialize TCP server for each active bridge
-    for (int i = 0; i < num_bridges; i++) {
-        uart_bridge_t *bridge = &bridges[i];
-
-        if (!bridge->enabled) {
-            continue;
-        }
-
-        ESP_LOGI(TAG, "Initializing TCP server for bridge %d on port %d",
-                i, bridge->tcp_port);
-
-        // Create listening socket
-        int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-        if (sock < 0) {
-            ESP_LOGE(TAG, "socket(): errno %d", errno);
-            goto err;
+#if defined(CONFIG_NOISE_ENABLE)
+    /* Load the Noise keys only if a bridge serves Noise clients */
+    for (int i = 0; i < CONFIG_AVAILABLE_BRIDGE_UARTS; i++) {
+        if (bridges[i].enabled && bridges[i].noise) {
+            if (noise_server_init() != ESP_OK) {
+                goto err;
+            }
+            g_noise_ready = true;
+            break;
         }
+    }
+#endif
 
-        // Allow reuse of local address
-        int opt = 1;
-        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-
-        // Set 5-second send/recv timeouts
-        struct timeval t = { .tv_sec = 5, .tv_usec = 0 };
-        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &t, sizeof(t));
-        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &t, sizeof(t));
-
-        // Bind to all interfaces on the configured port
-        struct sockaddr_in addr = {
-            .sin_family      = AF_INET,
-            .sin_port        = htons(bridge->tcp_port),
-            .sin_addr.s_addr = htonl(INADDR_ANY),
-        };
-        if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-            ESP_LOGE(TAG, "bind(): errno %d", errno);
-            close(sock);
-            goto err;
+    // Initialize TCP server for each active bridge
+    for (int i = 0; i < CONFIG_AVAILABLE_BRIDGE_UARTS; i++) {
+        if (!bridges[i].enabled) {
+            continue;
         }
-
-        // Listen for one connection
-        if (listen(sock, 1) < 0) {
-            ESP_LOGE(TAG, "listen(): errno %d", errno);
-            close(sock);
+        if (open_listener(&bridges[i]) != ESP_OK) {
             goto err;
         }
-
-        bridge->server_sock = sock;
-        bridge->client_sock = -1;
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
-        bridge->tls_handle = NULL;
-#endif
     }
 
     return ESP_OK;
@@ -320,8 +428,8 @@ err:
  * @brief Accept a new client for a bridge if none is connected
  *
  * Non-blocking function that checks for and accepts new connections
- * for the specified bridge. Uses select() with a short timeout to
- * poll the listening socket.
+ * for the specified bridge. The listening socket is non-blocking, so
+ * accept() returns immediately when no client is waiting.
  *
  * @param bridge Pointer to the bridge to handle
  * @return true if a new client was accepted, false otherwise
@@ -329,36 +437,33 @@ err:
 static bool tcp_handle_new_connection(uart_bridge_t *bridge)
 {
     // Skip if already connected or socket not valid
-    if (!bridge->enabled || bridge->server_sock < 0 ||
-        bridge->client_sock >= 0
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
-        || bridge->tls_handle != NULL
-#endif
-    ) {
+    if (!bridge->enabled || bridge->server_sock < 0 || bridge->conn) {
         return false;
     }
 
-    // Poll listening socket without blocking
-    fd_set fds;
-    FD_ZERO(&fds);
-    FD_SET(bridge->server_sock, &fds);
-    struct timeval to = {
-        .tv_sec  = 0,
-        .tv_usec = CONFIG_SELECT_TIMEOUT_MS * 1000
-    };
-    if (select(bridge->server_sock + 1, &fds, NULL, NULL, &to) != 1) {
-        return false;
-    }
-
-    // Accept connection
+    // Accept without blocking; the listening socket is non-blocking
     struct sockaddr_in caddr;
     socklen_t len = sizeof(caddr);
+    diag_op_begin(bridge->uart_port, DIAG_OP_ACCEPT);
     int csock = accept(bridge->server_sock, (struct sockaddr*)&caddr, &len);
+    diag_op_end();
     if (csock < 0) {
-        ESP_LOGW(TAG, "accept(): errno %d", errno);
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            ESP_LOGW(TAG, "accept(): errno %d", errno);
+        }
+        return false;
+    }
+
+    // Turn away handshakes over the rate limits before anything is allocated
+    if (bridge->transport->handshake && !admission_check(caddr.sin_addr.s_addr)) {
+        reset_client(csock);
         return false;
     }
 
+    // Client I/O relies on blocking reads/writes with socket timeouts
+    int flags = fcntl(csock, F_GETFL, 0);
+    fcntl(csock, F_SETFL, flags & ~O_NONBLOCK);
+
     // Log client IP
     char client_ip[16];
     inet_ntoa_r(caddr.sin_addr, client_ip, sizeof(client_ip));
@@ -369,36 +474,26 @@ static bool tcp_handle_new_connection(uart_bridge_t *bridge)
     int flag = 1;
     setsockopt(csock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
 
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
-    if (g_secure_mode) {
-        // Set up TLS connection
-        esp_tls_t *h = esp_tls_init();
-        if (!h) {
-            close(csock);
-            ESP_LOGE(TAG, "Failed to initialize TLS");
-            return false;
-        }
-
-        // Perform TLS handshake
-        int ret = esp_tls_server_session_create(&g_esp_tls_cfg, csock, h);
-        if (ret != 0) {
-            ESP_LOGE(TAG, "TLS handshake failed for UART%d: %d", bridge->uart_port, ret);
-            esp_tls_server_session_delete(h);
-            close(csock);
-            return false;
-        }
+    // Hand the socket to the bridge's transport (runs the TLS handshake)
+    diag_op_begin(bridge->uart_port, DIAG_OP_HANDSHAKE);
+    bridge->conn = bridge->transport->accept(csock, bridge->uart_port);
+    diag_op_end();
+    if (!bridge->conn) {
+        close(csock);
+        return false;
+    }
 
-        ESP_LOGI(TAG, "TLS handshake completed for UART%d", bridge->uart_port);
-        bridge->tls_handle = h;
-        bridge->client_sock = -1;  // Not used in TLS mode
+    rfc2217_begin(bridge);
+    if (bridge->tap) {
+        // Start the new client with live data
+        uart_tap_reset();
     } else {
-#endif
-        // Plain TCP connection
-        bridge->client_sock = csock;
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
+        // Don't let an XOFF left over from the last session stall this one
+        uart_clear_xoff(bridge);
     }
-#endif
 
+    // Connection setup allocates; only check forwarding after warm-up
+    diag_alloc_warmup_reset();
     return true;
 }
 
@@ -411,10 +506,9 @@ void tcp_handle_new_connections(void)
 {
     // Get all bridge instances
     uart_bridge_t *bridges = uart_manager_get_instances();
-    int num_bridges = uart_manager_get_active_count();
 
     // Try to accept new connections for each bridge
-    for (int i = 0; i < num_bridges; i++) {
+    for (int i = 0; i < CONFIG_AVAILABLE_BRIDGE_UARTS; i++) {
         if (bridges[i].enabled) {
             tcp_handle_new_connection(&bridges[i]);
         }
@@ -422,10 +516,11 @@ void tcp_handle_new_connections(void)
 }
 
 /**
- * @brief Receive data from either a TCP or TLS connection with non-blocking behavior
+ * @brief Receive data from the client with non-blocking behavior
  *
- * Reads available data from the client connection (TCP or TLS).
- * Uses select() to check for data availability before reading.
+ * Reads available data through the client's transport.
+ * Peeks at the socket without blocking to check for data availability
+ * before reading.
  * Handles client disconnection and cleanup.
  *
  * @param bridge Pointer to the bridge structure
@@ -439,31 +534,12 @@ void tcp_handle_new_connections(void)
 static int tcp_receive_data(uart_bridge_t *bridge, uint8_t *buffer, size_t max_len)
 {
     // Validate input parameters and connection state
-    if (!bridge->enabled || !buffer || max_len == 0 ||
-        ((!g_secure_mode && bridge->client_sock < 0) ||
-         (g_secure_mode
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
-          && bridge->tls_handle == NULL
-#endif
-         ))) {
+    if (!bridge->enabled || !buffer || max_len == 0 || !bridge->conn) {
         return -1;
     }
 
-    int sockfd;
-
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
-    if (g_secure_mode) {
-        // Get the socket descriptor from the TLS handle
-        if (esp_tls_get_conn_sockfd(bridge->tls_handle, &sockfd) != ESP_OK) {
-            ESP_LOGW(TAG, "Failed to get TLS socket descriptor");
-            return -1;
-        }
-    } else {
-#endif
-        sockfd = bridge->client_sock;
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
-    }
-#endif
+    const transport_ops_t *transport = bridge->transport;
+    int sockfd = transport->fd(bridge->conn);
 
     // Verify we have a valid socket descriptor
     if (sockfd < 0) {
@@ -471,48 +547,41 @@ static int tcp_receive_data(uart_bridge_t *bridge, uint8_t *buffer, size_t max_l
         return -1;
     }
 
-    // Set up select() to poll the socket for available data
-    fd_set read_fds;
-    FD_ZERO(&read_fds);
-    FD_SET(sockfd, &read_fds);
-
-    struct timeval timeout = {
-        .tv_sec  = 0,
-        .tv_usec = CONFIG_SELECT_TIMEOUT_MS * 1000
-    };
-
-    int select_result = select(sockfd + 1, &read_fds, NULL, NULL, &timeout);
-
-    // Check for select errors or timeout
-    if (select_result < 0) {
-        ESP_LOGW(TAG, "Select error: %d", errno);
-        return -1;
-    } else if (select_result == 0) {
-        // Timeout occurred, no data available
-        return 0;
+    // Check for available data without blocking. select() is avoided
+    // because the VFS layer allocates its fd bookkeeping on every call.
+    // Decrypted bytes may already be buffered from a previous record
+    bool pending = transport->pending(bridge->conn) > 0;
+    diag_op_begin(bridge->uart_port, DIAG_OP_TCP_READ);
+    if (!pending) {
+        uint8_t peek;
+        int peek_result = recv(sockfd, &peek, 1, MSG_PEEK | MSG_DONTWAIT);
+        if (peek_result < 0) {
+            diag_op_end();
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // No data available
+                return 0;
+            }
+            ESP_LOGW(TAG, "recv() error for UART%d: %d", bridge->uart_port, errno);
+            cleanup_client(bridge);
+            return -1;
+        }
+        // peek_result == 0 means the peer closed; the read below reports it
     }
 
-    // Data is available, read it using the appropriate method
-    int bytes_read = 0;
+    // Data is available, read it through the transport
+    int bytes_read = transport->read(bridge->conn, buffer, max_len);
+    diag_op_end();
 
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
-    if (g_secure_mode) {
-        bytes_read = esp_tls_conn_read(bridge->tls_handle, buffer, max_len);
-    } else {
-#endif
-        bytes_read = recv(bridge->client_sock, buffer, max_len, 0);
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
+    if (bytes_read == -EAGAIN) {
+        // The rest of the record is read on a later pass
+        return 0;
     }
-#endif
-
     if (bytes_read <= 0) {
         if (bytes_read == 0) {
             ESP_LOGI(TAG, "Client disconnected from UART%d", bridge->uart_port);
         } else {
             ESP_LOGW(TAG, "%s read error for UART%d: %d",
-                     g_secure_mode ? "TLS" : "TCP",
-                     bridge->uart_port,
-                     g_secure_mode ? bytes_read : errno);
+                     transport->name, bridge->uart_port, bytes_read);
         }
         cleanup_client(bridge);
         return -1;  // Signal disconnection to caller
@@ -521,10 +590,37 @@ static int tcp_receive_data(uart_bridge_t *bridge, uint8_t *buffer, size_t max_l
     return bytes_read;
 }
 
+/**
+ * @brief Check a client whose data is left unread for a disconnect
+ *
+ * While the target can't take more data the socket isn't read, so a
+ * close or reset would go unnoticed until the target resumes. Peeking
+ * leaves any data waiting in place.
+ *
+ * @param bridge Pointer to the bridge structure
+ * @return true if the client is still connected
+ */
+static bool tcp_check_client(uart_bridge_t *bridge)
+{
+    uint8_t peek;
+    int ret = recv(bridge->transport->fd(bridge->conn), &peek, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (ret > 0 || (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))) {
+        return true;
+    }
+
+    if (ret == 0) {
+        ESP_LOGI(TAG, "Client disconnected from UART%d", bridge->uart_port);
+    } else {
+        ESP_LOGW(TAG, "recv() error for UART%d: %d", bridge->uart_port, errno);
+    }
+    cleanup_client(bridge);
+    return false;
+}
+
 /**
  * @brief Send data to the connected client
  *
- * Sends data to the client using either TLS or plain TCP.
+ * Sends data to the client through its transport.
  * Handles disconnection and cleanup if the send fails.
  *
  * @param bridge Pointer to the bridge structure
@@ -537,33 +633,17 @@ static int tcp_receive_data(uart_bridge_t *bridge, uint8_t *buffer, size_t max_l
 static int tcp_send_data(uart_bridge_t *bridge, const uint8_t *data, size_t len)
 {
     // Validate parameters and connection state
-    if (!bridge->enabled || !data || len == 0 ||
-        ((!g_secure_mode && bridge->client_sock < 0) ||
-         (g_secure_mode
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
-          && bridge->tls_handle == NULL
-#endif
-         ))) {
+    if (!bridge->enabled || !data || len == 0 || !bridge->conn) {
         return -1;
     }
 
-    int ret = -1;
-
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
-    if (g_secure_mode) {
-        ret = esp_tls_conn_write(bridge->tls_handle, data, len);
-    } else {
-#endif
-        ret = send(bridge->client_sock, data, len, 0);
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
-    }
-#endif
+    diag_op_begin(bridge->uart_port, DIAG_OP_TCP_WRITE);
+    int ret = bridge->transport->write(bridge->conn, data, len);
+    diag_op_end();
 
     if (ret <= 0) {
         ESP_LOGW(TAG, "%s write error for UART%d: %d",
-                 g_secure_mode ? "TLS" : "TCP",
-                 bridge->uart_port,
-                 g_secure_mode ? ret : errno);
+                 bridge->transport->name, bridge->uart_port, ret);
         cleanup_client(bridge);
         return -1;
     }
@@ -580,16 +660,7 @@ static int tcp_send_data(uart_bridge_t *bridge, const uint8_t *data, size_t len)
  */
 static bool tcp_is_client_connected(uart_bridge_t *bridge)
 {
-    if (!bridge->enabled) {
-        return false;
-    }
-
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
-    if (g_secure_mode) {
-        return bridge->tls_handle != NULL;
-    }
-#endif
-    return bridge->client_sock >= 0;
+    return bridge->enabled && bridge->conn != NULL;
 }
 
 /**
@@ -608,12 +679,40 @@ static void process_bridge_data(uart_bridge_t *bridge)
         return;
     }
 
-    // Process TCP to UART direction
-    int bytes_read = tcp_receive_data(bridge, bridge->tcp_buf, CONFIG_UART_BUF_SIZE);
+    diag_alloc_region_begin(bridge->uart_port);
+
+    if (bridge->tap) {
+        // Tap output: the link is never written to, so client input is
+        // discarded and the merged record stream is sent instead
+        tcp_receive_data(bridge, bridge->tcp_buf, CONFIG_UART_BUF_SIZE);
+        size_t tap_bytes = uart_tap_read(bridge->uart_buf, CONFIG_UART_BUF_SIZE);
+        if (tap_bytes > 0) {
+            tcp_send_data(bridge, bridge->uart_buf, tap_bytes);
+        }
+        diag_alloc_region_end();
+        return;
+    }
+
+    // Process TCP to UART direction, reading no more than the UART takes
+    // without blocking: nothing while the target holds the line, the
+    // pacing queue is full or the previous DMA transmit is still using
+    // tcp_buf. Telnet commands are acted on as soon as they are read.
+    int bytes_read = 0;
+    size_t tx_room = uart_tx_room(bridge);
+    if (tx_room > 0) {
+        bytes_read = tcp_receive_data(bridge, bridge->tcp_buf, tx_room);
+        // Execute and strip Telnet/RFC 2217 commands
+        bytes_read = rfc2217_process(bridge, bridge->tcp_buf, bytes_read, tcp_send_data);
+    } else if (!tcp_check_client(bridge)) {
+        diag_alloc_region_end();
+        return;
+    }
 
     // If we received data, forward it to UART
     if (bytes_read > 0) {
+        diag_op_begin(bridge->uart_port, DIAG_OP_UART_WRITE);
         int bytes_written = uart_write_data(bridge, bridge->tcp_buf, bytes_read);
+        diag_op_end();
         if (bytes_written < 0) {
             ESP_LOGW(TAG, "UART%d write error: %d", bridge->uart_port, bytes_written);
         } else if (bytes_written < bytes_read) {
@@ -622,15 +721,57 @@ static void process_bridge_data(uart_bridge_t *bridge)
         }
     }
 
+    // The client may have gone while reading or answering commands; data
+    // for it stays in the UART driver until the next client connects
+    if (!bridge->conn) {
+        diag_alloc_region_end();
+        return;
+    }
+
     // Process UART to TCP direction
+    if (bridge->dma_mode) {
+        // Forward DMA chunks in place, straight from the receive buffers,
+        // until none are left or this pass's budget is used up
+        size_t budget = DMA_FORWARD_BUDGET;
+        const uint8_t *chunk;
+        size_t chunk_len;
+        while (budget > 0 && (chunk_len = uart_peek_rx(bridge, &chunk)) > 0) {
+            if (chunk_len > budget) {
+                chunk_len = budget;
+            }
+            int bytes_sent = tcp_send_data(bridge, chunk, chunk_len);
+            if (bytes_sent < 0) {
+                // Client is gone; nobody will take this chunk
+                uart_release_rx(bridge, chunk_len);
+                break;
+            }
+            uart_release_rx(bridge, bytes_sent);
+            if (bytes_sent < (int)chunk_len) {
+                // Socket timed out; the rest is sent on the next pass
+                ESP_LOGW(TAG, "TCP send incomplete for UART%d: %d of %d bytes sent",
+                         bridge->uart_port, bytes_sent, (int)chunk_len);
+                break;
+            }
+            budget -= bytes_sent;
+        }
+        diag_alloc_region_end();
+        return;
+    }
+
+    // With RFC 2217, read at most half the buffer so IAC escaping fits
+    size_t max_read = bridge->rfc2217 ? CONFIG_UART_BUF_SIZE / 2 : CONFIG_UART_BUF_SIZE;
     size_t available_bytes;
-    if (uart_get_available_bytes(bridge, &available_bytes) == ESP_OK && available_bytes > 0) {
+    if (!rfc2217_is_suspended(bridge) &&
+        uart_get_available_bytes(bridge, &available_bytes) == ESP_OK && available_bytes > 0 &&
+        !coalesce_hold(bridge, available_bytes, max_read)) {
         // Read data from UART
-        int to_read = (available_bytes > CONFIG_UART_BUF_SIZE) ?
-                       CONFIG_UART_BUF_SIZE : available_bytes;
+        int to_read = (available_bytes > max_read) ? max_read : available_bytes;
 
+        diag_op_begin(bridge->uart_port, DIAG_OP_UART_READ);
         int uart_bytes = uart_read_data(bridge, bridge->uart_buf, to_read, CONFIG_UART_READ_TIMEOUT_MS);
+        diag_op_end();
 
+        uart_bytes = rfc2217_escape(bridge, bridge->uart_buf, uart_bytes);
         if (uart_bytes > 0) {
             // Forward data to TCP client
             int bytes_sent = tcp_send_data(bridge, bridge->uart_buf, uart_bytes);
@@ -640,6 +781,8 @@ static void process_bridge_data(uart_bridge_t *bridge)
             }
         }
     }
+
+    diag_alloc_region_end();
 }
 
 /**
@@ -653,12 +796,108 @@ void tcp_process_data(void)
 {
     // Get all bridge instances
     uart_bridge_t *bridges = uart_manager_get_instances();
-    int num_bridges = uart_manager_get_active_count();
 
     // Process data for each active bridge
-    for (int i = 0; i < num_bridges; i++) {
+    for (int i = 0; i < CONFIG_AVAILABLE_BRIDGE_UARTS; i++) {
         if (bridges[i].enabled) {
+            uart_poll_events(&bridges[i]);
             process_bridge_data(&bridges[i]);
+            uart_flow_update(&bridges[i]);
+        }
+    }
+}
+
+/**
+ * @brief Make sure the transport required by bridge settings is set up
+ *
+ * The Noise keys are loaded on first use, so a bridge can be switched to
+ * Noise at runtime even if none used it at boot. TLS needs the
+ * certificates passed to tcp_server_init() and can't be set up later.
+ *
+ * @param bridge_idx Bridge index (0 for UART1)
+ * @param cfg Bridge settings
+ * @return ESP_OK if clients can be accepted with these settings
+ */
+static esp_err_t prepare_transport(int bridge_idx, const uart_bridge_config_t *cfg)
+{
+    if (!cfg->enabled) {
+        return ESP_OK;
+    }
+
+#if defined(CONFIG_NOISE_ENABLE)
+    if (cfg->noise && !g_noise_ready) {
+        esp_err_t ret = noise_server_init();
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "UART%d: Noise keys could not be loaded", bridge_idx + 1);
+            return ret;
         }
+        g_noise_ready = true;
     }
+#endif
+#if defined(CONFIG_SSCTE_TLS_ENABLE)
+    if (cfg->tls && !g_tls_ready) {
+        ESP_LOGW(TAG, "UART%d: TLS is not set up (server started without TLS)", bridge_idx + 1);
+        return ESP_ERR_INVALID_STATE;
+    }
+#endif
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Apply new settings to one bridge and restart it
+ *
+ * Disconnects the bridge's client, closes its listening socket, restarts
+ * its UART with the new settings and listens again on the (possibly new)
+ * TCP port. Other bridges keep their clients and keep forwarding.
+ *
+ * @param bridge_idx Bridge index (0 for UART1)
+ * @param cfg New settings
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t tcp_reconfigure_bridge(int bridge_idx, const uart_bridge_config_t *cfg)
+{
+    // Reject bad settings, or ones whose transport can't be set up,
+    // before the client is dropped
+    esp_err_t ret = uart_manager_check_config(bridge_idx, cfg);
+    if (ret == ESP_OK) {
+        ret = prepare_transport(bridge_idx, cfg);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    uart_bridge_config_t prev;
+    ret = uart_manager_get_config(bridge_idx, &prev);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    uart_bridge_t *bridge = &uart_manager_get_instances()[bridge_idx];
+    if (bridge->enabled) {
+        if (tcp_is_client_connected(bridge)) {
+            ESP_LOGI(TAG, "Disconnecting UART%d client for reconfiguration", bridge->uart_port);
+        }
+        cleanup_client(bridge);
+        close_listener(bridge);
+    }
+
+    ret = uart_manager_set_config(bridge_idx, cfg);
+    if (ret == ESP_OK && bridge->enabled) {
+        ret = open_listener(bridge);
+        if (ret != ESP_OK) {
+            // E.g. the new port is taken; go back to settings that worked
+            ESP_LOGW(TAG, "UART%d can't listen with the new settings, restoring the previous ones",
+                     bridge->uart_port);
+            uart_manager_set_config(bridge_idx, &prev);
+        }
+    }
+
+    // On failure the previous settings are back in place, so listen again
+    // if the bridge is running
+    if (ret != ESP_OK && bridge->enabled) {
+        open_listener(bridge);
+    }
+
+    return ret;
 }
@@ -15,6 +15,7 @@
 #include <stddef.h>
 #include "esp_err.h"
 #include "uart_manager.h" // For uart_bridge_t type
+#include "tls_server.h"   // For tls_server_config_t
 
 #ifdef __cplusplus
 extern "C" {
@@ -23,20 +24,9 @@ extern "C" {
 /**
  * @brief TLS configuration structure
  *
- * Contains PEM-format strings for certificates and keys.
- * For server operation, server_cert_pem and server_key_pem are required.
- * For mutual TLS, ca_cert_pem and verify_client must also be set.
+ * See tls_server_config_t.
  */
-typedef struct {
-    /** CA certificate for client verification (NULL for no client auth) */
-    const char *ca_cert_pem;
-    /** Server certificate (required for TLS) */
-    const char *server_cert_pem;
-    /** Server private key (required for TLS) */
-    const char *server_key_pem;
-    /** Whether to verify client certificates */
-    bool verify_client;
-} tcp_server_tls_config_t;
+typedef tls_server_config_t tcp_server_tls_config_t;
 
 /**
  * @brief Initialize TCP servers for all active UART bridges
@@ -44,8 +34,9 @@ typedef struct {
  * Sets up listening sockets on the configured ports for each active bridge.
  * When tls_config is provided, configures all servers for secure connections.
  *
- * For TLS mode, this function makes internal copies of the certificate strings,
- * so caller may free their buffers after this call returns.
+ * For TLS mode, the certificates and key are parsed once into a TLS
+ * configuration shared by all bridges, so the caller may free their
+ * buffers after this call returns.
  *
  * @param tls_config  Pointer to TLS config (NULL for plain TCP mode).
  *                    Must contain valid certificate and key for TLS mode.
@@ -58,7 +49,7 @@ esp_err_t tcp_server_init(const tcp_server_tls_config_t *tls_config);
  *
  * Non-blocking function that checks for and accepts new connections
  * for all active bridges without a current client.
- * Uses select() with a short timeout to poll the listening sockets.
+ * The listening sockets are non-blocking, so this never waits.
  */
 void tcp_handle_new_connections(void);
 
@@ -80,6 +71,25 @@ void tcp_process_data(void);
  */
 void tcp_cleanup(void);
 
+/**
+ * @brief Apply new settings to one bridge and restart it
+ *
+ * Disconnects the bridge's client, restarts its UART with the new settings
+ * (see uart_manager_set_config()) and rebinds its listening socket. The
+ * other bridges keep their clients and keep forwarding. Must be called
+ * from the main loop.
+ *
+ * The settings are checked, and the Noise keys loaded if the bridge now
+ * needs them, before anything is torn down; if that fails the bridge is
+ * left as it was. If the bridge can't listen with the new settings, the
+ * previous ones are restored.
+ *
+ * @param bridge_idx Bridge index (0 for UART1)
+ * @param cfg New settings
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t tcp_reconfigure_bridge(int bridge_idx, const uart_bridge_config_t *cfg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,1131 @@
+/*
+ * tls_server.c
+ *
+ * TLS server sessions built directly on mbedTLS.
+ *
+ * Everything that is the same for every connection is set up once in
+ * tls_server_init(): the parsed certificate, key and CA, or the PSK
+ * identity table, the RNG, and the session ticket keys and session
+ * cache. All of it lives in one mbedtls_ssl_config that every session
+ * references, so accepting a client only allocates the SSL context and
+ * its record buffers.
+ *
+ * Thread safety: None. All functions must be called from the same thread.
+ */
+
+#include "tls_server.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "nvs.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+static const char *TAG = "TLSServer";
+
+#if defined(CONFIG_SSCTE_TLS_ENABLE)
+
+#include "mbedtls/version.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/platform_util.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/ssl_ticket.h"
+#include "mbedtls/ssl_cache.h"
+#include "lwip/sockets.h"
+
+#if defined(CONFIG_TLS_PROTO_1_3)
+#include "psa/crypto.h"
+#endif
+
+#if defined(CONFIG_TLS_CERT_SOURCE_PARTITION)
+#include "esp_partition.h"
+#endif
+
+#if defined(CONFIG_TLS_CLIENT_VERIFY_PINNED)
+#include "mbedtls/sha256.h"
+#endif
+
+#if CONFIG_TLS_SESSION_CACHE_SIZE > 0 && !defined(MBEDTLS_SSL_CACHE_C)
+#warning "TLS session cache requested but MBEDTLS_SSL_CACHE_C is disabled"
+#endif
+
+// It frees the config's certificates after the first handshake, but here
+// one config serves every session
+#if defined(CONFIG_MBEDTLS_DYNAMIC_FREE_CONFIG_DATA)
+#error "CONFIG_MBEDTLS_DYNAMIC_FREE_CONFIG_DATA is incompatible with the shared TLS configuration"
+#endif
+
+#if defined(CONFIG_TLS_LOW_RAM) && defined(CONFIG_MBEDTLS_SSL_OUT_CONTENT_LEN) && \
+    CONFIG_MBEDTLS_SSL_OUT_CONTENT_LEN > CONFIG_UART_BUF_SIZE
+#warning "TLS output records are larger than CONFIG_UART_BUF_SIZE, which is all a bridge writes at once"
+#endif
+
+/** NVS namespace holding the PSK identities (id<n>, key<n>, uarts<n>) */
+#define PSK_NVS_NAMESPACE "tls_psk"
+
+/** Length of a pinned client fingerprint (SHA-256) */
+#define PIN_LEN 32
+
+/** What client certificates are checked against, for log messages */
+#if defined(CONFIG_TLS_CLIENT_VERIFY_PINNED)
+#define CLIENT_TRUST "client pins"
+#if defined(CONFIG_TLS_CLIENT_PIN_SPKI)
+#define PIN_KIND "SPKI"
+#else
+#define PIN_KIND "certificate"
+#endif
+#else
+#define CLIENT_TRUST "CA certificate"
+#endif
+
+/*
+ * Credentials partition layout, written by tools/mkcertpart.py (all
+ * fields little-endian): a header, then `count` items, then the DER
+ * blobs they point to. Offsets are from the start of the partition.
+ */
+#define CERT_PART_MAGIC    "SCTC"
+#define CERT_PART_VERSION  1
+
+#define CERT_ITEM_SERVER_CERT 1    // Leaf first, then any intermediates
+#define CERT_ITEM_SERVER_KEY  2
+#define CERT_ITEM_CA_CERT     3    // Client CA, one item per certificate
+#define CERT_ITEM_CLIENT_PINS 4    // Pinned client fingerprints, as text
+
+typedef struct __attribute__((packed)) {
+    char magic[4];
+    uint16_t version;
+    uint16_t count;
+} cert_part_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t type;                  // CERT_ITEM_*
+    uint8_t reserved[3];
+    uint32_t offset;
+    uint32_t length;
+} cert_part_item_t;
+
+/**
+ * @brief One PSK client identity
+ */
+typedef struct {
+    char identity[TLS_PSK_IDENTITY_MAX + 1];
+    uint8_t key[MBEDTLS_PSK_MAX_LEN];
+    size_t key_len;
+    uint32_t uarts;                // Bit n allows UARTn; 0 allows all
+} psk_entry_t;
+
+struct tls_session {
+    mbedtls_ssl_context ssl;
+    mbedtls_net_context net;
+    int uart_port;                 // UART the client connected to
+    const psk_entry_t *entry;      // PSK identity the client authenticated with
+    size_t max_record;             // Largest payload per outgoing record
+    size_t record_overhead;        // Header, MAC and padding per record
+};
+
+#if defined(CONFIG_TLS_AUTH_PSK)
+/**
+ * PSK-only suites: no public-key operation on either side.
+ */
+static const int psk_ciphersuites[] = {
+#if defined(CONFIG_TLS_PROTO_1_3)
+    MBEDTLS_TLS1_3_AES_128_GCM_SHA256,
+#endif
+    MBEDTLS_TLS_PSK_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_PSK_WITH_AES_128_CCM,
+    MBEDTLS_TLS_PSK_WITH_AES_128_CBC_SHA256,
+    0
+};
+#endif
+
+static struct {
+    mbedtls_ssl_config conf;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+#if defined(CONFIG_TLS_AUTH_PSK)
+    psk_entry_t entries[CONFIG_TLS_PSK_MAX_IDENTITIES];
+    int count;
+#else
+    mbedtls_x509_crt cert;
+    mbedtls_pk_context key;
+    mbedtls_x509_crt ca;
+#endif
+#if defined(CONFIG_TLS_CLIENT_VERIFY_PINNED)
+    uint8_t pins[CONFIG_TLS_CLIENT_PINS_MAX][PIN_LEN]; // Sorted for bsearch()
+    int pin_count;
+#endif
+#if defined(CONFIG_TLS_CERT_SOURCE_PARTITION)
+    esp_partition_mmap_handle_t cert_map; // Backs cert and ca, which point into it
+    bool cert_mapped;
+#endif
+#if defined(CONFIG_TLS_SESSION_TICKETS)
+    mbedtls_ssl_ticket_context ticket;
+    int64_t ticket_rotated_us;     // Time of the last ticket key rotation
+#endif
+#if CONFIG_TLS_SESSION_CACHE_SIZE > 0 && defined(MBEDTLS_SSL_CACHE_C)
+    mbedtls_ssl_cache_context cache;
+#endif
+    bool ready;
+} server;
+
+static tls_heap_stats_t heap_stats;
+static tls_record_stats_t record_stats;
+
+/* -------------- PSK Identities -------------- */
+
+#if defined(CONFIG_TLS_AUTH_PSK)
+
+/**
+ * @brief Decode a hex string into a key
+ *
+ * @return Key length, or 0 if str is not valid hex or out of bounds
+ */
+static size_t parse_hex_key(const char *str, uint8_t *out, size_t max_len) {
+    size_t len = strlen(str);
+    if (len % 2 != 0 || len / 2 > max_len) {
+        return 0;
+    }
+    for (size_t i = 0; i < len / 2; i++) {
+        unsigned int byte;
+        if (!isxdigit((unsigned char)str[2 * i]) || !isxdigit((unsigned char)str[2 * i + 1]) ||
+            sscanf(str + 2 * i, "%2x", &byte) != 1) {
+            return 0;
+        }
+        out[i] = (uint8_t)byte;
+    }
+    return len / 2;
+}
+
+/**
+ * @brief Parse a comma-separated list of UART numbers into a bit mask
+ *
+ * @return true on success
+ */
+static bool parse_uart_list(const char *str, uint32_t *mask) {
+    *mask = 0;
+    while (*str) {
+        char *end;
+        long n = strtol(str, &end, 10);
+        if (end == str || n < 1 || n > 31) {
+            return false;
+        }
+        *mask |= 1UL << n;
+        str = (*end == ',') ? end + 1 : end;
+        if (*end != ',' && *end != '\0') {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Validate an identity and add it to the table
+ *
+ * @return true if it was added
+ */
+static bool add_entry(const char *identity, const uint8_t *key, size_t key_len, uint32_t uarts) {
+    if (server.count >= CONFIG_TLS_PSK_MAX_IDENTITIES) {
+        ESP_LOGW(TAG, "Too many PSK identities, ignoring \"%s\"", identity);
+        return false;
+    }
+    if (identity[0] == '\0' || strlen(identity) > TLS_PSK_IDENTITY_MAX) {
+        ESP_LOGW(TAG, "Ignoring PSK identity with invalid length");
+        return false;
+    }
+    if (key_len < TLS_PSK_KEY_MIN) {
+        ESP_LOGW(TAG, "Key for \"%s\" is shorter than %d bytes, ignoring", identity, TLS_PSK_KEY_MIN);
+        return false;
+    }
+    for (int i = 0; i < server.count; i++) {
+        if (strcmp(server.entries[i].identity, identity) == 0) {
+            ESP_LOGW(TAG, "Duplicate PSK identity \"%s\", ignoring", identity);
+            return false;
+        }
+    }
+
+    psk_entry_t *e = &server.entries[server.count++];
+    strcpy(e->identity, identity);
+    memcpy(e->key, key, key_len);
+    e->key_len = key_len;
+    e->uarts = uarts;
+    return true;
+}
+
+#if defined(CONFIG_TLS_PSK_SOURCE_NVS)
+/**
+ * @brief Load identities from NVS
+ *
+ * Entries are numbered from 0 and loading stops at the first missing
+ * id<n>: id<n> is the identity string, key<n> the key blob and the
+ * optional uarts<n> a u32 mask of allowed UART numbers.
+ */
+static void load_identities(void) {
+    nvs_handle_t nvs;
+    if (nvs_open(PSK_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+
+    for (int i = 0; i < CONFIG_TLS_PSK_MAX_IDENTITIES; i++) {
+        char name[16];
+        char identity[TLS_PSK_IDENTITY_MAX + 1];
+        uint8_t key[MBEDTLS_PSK_MAX_LEN];
+        size_t len = sizeof(identity);
+        uint32_t uarts = 0;
+
+        snprintf(name, sizeof(name), "id%d", i);
+        if (nvs_get_str(nvs, name, identity, &len) != ESP_OK) {
+            break;
+        }
+        snprintf(name, sizeof(name), "key%d", i);
+        len = sizeof(key);
+        if (nvs_get_blob(nvs, name, key, &len) != ESP_OK) {
+            ESP_LOGW(TAG, "No key%d for \"%s\", ignoring", i, identity);
+            continue;
+        }
+        snprintf(name, sizeof(name), "uarts%d", i);
+        nvs_get_u32(nvs, name, &uarts);
+
+        add_entry(identity, key, len, uarts);
+        mbedtls_platform_zeroize(key, sizeof(key));
+    }
+    nvs_close(nvs);
+}
+#else
+/**
+ * @brief Load identities from a text file
+ *
+ * One identity per line: `<identity> <hex key> [<uart>,<uart>...]`.
+ * Empty lines and lines starting with '#' are skipped.
+ */
+static void load_identities(void) {
+    FILE *file = fopen(CONFIG_TLS_PSK_FILE_PATH, "r");
+    if (!file) {
+        ESP_LOGE(TAG, "Failed to open %s", CONFIG_TLS_PSK_FILE_PATH);
+        return;
+    }
+
+    char line[TLS_PSK_IDENTITY_MAX + 2 * MBEDTLS_PSK_MAX_LEN + 48];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_no++;
+        char *save;
+        char *identity = strtok_r(line, " \t\r\n", &save);
+        if (!identity || identity[0] == '#') {
+            continue;
+        }
+        char *hex = strtok_r(NULL, " \t\r\n", &save);
+        char *uart_list = strtok_r(NULL, " \t\r\n", &save);
+
+        uint8_t key[MBEDTLS_PSK_MAX_LEN];
+        size_t key_len = hex ? parse_hex_key(hex, key, sizeof(key)) : 0;
+        uint32_t uarts = 0;
+        if (key_len == 0 || (uart_list && !parse_uart_list(uart_list, &uarts))) {
+            ESP_LOGW(TAG, "%s:%d: invalid entry, ignoring", CONFIG_TLS_PSK_FILE_PATH, line_no);
+        } else {
+            add_entry(identity, key, key_len, uarts);
+        }
+        mbedtls_platform_zeroize(key, sizeof(key));
+    }
+    mbedtls_platform_zeroize(line, sizeof(line));
+    fclose(file);
+}
+#endif
+
+/**
+ * @brief mbedTLS PSK callback: pick the key for the client's identity
+ *
+ * The session being set up is the SSL context's user data, so the
+ * identity can be checked against the UART the client connected to.
+ */
+static int psk_callback(void *arg, mbedtls_ssl_context *ssl,
+                        const unsigned char *identity, size_t identity_len) {
+    tls_session_t *session = mbedtls_ssl_get_user_data_p(ssl);
+
+    for (int i = 0; i < server.count; i++) {
+        const psk_entry_t *e = &server.entries[i];
+        if (strlen(e->identity) != identity_len ||
+            memcmp(e->identity, identity, identity_len) != 0) {
+            continue;
+        }
+        if (e->uarts != 0 && !(e->uarts & (1UL << session->uart_port))) {
+            ESP_LOGW(TAG, "Identity \"%s\" is not allowed on UART%d",
+                     e->identity, session->uart_port);
+            break;
+        }
+        session->entry = e;
+        return mbedtls_ssl_set_hs_psk(ssl, e->key, e->key_len);
+    }
+    return MBEDTLS_ERR_SSL_UNKNOWN_IDENTITY;
+}
+
+/**
+ * @brief Load the identities and attach them to the shared config
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+static esp_err_t setup_psk(void) {
+    load_identities();
+    if (server.count == 0) {
+        ESP_LOGE(TAG, "No PSK identities configured");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    mbedtls_ssl_conf_ciphersuites(&server.conf, psk_ciphersuites);
+    mbedtls_ssl_conf_psk_cb(&server.conf, psk_callback, NULL);
+#if defined(CONFIG_TLS_PROTO_1_3)
+    // External PSK only (psk_ke): no ECDHE, like the TLS 1.2 suites
+    mbedtls_ssl_conf_tls13_key_exchange_modes(&server.conf,
+                                              MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_PSK);
+#else
+    mbedtls_ssl_conf_max_tls_version(&server.conf, MBEDTLS_SSL_VERSION_TLS1_2);
+#endif
+
+    ESP_LOGI(TAG, "TLS-PSK enabled with %d identit%s", server.count,
+             server.count == 1 ? "y" : "ies");
+    return ESP_OK;
+}
+#endif /* CONFIG_TLS_AUTH_PSK */
+
+/* -------------- Pinned Client Certificates -------------- */
+
+#if defined(CONFIG_TLS_CLIENT_VERIFY_PINNED)
+
+static int pin_compare(const void *a, const void *b) {
+    return memcmp(a, b, PIN_LEN);
+}
+
+/**
+ * @brief Decode a hex fingerprint, with or without ':' separators
+ *
+ * @return true if str holds exactly PIN_LEN bytes
+ */
+static bool parse_pin(const char *str, uint8_t *out) {
+    size_t n = 0;
+    while (*str) {
+        if (*str == ':') {
+            str++;
+            continue;
+        }
+        unsigned int byte;
+        if (n == PIN_LEN || !isxdigit((unsigned char)str[0]) ||
+            !isxdigit((unsigned char)str[1]) || sscanf(str, "%2x", &byte) != 1) {
+            return false;
+        }
+        out[n++] = (uint8_t)byte;
+        str += 2;
+    }
+    return n == PIN_LEN;
+}
+
+/**
+ * @brief Build the sorted fingerprint table from its text form
+ *
+ * One fingerprint per line, optionally followed by a comment such as the
+ * client's name. Empty lines and lines starting with '#' are skipped.
+ * The text need not be NUL-terminated, so it can be read in place from
+ * flash.
+ *
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if no valid pin was found
+ */
+static esp_err_t load_pins(const char *text, size_t len) {
+    const char *end = text + len;
+    int line_no = 0;
+    while (text < end && *text != '\0') {
+        const char *eol = memchr(text, '\n', end - text);
+        size_t line_len = eol ? (size_t)(eol - text) : (size_t)(end - text);
+        char line[3 * PIN_LEN + 64];
+        line_no++;
+
+        if (line_len >= sizeof(line)) {
+            line_len = sizeof(line) - 1;
+        }
+        memcpy(line, text, line_len);
+        line[line_len] = '\0';
+        text = eol ? eol + 1 : end;
+
+        char *save;
+        char *pin = strtok_r(line, " \t\r", &save);
+        if (!pin || pin[0] == '#') {
+            continue;
+        }
+        if (server.pin_count >= CONFIG_TLS_CLIENT_PINS_MAX) {
+            ESP_LOGW(TAG, "Too many pinned fingerprints, ignoring line %d onwards", line_no);
+            break;
+        }
+        if (!parse_pin(pin, server.pins[server.pin_count])) {
+            ESP_LOGW(TAG, "Line %d: invalid SHA-256 fingerprint, ignoring", line_no);
+            continue;
+        }
+        server.pin_count++;
+    }
+
+    if (server.pin_count == 0) {
+        ESP_LOGE(TAG, "No pinned client fingerprints configured");
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    qsort(server.pins, server.pin_count, PIN_LEN, pin_compare);
+    int unique = 1;
+    for (int i = 1; i < server.pin_count; i++) {
+        if (pin_compare(server.pins[i], server.pins[unique - 1]) != 0) {
+            memcpy(server.pins[unique++], server.pins[i], PIN_LEN);
+        }
+    }
+    server.pin_count = unique;
+    return ESP_OK;
+}
+
+/**
+ * @brief mbedTLS verify callback: accept only pinned client certificates
+ *
+ * Called for each certificate of the presented chain, leaf last. Only
+ * the leaf is looked up; whatever the chain check reported (no trusted
+ * CA, bad signature, expiry) is replaced by the result of the lookup.
+ * The client still proves it holds the key in CertificateVerify.
+ */
+static int pin_verify(void *arg, mbedtls_x509_crt *crt, int depth, uint32_t *flags) {
+    if (depth > 0) {
+        *flags = 0;
+        return 0;
+    }
+
+    uint8_t hash[PIN_LEN];
+#if defined(CONFIG_TLS_CLIENT_PIN_SPKI)
+    const mbedtls_x509_buf *der = &crt->MBEDTLS_PRIVATE(pk_raw);
+#else
+    const mbedtls_x509_buf *der = &crt->raw;
+#endif
+    int ret = mbedtls_sha256(der->p, der->len, hash, 0);
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (bsearch(hash, server.pins, server.pin_count, PIN_LEN, pin_compare)) {
+        *flags = 0;
+    } else {
+        ESP_LOGW(TAG, "Client certificate %02x%02x%02x%02x... is not pinned",
+                 hash[0], hash[1], hash[2], hash[3]);
+        *flags = MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+    }
+    return 0;
+}
+#endif /* CONFIG_TLS_CLIENT_VERIFY_PINNED */
+
+/* -------------- Certificates -------------- */
+
+#if !defined(CONFIG_TLS_AUTH_PSK)
+#if defined(CONFIG_TLS_CERT_SOURCE_PARTITION)
+/**
+ * @brief Map the credentials partition and parse its DER items in place
+ *
+ * Certificates are parsed with the _nocopy variant, so mbedTLS points
+ * into the mapped flash instead of holding a heap copy of each DER
+ * blob. The partition stays mapped until tls_server_deinit().
+ *
+ * @param verify_client Whether CA items are needed
+ * @return ESP_OK on success, error code otherwise
+ */
+static esp_err_t parse_partition_credentials(bool verify_client) {
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           ESP_PARTITION_SUBTYPE_ANY,
+                                                           CONFIG_TLS_CERT_PARTITION_LABEL);
+    if (!part) {
+        ESP_LOGE(TAG, "Partition \"%s\" not found", CONFIG_TLS_CERT_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const void *base;
+    esp_err_t err = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA,
+                                       &base, &server.cert_map);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map partition \"%s\" (%s)", part->label, esp_err_to_name(err));
+        return err;
+    }
+    server.cert_mapped = true;
+
+    const uint8_t *data = base;
+    const cert_part_header_t *hdr = base;
+    if (memcmp(hdr->magic, CERT_PART_MAGIC, sizeof(hdr->magic)) != 0 ||
+        hdr->version != CERT_PART_VERSION ||
+        sizeof(*hdr) + (size_t)hdr->count * sizeof(cert_part_item_t) > part->size) {
+        ESP_LOGE(TAG, "Partition \"%s\" holds no credentials (see tools/mkcertpart.py)",
+                 part->label);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const cert_part_item_t *items = (const cert_part_item_t *)(data + sizeof(*hdr));
+    bool have_cert = false, have_key = false, have_ca = false; // have_ca: CA or pins
+    for (int i = 0; i < hdr->count; i++) {
+        const cert_part_item_t *item = &items[i];
+        if (item->offset > part->size || item->length > part->size - item->offset) {
+            ESP_LOGE(TAG, "Credential %d lies outside the partition", i);
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        const uint8_t *der = data + item->offset;
+        int ret = 0;
+        switch (item->type) {
+        case CERT_ITEM_SERVER_CERT:
+            ret = mbedtls_x509_crt_parse_der_nocopy(&server.cert, der, item->length);
+            have_cert = true;
+            break;
+        case CERT_ITEM_SERVER_KEY:
+            ret = mbedtls_pk_parse_key(&server.key, der, item->length, NULL, 0,
+                                       mbedtls_ctr_drbg_random, &server.ctr_drbg);
+            have_key = true;
+            break;
+#if defined(CONFIG_TLS_CLIENT_VERIFY_PINNED)
+        case CERT_ITEM_CLIENT_PINS:
+            if (verify_client) {
+                if (load_pins((const char *)der, item->length) != ESP_OK) {
+                    return ESP_ERR_NOT_FOUND;
+                }
+                have_ca = true;
+            }
+            break;
+        case CERT_ITEM_CA_CERT:
+            break;
+#else
+        case CERT_ITEM_CA_CERT:
+            if (verify_client) {
+                ret = mbedtls_x509_crt_parse_der_nocopy(&server.ca, der, item->length);
+                have_ca = true;
+            }
+            break;
+        case CERT_ITEM_CLIENT_PINS:
+            break;
+#endif
+        default:
+            ESP_LOGW(TAG, "Skipping unknown credential type %d", item->type);
+            break;
+        }
+        if (ret != 0) {
+            ESP_LOGE(TAG, "Failed to parse credential %d (type %d): -0x%04x", i, item->type, -ret);
+            return ESP_FAIL;
+        }
+    }
+
+    if (!have_cert || !have_key || (verify_client && !have_ca)) {
+        ESP_LOGE(TAG, "Partition \"%s\" lacks the server certificate, key%s",
+                 part->label, verify_client ? " or " CLIENT_TRUST : "");
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+#else
+/**
+ * @brief Parse the PEM server certificate, key and CA
+ *
+ * The PEM text is only needed during this call; mbedTLS keeps its own
+ * parsed form for the lifetime of the server.
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+static esp_err_t parse_pem_credentials(const tls_server_config_t *cfg) {
+    if (!cfg->server_cert_pem || !cfg->server_key_pem) {
+        ESP_LOGE(TAG, "Server certificate and key are required");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int ret = mbedtls_x509_crt_parse(&server.cert, (const unsigned char *)cfg->server_cert_pem,
+                                     strlen(cfg->server_cert_pem) + 1);
+    if (ret != 0) {
+        ESP_LOGE(TAG, "Failed to parse server certificate: -0x%04x", -ret);
+        return ESP_FAIL;
+    }
+
+    ret = mbedtls_pk_parse_key(&server.key, (const unsigned char *)cfg->server_key_pem,
+                               strlen(cfg->server_key_pem) + 1, NULL, 0,
+                               mbedtls_ctr_drbg_random, &server.ctr_drbg);
+    if (ret != 0) {
+        ESP_LOGE(TAG, "Failed to parse server key: -0x%04x", -ret);
+        return ESP_FAIL;
+    }
+
+    if (cfg->verify_client) {
+#if defined(CONFIG_TLS_CLIENT_VERIFY_PINNED)
+        if (!cfg->client_pins) {
+            ESP_LOGE(TAG, "Client verification needs pinned fingerprints");
+            return ESP_ERR_INVALID_ARG;
+        }
+        return load_pins(cfg->client_pins, strlen(cfg->client_pins));
+#else
+        if (!cfg->ca_cert_pem) {
+            ESP_LOGE(TAG, "Client verification needs a CA certificate");
+            return ESP_ERR_INVALID_ARG;
+        }
+        ret = mbedtls_x509_crt_parse(&server.ca, (const unsigned char *)cfg->ca_cert_pem,
+                                     strlen(cfg->ca_cert_pem) + 1);
+        if (ret != 0) {
+            ESP_LOGE(TAG, "Failed to parse CA certificate: -0x%04x", -ret);
+            return ESP_FAIL;
+        }
+#endif
+    }
+    return ESP_OK;
+}
+#endif /* CONFIG_TLS_CERT_SOURCE_PARTITION */
+
+/**
+ * @brief Load the server certificate, key and CA into the shared config
+ *
+ * @return ESP_OK on success, error code otherwise
+ */
+static esp_err_t setup_certificates(const tls_server_config_t *cfg) {
+    if (!cfg) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+#if defined(CONFIG_TLS_CERT_SOURCE_PARTITION)
+    esp_err_t err = parse_partition_credentials(cfg->verify_client);
+#else
+    esp_err_t err = parse_pem_credentials(cfg);
+#endif
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    int ret = mbedtls_ssl_conf_own_cert(&server.conf, &server.cert, &server.key);
+    if (ret != 0) {
+        ESP_LOGE(TAG, "Failed to load server key: -0x%04x", -ret);
+        return ESP_FAIL;
+    }
+
+    if (cfg->verify_client) {
+#if defined(CONFIG_TLS_CLIENT_VERIFY_PINNED)
+        /*
+         * mbedTLS refuses to verify without a CA chain, so hand it the
+         * server certificate as a stand-in. Client certificates are not
+         * issued by it, so nothing is checked against it, and it is left
+         * out of the CertificateRequest. pin_verify() makes the decision.
+         */
+        mbedtls_ssl_conf_ca_chain(&server.conf, &server.cert, NULL);
+        mbedtls_ssl_conf_verify(&server.conf, pin_verify, NULL);
+#if MBEDTLS_VERSION_NUMBER >= 0x03010000
+        mbedtls_ssl_conf_cert_req_ca_list(&server.conf, MBEDTLS_SSL_CERT_REQ_CA_LIST_DISABLED);
+#endif
+        ESP_LOGI(TAG, "Client certificates pinned (%d " PIN_KIND " fingerprint%s)",
+                 server.pin_count, server.pin_count == 1 ? "" : "s");
+#else
+        mbedtls_ssl_conf_ca_chain(&server.conf, &server.ca, NULL);
+#endif
+        mbedtls_ssl_conf_authmode(&server.conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    } else {
+        mbedtls_ssl_conf_authmode(&server.conf, MBEDTLS_SSL_VERIFY_NONE);
+    }
+
+#if defined(CONFIG_TLS_PROTO_1_3)
+    mbedtls_ssl_conf_tls13_key_exchange_modes(&server.conf,
+#if defined(CONFIG_TLS13_PSK_RESUMPTION)
+        MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_PSK_EPHEMERAL |
+#endif
+        MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL);
+#endif
+
+    ESP_LOGI(TAG, "TLS enabled (client verify: %s)", cfg->verify_client ? "yes" : "no");
+    return ESP_OK;
+}
+#endif /* !CONFIG_TLS_AUTH_PSK */
+
+/* -------------- Session Resumption -------------- */
+
+/**
+ * @brief Set up session tickets and the session-ID cache
+ *
+ * Tickets are encrypted with AES-256-GCM under a key that never leaves
+ * the device, so the server keeps no per-client state: a client that
+ * reconnects presents its ticket and skips the ECDHE and signature work.
+ * Clients without ticket support are served from a small session-ID
+ * cache instead. Both are shared by all bridges and lost on reboot.
+ *
+ * Failures only cost clients a full handshake, so they are not fatal.
+ */
+static void setup_resumption(void) {
+#if defined(CONFIG_TLS_SESSION_TICKETS)
+    int ret = mbedtls_ssl_ticket_setup(&server.ticket, mbedtls_ctr_drbg_random, &server.ctr_drbg,
+                                       MBEDTLS_CIPHER_AES_256_GCM, CONFIG_TLS_TICKET_LIFETIME_S);
+    if (ret != 0) {
+        ESP_LOGW(TAG, "Session ticket setup failed: -0x%04x", -ret);
+    } else {
+        mbedtls_ssl_conf_session_tickets_cb(&server.conf, mbedtls_ssl_ticket_write,
+                                            mbedtls_ssl_ticket_parse, &server.ticket);
+        server.ticket_rotated_us = esp_timer_get_time();
+        ESP_LOGI(TAG, "Session tickets enabled (lifetime %d s, key rotation %d s)",
+                 CONFIG_TLS_TICKET_LIFETIME_S, CONFIG_TLS_TICKET_KEY_ROTATION_S);
+    }
+#endif
+
+#if CONFIG_TLS_SESSION_CACHE_SIZE > 0 && defined(MBEDTLS_SSL_CACHE_C)
+    mbedtls_ssl_cache_set_max_entries(&server.cache, CONFIG_TLS_SESSION_CACHE_SIZE);
+    mbedtls_ssl_cache_set_timeout(&server.cache, CONFIG_TLS_SESSION_CACHE_TIMEOUT_S);
+    mbedtls_ssl_conf_session_cache(&server.conf, &server.cache,
+                                   mbedtls_ssl_cache_get, mbedtls_ssl_cache_set);
+    ESP_LOGI(TAG, "Session cache enabled (%d entries, timeout %d s)",
+             CONFIG_TLS_SESSION_CACHE_SIZE, CONFIG_TLS_SESSION_CACHE_TIMEOUT_S);
+#endif
+}
+
+/**
+ * @brief Replace the ticket encryption key once it is due
+ *
+ * mbedTLS keeps the previous key for decryption, so tickets issued just
+ * before a rotation stay valid until the next one. Without an explicit
+ * interval mbedTLS rotates by itself once per ticket lifetime.
+ */
+static void ticket_key_rotate_if_due(void) {
+#if defined(CONFIG_TLS_SESSION_TICKETS) && CONFIG_TLS_TICKET_KEY_ROTATION_S > 0 && \
+    MBEDTLS_VERSION_NUMBER >= 0x03020000
+    int64_t now = esp_timer_get_time();
+    if (now - server.ticket_rotated_us < (int64_t)CONFIG_TLS_TICKET_KEY_ROTATION_S * 1000000) {
+        return;
+    }
+
+    unsigned char name[4];
+    unsigned char key[32];
+    int ret = mbedtls_ctr_drbg_random(&server.ctr_drbg, name, sizeof(name));
+    if (ret == 0) {
+        ret = mbedtls_ctr_drbg_random(&server.ctr_drbg, key, sizeof(key));
+    }
+    if (ret == 0) {
+        ret = mbedtls_ssl_ticket_rotate(&server.ticket, name, sizeof(name),
+                                        key, sizeof(key), CONFIG_TLS_TICKET_LIFETIME_S);
+    }
+    mbedtls_platform_zeroize(key, sizeof(key));
+
+    if (ret != 0) {
+        ESP_LOGW(TAG, "Session ticket key rotation failed: -0x%04x", -ret);
+    } else {
+        ESP_LOGI(TAG, "Session ticket key rotated");
+    }
+    // Retry on the next interval rather than on every connection
+    server.ticket_rotated_us = now;
+#endif
+}
+
+/* -------------- Server -------------- */
+
+esp_err_t tls_server_init(const tls_server_config_t *cfg) {
+    memset(&server, 0, sizeof(server));
+    mbedtls_ssl_config_init(&server.conf);
+    mbedtls_entropy_init(&server.entropy);
+    mbedtls_ctr_drbg_init(&server.ctr_drbg);
+#if !defined(CONFIG_TLS_AUTH_PSK)
+    mbedtls_x509_crt_init(&server.cert);
+    mbedtls_pk_init(&server.key);
+    mbedtls_x509_crt_init(&server.ca);
+#endif
+#if defined(CONFIG_TLS_SESSION_TICKETS)
+    mbedtls_ssl_ticket_init(&server.ticket);
+#endif
+#if CONFIG_TLS_SESSION_CACHE_SIZE > 0 && defined(MBEDTLS_SSL_CACHE_C)
+    mbedtls_ssl_cache_init(&server.cache);
+#endif
+    server.ready = true;
+
+#if defined(CONFIG_TLS_PROTO_1_3)
+    // TLS 1.3 in mbedTLS runs its key schedule on PSA Crypto
+    if (psa_crypto_init() != PSA_SUCCESS) {
+        ESP_LOGE(TAG, "PSA Crypto init failed, TLS 1.3 unavailable");
+        tls_server_deinit();
+        return ESP_FAIL;
+    }
+#endif
+
+    int ret = mbedtls_ctr_drbg_seed(&server.ctr_drbg, mbedtls_entropy_func,
+                                    &server.entropy, NULL, 0);
+    if (ret == 0) {
+        ret = mbedtls_ssl_config_defaults(&server.conf, MBEDTLS_SSL_IS_SERVER,
+                                          MBEDTLS_SSL_TRANSPORT_STREAM,
+                                          MBEDTLS_SSL_PRESET_DEFAULT);
+    }
+    if (ret != 0) {
+        ESP_LOGE(TAG, "SSL config setup failed: -0x%04x", -ret);
+        tls_server_deinit();
+        return ESP_FAIL;
+    }
+    mbedtls_ssl_conf_rng(&server.conf, mbedtls_ctr_drbg_random, &server.ctr_drbg);
+
+#if defined(CONFIG_TLS_AUTH_PSK)
+    esp_err_t err = setup_psk();
+#else
+    esp_err_t err = setup_certificates(cfg);
+#endif
+    if (err != ESP_OK) {
+        tls_server_deinit();
+        return err;
+    }
+
+#if !defined(CONFIG_TLS_AUTH_PSK)
+    setup_resumption();
+#endif
+    return ESP_OK;
+}
+
+void tls_server_deinit(void) {
+    if (server.ready) {
+#if CONFIG_TLS_SESSION_CACHE_SIZE > 0 && defined(MBEDTLS_SSL_CACHE_C)
+        mbedtls_ssl_cache_free(&server.cache);
+#endif
+#if defined(CONFIG_TLS_SESSION_TICKETS)
+        mbedtls_ssl_ticket_free(&server.ticket);
+#endif
+#if !defined(CONFIG_TLS_AUTH_PSK)
+        mbedtls_x509_crt_free(&server.ca);
+        mbedtls_pk_free(&server.key);
+        mbedtls_x509_crt_free(&server.cert);
+#endif
+#if defined(CONFIG_TLS_CERT_SOURCE_PARTITION)
+        // Only after the certificates that point into it
+        if (server.cert_mapped) {
+            esp_partition_munmap(server.cert_map);
+        }
+#endif
+        mbedtls_ssl_config_free(&server.conf);
+        mbedtls_ctr_drbg_free(&server.ctr_drbg);
+        mbedtls_entropy_free(&server.entropy);
+    }
+    mbedtls_platform_zeroize(&server, sizeof(server));
+}
+
+/**
+ * @brief Bound blocking reads and writes on a socket
+ */
+static void set_sock_timeout(int sock, const struct timeval *tv) {
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, tv, sizeof(*tv));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, tv, sizeof(*tv));
+}
+
+/**
+ * @brief Run the handshake within CONFIG_HANDSHAKE_TIMEOUT_MS
+ *
+ * Steps through the handshake so each blocking socket call can be limited
+ * to the time left. A client that stalls or trickles bytes would
+ * otherwise hold the main loop for a socket timeout per message. The
+ * socket's own timeouts are restored afterwards.
+ *
+ * @return 0 on success, mbedTLS error code otherwise
+ */
+static int handshake_with_deadline(tls_session_t *session, int sock, int64_t start) {
+    struct timeval io_timeout;
+    socklen_t optlen = sizeof(io_timeout);
+    bool restore = getsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &io_timeout, &optlen) == 0;
+
+    int64_t deadline = start + (int64_t)CONFIG_HANDSHAKE_TIMEOUT_MS * 1000;
+    int ret = 0;
+    while (ret == 0 && !mbedtls_ssl_is_handshake_over(&session->ssl)) {
+        int64_t left = deadline - esp_timer_get_time();
+        if (left <= 0) {
+            ret = MBEDTLS_ERR_SSL_TIMEOUT;
+            break;
+        }
+        // lwIP keeps socket timeouts in whole milliseconds and takes 0 as
+        // no timeout at all, so the last fraction is rounded up
+        left = (left + 999) / 1000 * 1000;
+        struct timeval tv = { .tv_sec = left / 1000000, .tv_usec = left % 1000000 };
+        set_sock_timeout(sock, &tv);
+        ret = mbedtls_ssl_handshake_step(&session->ssl);
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+            ret = 0;
+        }
+    }
+
+    if (restore) {
+        set_sock_timeout(sock, &io_timeout);
+    }
+    return ret;
+}
+
+tls_session_t *tls_server_accept(int sock, int uart_port) {
+    if (!server.ready) {
+        return NULL;
+    }
+
+    ticket_key_rotate_if_due();
+
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    tls_session_t *session = calloc(1, sizeof(*session));
+    if (!session) {
+        ESP_LOGE(TAG, "Failed to allocate TLS session");
+        return NULL;
+    }
+    session->uart_port = uart_port;
+    mbedtls_ssl_init(&session->ssl);
+    mbedtls_net_init(&session->net);
+    session->net.fd = sock;
+
+    int64_t start = esp_timer_get_time();
+    int ret = mbedtls_ssl_setup(&session->ssl, &server.conf);
+    if (ret == 0) {
+        mbedtls_ssl_set_user_data_p(&session->ssl, session);
+        mbedtls_ssl_set_bio(&session->ssl, &session->net,
+                            mbedtls_net_send, mbedtls_net_recv, NULL);
+        ret = handshake_with_deadline(session, sock, start);
+    }
+
+    if (ret != 0) {
+        ESP_LOGE(TAG, "TLS handshake failed for UART%d after %lld ms: -0x%04x", uart_port,
+                 (long long)((esp_timer_get_time() - start) / 1000), -ret);
+        // The socket belongs to the caller until the handshake succeeds
+        mbedtls_ssl_free(&session->ssl);
+        free(session);
+        return NULL;
+    }
+
+    // Both limits are fixed once the handshake has negotiated the
+    // cipher suite and any max_fragment_length / record_size_limit
+    int max_record = mbedtls_ssl_get_max_out_record_payload(&session->ssl);
+    int overhead = mbedtls_ssl_get_record_expansion(&session->ssl);
+    session->max_record = max_record > 0 ? (size_t)max_record : MBEDTLS_SSL_OUT_CONTENT_LEN;
+    session->record_overhead = overhead > 0 ? (size_t)overhead : 0;
+
+    /*
+     * mbedTLS has freed the handshake state by now; with dynamic buffers
+     * the record buffers are gone too until the next read or write.
+     */
+    size_t free_after = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    size_t used = free_before > free_after ? free_before - free_after : 0;
+    heap_stats.handshakes++;
+    heap_stats.open++;
+    heap_stats.free_before = free_before;
+    heap_stats.free_after = free_after;
+    heap_stats.session_last = used;
+    if (used > heap_stats.session_max) {
+        heap_stats.session_max = used;
+    }
+
+    // Resumed sessions finish in a fraction of a full handshake
+    ESP_LOGI(TAG, "%s handshake completed for UART%d in %lld ms, session heap %u B, "
+             "records up to %u B%s%s",
+             mbedtls_ssl_get_version(&session->ssl), uart_port,
+             (long long)((esp_timer_get_time() - start) / 1000), (unsigned)used,
+             (unsigned)session->max_record,
+             session->entry ? ", identity " : "",
+             session->entry ? session->entry->identity : "");
+    return session;
+}
+
+/* -------------- Sessions -------------- */
+
+int tls_session_read(tls_session_t *session, uint8_t *buf, size_t len) {
+    int ret;
+    do {
+        ret = mbedtls_ssl_read(&session->ssl, buf, len);
+    } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+
+    if (ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) {
+        return 0;
+    }
+    return ret;
+}
+
+int tls_session_write(tls_session_t *session, const uint8_t *buf, size_t len) {
+    size_t written = 0;
+    while (written < len) {
+        // mbedtls_ssl_write() sends at most one record per call
+        int ret;
+        do {
+            ret = mbedtls_ssl_write(&session->ssl, buf + written, len - written);
+        } while (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+        if (ret <= 0) {
+            return ret < 0 ? ret : MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+        }
+        written += ret;
+        record_stats.records++;
+        record_stats.payload_bytes += ret;
+        record_stats.wire_bytes += ret + session->record_overhead;
+    }
+    return (int)written;
+}
+
+size_t tls_session_get_bytes_avail(tls_session_t *session) {
+    return mbedtls_ssl_get_bytes_avail(&session->ssl);
+}
+
+size_t tls_session_get_max_record(const tls_session_t *session) {
+    return session ? session->max_record : 0;
+}
+
+int tls_session_get_sockfd(const tls_session_t *session) {
+    return session->net.fd;
+}
+
+const char *tls_session_get_identity(const tls_session_t *session) {
+    return session->entry ? session->entry->identity : "";
+}
+
+void tls_session_close(tls_session_t *session) {
+    if (!session) {
+        return;
+    }
+    mbedtls_ssl_close_notify(&session->ssl);
+    mbedtls_net_free(&session->net);
+    mbedtls_ssl_free(&session->ssl);
+    free(session);
+    heap_stats.open--;
+}
+
+void tls_server_get_heap_stats(tls_heap_stats_t *out) {
+    *out = heap_stats;
+}
+
+void tls_server_get_record_stats(tls_record_stats_t *out) {
+    *out = record_stats;
+}
+
+#else /* !CONFIG_SSCTE_TLS_ENABLE */
+
+esp_err_t tls_server_init(const tls_server_config_t *cfg) {
+    ESP_LOGE(TAG, "TLS is not enabled in this build");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void tls_server_deinit(void) {
+}
+
+tls_session_t *tls_server_accept(int sock, int uart_port) {
+    return NULL;
+}
+
+int tls_session_read(tls_session_t *session, uint8_t *buf, size_t len) {
+    return -1;
+}
+
+int tls_session_write(tls_session_t *session, const uint8_t *buf, size_t len) {
+    return -1;
+}
+
+size_t tls_session_get_bytes_avail(tls_session_t *session) {
+    return 0;
+}
+
+size_t tls_session_get_max_record(const tls_session_t *session) {
+    return 0;
+}
+
+int tls_session_get_sockfd(const tls_session_t *session) {
+    return -1;
+}
+
+const char *tls_session_get_identity(const tls_session_t *session) {
+    return "";
+}
+
+void tls_session_close(tls_session_t *session) {
+}
+
+void tls_server_get_heap_stats(tls_heap_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+}
+
+void tls_server_get_record_stats(tls_record_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+}
+
+#endif /* CONFIG_SSCTE_TLS_ENABLE */
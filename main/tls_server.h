@@ -0,0 +1,182 @@
+/**
+ * @file tls_server.h
+ * @brief TLS server sessions on top of mbedTLS
+ *
+ * Certificates, keys and CA (or the PSK identities) are parsed once at
+ * startup into a single SSL configuration shared by every bridge and
+ * every connection, together with the session ticket keys and the
+ * session-ID cache. Accepting a client then only costs its own SSL
+ * context and record buffers.
+ *
+ * With CONFIG_TLS_AUTH_PSK clients authenticate with pre-shared keys
+ * instead of certificates, so a handshake uses only symmetric crypto.
+ * Identities are loaded from NVS or from a text file in SPIFFS, and each
+ * may be limited to a set of UARTs, giving one key per bridge or one key
+ * per client.
+ *
+ * With CONFIG_TLS_CLIENT_VERIFY_PINNED, client certificates are checked
+ * against a sorted table of SHA-256 fingerprints instead of a CA.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Longest accepted PSK identity */
+#define TLS_PSK_IDENTITY_MAX 64
+
+/** Shortest accepted key (128 bits) */
+#define TLS_PSK_KEY_MIN 16
+
+/** Opaque TLS session for one client */
+typedef struct tls_session tls_session_t;
+
+/**
+ * @brief Heap used by TLS sessions
+ *
+ * Measured as the drop in free heap across a handshake, so allocations
+ * made by other tasks meanwhile are included; treat single values as
+ * approximate and watch the trend.
+ */
+typedef struct {
+    uint32_t handshakes;           // Handshakes completed
+    int open;                      // Sessions currently open
+    size_t free_before;            // Free heap before the last handshake
+    size_t free_after;             // Free heap once the last session was established
+    size_t session_last;           // Heap held by the last established session
+    size_t session_max;            // Largest heap held by an established session
+} tls_heap_stats_t;
+
+/**
+ * @brief Records sent to clients, over all sessions
+ */
+typedef struct {
+    uint64_t records;              // Records written
+    uint64_t payload_bytes;        // Application data carried in them
+    uint64_t wire_bytes;           // Including record headers, MACs and padding
+} tls_record_stats_t;
+
+/**
+ * @brief TLS configuration structure
+ *
+ * Contains PEM-format strings for certificates and keys.
+ * For server operation, server_cert_pem and server_key_pem are required.
+ * For mutual TLS, ca_cert_pem (or client_pins with
+ * CONFIG_TLS_CLIENT_VERIFY_PINNED) and verify_client must also be set.
+ * Unused with CONFIG_TLS_AUTH_PSK. With CONFIG_TLS_CERT_SOURCE_PARTITION
+ * the credentials come from flash and only verify_client is used.
+ */
+typedef struct {
+    /** CA certificate for client verification (NULL for no client auth) */
+    const char *ca_cert_pem;
+    /** Server certificate (required for TLS) */
+    const char *server_cert_pem;
+    /** Server private key (required for TLS) */
+    const char *server_key_pem;
+    /** Pinned client fingerprints, one hex SHA-256 per line */
+    const char *client_pins;
+    /** Whether to verify client certificates */
+    bool verify_client;
+} tls_server_config_t;
+
+/**
+ * @brief Set up the shared SSL configuration
+ *
+ * Parses the certificates and key, or loads the PSK identities, and sets
+ * up session resumption. The PEM strings are not referenced after this
+ * call returns, so the caller may free them right away.
+ *
+ * @param cfg Certificates and keys (ignored with CONFIG_TLS_AUTH_PSK)
+ * @return ESP_OK on success, ESP_ERR_NOT_FOUND if no PSK identity is
+ *         configured, other error codes on failure
+ */
+esp_err_t tls_server_init(const tls_server_config_t *cfg);
+
+/**
+ * @brief Free the identities and the shared SSL configuration
+ *
+ * All sessions must have been closed first.
+ */
+void tls_server_deinit(void);
+
+/**
+ * @brief Run the server handshake on an accepted socket
+ *
+ * Blocks until the handshake completes or fails. On failure the socket
+ * is left open for the caller to close.
+ *
+ * @param sock Connected client socket
+ * @param uart_port UART the client connected to, matched against each
+ *                  identity's allowed UARTs
+ * @return New session, or NULL if the handshake failed
+ */
+tls_session_t *tls_server_accept(int sock, int uart_port);
+
+/**
+ * @brief Read decrypted data
+ *
+ * @return Bytes read, 0 if the peer closed the session, negative mbedTLS
+ *         error code otherwise
+ */
+int tls_session_read(tls_session_t *session, uint8_t *buf, size_t len);
+
+/**
+ * @brief Encrypt and send data
+ *
+ * Data larger than the session's record size is split into several
+ * records, so each call produces at least one record: batch small
+ * writes to save the per-record header, MAC and cipher setup.
+ *
+ * @return len on success, negative mbedTLS error code on failure
+ */
+int tls_session_write(tls_session_t *session, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Decrypted bytes buffered from the current record
+ */
+size_t tls_session_get_bytes_avail(tls_session_t *session);
+
+/**
+ * @brief Largest payload of one record to this client
+ *
+ * Smaller than the configured record size if the client asked for
+ * shorter records with max_fragment_length or record_size_limit.
+ * Returns 0 for a NULL session.
+ */
+size_t tls_session_get_max_record(const tls_session_t *session);
+
+/**
+ * @brief Socket underlying a session
+ */
+int tls_session_get_sockfd(const tls_session_t *session);
+
+/**
+ * @brief PSK identity the client authenticated with ("" in certificate mode)
+ */
+const char *tls_session_get_identity(const tls_session_t *session);
+
+/**
+ * @brief Send close_notify, close the socket and free the session
+ */
+void tls_session_close(tls_session_t *session);
+
+/**
+ * @brief Get per-session heap figures for the diagnostics report
+ */
+void tls_server_get_heap_stats(tls_heap_stats_t *out);
+
+/**
+ * @brief Get record counters for the diagnostics report
+ */
+void tls_server_get_record_stats(tls_record_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,173 @@
+/*
+ * transport.c
+ *
+ * Plain TCP, TLS and Noise client transports behind one operations table.
+ *
+ * Thread safety: None. All functions must be called from the same thread.
+ */
+
+#include "transport.h"
+#include "esp_log.h"
+#include "lwip/sockets.h"
+#include <unistd.h>        // close(), shutdown()
+#include <stdlib.h>
+#include <errno.h>
+
+#if defined(CONFIG_SSCTE_TLS_ENABLE)
+#include "tls_server.h"
+#endif
+
+#if defined(CONFIG_NOISE_ENABLE)
+#include "noise_server.h"
+#endif
+
+static const char *TAG = "Transport";
+
+/* -------------- Plain TCP -------------- */
+
+typedef struct {
+    int sock;
+} tcp_conn_t;
+
+static void *tcp_accept(int sock, int uart_port) {
+    tcp_conn_t *conn = malloc(sizeof(*conn));
+    if (!conn) {
+        ESP_LOGE(TAG, "Failed to allocate connection for UART%d", uart_port);
+        return NULL;
+    }
+    conn->sock = sock;
+    return conn;
+}
+
+static int tcp_read(void *conn, uint8_t *buf, size_t len) {
+    int ret = recv(((tcp_conn_t *)conn)->sock, buf, len, 0);
+    return ret < 0 ? -errno : ret;
+}
+
+static int tcp_write(void *conn, const uint8_t *buf, size_t len) {
+    int ret = send(((tcp_conn_t *)conn)->sock, buf, len, 0);
+    return ret < 0 ? -errno : ret;
+}
+
+static size_t tcp_pending(void *conn) {
+    return 0;  // Everything received is still readable on the socket
+}
+
+static size_t tcp_max_record(void *conn) {
+    return 0;
+}
+
+static int tcp_fd(const void *conn) {
+    return ((const tcp_conn_t *)conn)->sock;
+}
+
+static void tcp_close(void *conn) {
+    tcp_conn_t *c = conn;
+    shutdown(c->sock, SHUT_RDWR);
+    close(c->sock);
+    free(c);
+}
+
+const transport_ops_t transport_tcp = {
+    .name = "TCP",
+    .handshake = false,
+    .accept = tcp_accept,
+    .read = tcp_read,
+    .write = tcp_write,
+    .pending = tcp_pending,
+    .max_record = tcp_max_record,
+    .fd = tcp_fd,
+    .close = tcp_close,
+};
+
+/* -------------- TLS -------------- */
+
+#if defined(CONFIG_SSCTE_TLS_ENABLE)
+
+static void *tls_accept(int sock, int uart_port) {
+    return tls_server_accept(sock, uart_port);
+}
+
+static int tls_read(void *conn, uint8_t *buf, size_t len) {
+    return tls_session_read(conn, buf, len);
+}
+
+static int tls_write(void *conn, const uint8_t *buf, size_t len) {
+    return tls_session_write(conn, buf, len);
+}
+
+static size_t tls_pending(void *conn) {
+    return tls_session_get_bytes_avail(conn);
+}
+
+static size_t tls_max_record(void *conn) {
+    return tls_session_get_max_record(conn);
+}
+
+static int tls_fd(const void *conn) {
+    return tls_session_get_sockfd(conn);
+}
+
+static void tls_close(void *conn) {
+    tls_session_close(conn);
+}
+
+const transport_ops_t transport_tls = {
+    .name = "TLS",
+    .handshake = true,
+    .accept = tls_accept,
+    .read = tls_read,
+    .write = tls_write,
+    .pending = tls_pending,
+    .max_record = tls_max_record,
+    .fd = tls_fd,
+    .close = tls_close,
+};
+
+#endif /* CONFIG_SSCTE_TLS_ENABLE */
+
+/* -------------- Noise -------------- */
+
+#if defined(CONFIG_NOISE_ENABLE)
+
+static void *noise_accept(int sock, int uart_port) {
+    return noise_server_accept(sock, uart_port);
+}
+
+static int noise_read(void *conn, uint8_t *buf, size_t len) {
+    return noise_session_read(conn, buf, len);
+}
+
+static int noise_write(void *conn, const uint8_t *buf, size_t len) {
+    return noise_session_write(conn, buf, len);
+}
+
+static size_t noise_pending(void *conn) {
+    return noise_session_get_bytes_avail(conn);
+}
+
+static size_t noise_max_record(void *conn) {
+    return noise_session_get_max_record(conn);
+}
+
+static int noise_fd(const void *conn) {
+    return noise_session_get_sockfd(conn);
+}
+
+static void noise_close(void *conn) {
+    noise_session_close(conn);
+}
+
+const transport_ops_t transport_noise = {
+    .name = "Noise",
+    .handshake = true,
+    .accept = noise_accept,
+    .read = noise_read,
+    .write = noise_write,
+    .pending = noise_pending,
+    .max_record = noise_max_record,
+    .fd = noise_fd,
+    .close = noise_close,
+};
+
+#endif /* CONFIG_NOISE_ENABLE */
@@ -0,0 +1,101 @@
+/**
+ * @file transport.h
+ * @brief Client connection transports for the bridges
+ *
+ * A transport is an operations table for one kind of client connection:
+ * plain TCP, TLS or the Noise channel. Each bridge picks its transport
+ * when a client connects and keeps the table with the connection, so
+ * the forwarding path calls straight into it instead of testing the
+ * security mode on every read and write, and bridges on the same device
+ * can use different transports.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Operations of a client transport
+ *
+ * Connections are opaque to callers and only passed back to the
+ * operations of the transport that created them, and only while open:
+ * none of the operations accepts NULL or a closed connection.
+ */
+typedef struct {
+    /** Short name for log messages ("TCP", "TLS") */
+    const char *name;
+
+    /** accept() runs a costly handshake, subject to admission control */
+    bool handshake;
+
+    /**
+     * @brief Take over an accepted socket
+     *
+     * Runs any handshake, blocking until it completes.
+     *
+     * @param sock Connected client socket
+     * @param uart_port UART the client connected to
+     * @return New connection, or NULL on failure, in which case the
+     *         socket is still the caller's to close
+     */
+    void *(*accept)(int sock, int uart_port);
+
+    /**
+     * @brief Read received data
+     *
+     * @return Bytes read, -EAGAIN if only part of a record has arrived so
+     *         far, 0 if the peer closed the connection, other negative
+     *         error code (-errno or mbedTLS error) otherwise
+     */
+    int (*read)(void *conn, uint8_t *buf, size_t len);
+
+    /**
+     * @brief Send data
+     *
+     * @return Bytes written (less than len only if the socket timed out),
+     *         negative error code on failure
+     */
+    int (*write)(void *conn, const uint8_t *buf, size_t len);
+
+    /**
+     * @brief Received bytes already buffered inside the transport
+     *
+     * Such bytes no longer show up as readable on the socket.
+     */
+    size_t (*pending)(void *conn);
+
+    /**
+     * @brief Largest payload sent in one record, 0 for byte streams
+     */
+    size_t (*max_record)(void *conn);
+
+    /** @brief Socket underlying a connection */
+    int (*fd)(const void *conn);
+
+    /** @brief Close the socket and free the connection */
+    void (*close)(void *conn);
+} transport_ops_t;
+
+/** Plain TCP: data goes over the socket as is */
+extern const transport_ops_t transport_tcp;
+
+#if defined(CONFIG_SSCTE_TLS_ENABLE)
+/** TLS on the shared server configuration (see tls_server.h) */
+extern const transport_ops_t transport_tls;
+#endif
+
+#if defined(CONFIG_NOISE_ENABLE)
+/** Noise_IK channel with the bridge's static key (see noise_server.h) */
+extern const transport_ops_t transport_noise;
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,323 @@
+/*
+ * uart_dma.c
+ *
+ * UHCI/GDMA streaming backend for UART bridges.
+ *
+ * RX uses a small pool of DMA buffers. A dedicated task keeps one buffer
+ * armed with uhci_receive(); the UHCI callback queues each filled region
+ * (a "chunk") for the main loop, which forwards it to TCP in place and
+ * releases it. A buffer returns to the pool once its last chunk has been
+ * released, so a burst can land in the next buffer while the previous one
+ * is still being sent.
+ *
+ * Thread safety: uart_dma_peek(), uart_dma_release() and uart_dma_write()
+ * must be called from the main loop only.
+ */
+
+#include "uart_dma.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#if UART_DMA_SUPPORTED
+#include "driver/uhci.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <stdlib.h>
+#endif
+
+static const char *TAG = "UARTDMA";
+
+#if UART_DMA_SUPPORTED
+
+/** Chunks that can be waiting for the main loop, per UART */
+#define UART_DMA_CHUNK_QUEUE_LEN (CONFIG_UART_DMA_BUF_COUNT * 8)
+
+/**
+ * @brief A filled region of a DMA buffer waiting to be forwarded
+ */
+typedef struct {
+    uint8_t *data;         // Start of the region
+    size_t len;            // Number of bytes
+    uint8_t buf_idx;       // Pool buffer the region belongs to
+    bool last;             // Final region of the buffer's transaction
+} dma_chunk_t;
+
+struct uart_dma_ctx {
+    int uart_port;
+    uhci_controller_handle_t uhci;
+    uint8_t *bufs[CONFIG_UART_DMA_BUF_COUNT];
+    volatile bool buf_busy[CONFIG_UART_DMA_BUF_COUNT]; // Armed or holding unreleased chunks
+    volatile int armed_idx;        // Buffer of the transaction in progress
+    volatile bool rx_active;       // A receive transaction is in progress
+    volatile bool tx_busy;         // A transmit is in progress
+    volatile uint32_t dropped;     // Chunks lost because the queue was full
+    QueueHandle_t chunks;          // Filled regions for the main loop
+    TaskHandle_t rx_task;          // Task that re-arms the receiver
+    bool have_chunk;               // cur has been handed out by uart_dma_peek()
+    dma_chunk_t cur;
+};
+
+/**
+ * @brief UHCI RX callback (ISR context)
+ *
+ * Queues the filled region and wakes the RX task when the transaction has
+ * ended so it can arm the next buffer immediately.
+ */
+static bool IRAM_ATTR on_rx_event(uhci_controller_handle_t uhci,
+                                  const uhci_rx_event_data_t *edata, void *user_ctx) {
+    uart_dma_ctx_t *ctx = (uart_dma_ctx_t *)user_ctx;
+    BaseType_t woken = pdFALSE;
+
+    dma_chunk_t chunk = {
+        .data = edata->data,
+        .len = edata->recv_size,
+        .buf_idx = (uint8_t)ctx->armed_idx,
+        .last = edata->flags.totally_received,
+    };
+
+    // The final chunk hands its buffer back once released, so it must
+    // never be dropped while earlier chunks of the buffer are queued. A
+    // buffer isn't re-armed before that, so at most one final chunk per
+    // buffer is waiting; keep that many slots free for them.
+    if (!chunk.last &&
+        uxQueueMessagesWaitingFromISR(ctx->chunks) >= UART_DMA_CHUNK_QUEUE_LEN - CONFIG_UART_DMA_BUF_COUNT) {
+        ctx->dropped++;
+    } else {
+        xQueueSendFromISR(ctx->chunks, &chunk, &woken);
+    }
+
+    if (chunk.last) {
+        ctx->rx_active = false;
+        vTaskNotifyGiveFromISR(ctx->rx_task, &woken);
+    }
+
+    return woken == pdTRUE;
+}
+
+/**
+ * @brief UHCI TX done callback (ISR context)
+ */
+static bool IRAM_ATTR on_tx_done(uhci_controller_handle_t uhci,
+                                 const uhci_tx_done_event_data_t *edata, void *user_ctx) {
+    uart_dma_ctx_t *ctx = (uart_dma_ctx_t *)user_ctx;
+    ctx->tx_busy = false;
+    return false;
+}
+
+/**
+ * @brief Keep a receive transaction armed
+ *
+ * Woken when a transaction ends or a buffer is released. Arms the next
+ * free buffer whenever no transaction is running.
+ */
+static void dma_rx_task(void *arg) {
+    uart_dma_ctx_t *ctx = (uart_dma_ctx_t *)arg;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (ctx->rx_active) {
+            continue;
+        }
+
+        int idx = -1;
+        for (int i = 0; i < CONFIG_UART_DMA_BUF_COUNT; i++) {
+            if (!ctx->buf_busy[i]) {
+                idx = i;
+                break;
+            }
+        }
+        if (idx < 0) {
+            // All buffers still hold data for the main loop; wait for a release
+            continue;
+        }
+
+        ctx->buf_busy[idx] = true;
+        ctx->armed_idx = idx;
+        ctx->rx_active = true;
+        esp_err_t ret = uhci_receive(ctx->uhci, ctx->bufs[idx], CONFIG_UART_DMA_BUF_SIZE);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "UART%d uhci_receive failed: %s", ctx->uart_port, esp_err_to_name(ret));
+            ctx->rx_active = false;
+            ctx->buf_busy[idx] = false;
+            vTaskDelay(1);
+            xTaskNotifyGive(xTaskGetCurrentTaskHandle());
+        }
+    }
+}
+
+esp_err_t uart_dma_init(int uart_port, uart_dma_ctx_t **ret_ctx) {
+    if (!ret_ctx) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uart_dma_ctx_t *ctx = calloc(1, sizeof(*ctx));
+    if (!ctx) {
+        return ESP_ERR_NO_MEM;
+    }
+    ctx->uart_port = uart_port;
+    ctx->armed_idx = -1;
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    for (int i = 0; i < CONFIG_UART_DMA_BUF_COUNT; i++) {
+        ctx->bufs[i] = heap_caps_aligned_calloc(64, 1, CONFIG_UART_DMA_BUF_SIZE,
+                                                MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        if (!ctx->bufs[i]) {
+            goto err;
+        }
+    }
+
+    ctx->chunks = xQueueCreate(UART_DMA_CHUNK_QUEUE_LEN, sizeof(dma_chunk_t));
+    if (!ctx->chunks) {
+        goto err;
+    }
+
+    uhci_controller_config_t uhci_cfg = {
+        .uart_port = uart_port,
+        .tx_trans_queue_depth = 2,
+        .max_transmit_size = CONFIG_UART_BUF_SIZE,
+        .max_receive_internal_mem = CONFIG_UART_DMA_BUF_SIZE,
+        .dma_burst_size = 32,
+        .rx_eof_flags.idle_eof = 1,
+    };
+    ret = uhci_new_controller(&uhci_cfg, &ctx->uhci);
+    if (ret != ESP_OK) {
+        goto err;
+    }
+
+    uhci_event_callbacks_t cbs = {
+        .on_rx_trans_event = on_rx_event,
+        .on_tx_trans_done = on_tx_done,
+    };
+    ret = uhci_register_event_callbacks(ctx->uhci, &cbs, ctx);
+    if (ret != ESP_OK) {
+        goto err;
+    }
+
+    // Above the main loop so re-arming never waits behind forwarding
+    if (xTaskCreate(dma_rx_task, "uart_dma_rx", 3072, ctx,
+                    uxTaskPriorityGet(NULL) + 1, &ctx->rx_task) != pdPASS) {
+        ret = ESP_ERR_NO_MEM;
+        goto err;
+    }
+    xTaskNotifyGive(ctx->rx_task);
+
+    ESP_LOGI(TAG, "UART%d DMA streaming enabled (%d x %d byte buffers)",
+             uart_port, CONFIG_UART_DMA_BUF_COUNT, CONFIG_UART_DMA_BUF_SIZE);
+    *ret_ctx = ctx;
+    return ESP_OK;
+
+err:
+    uart_dma_deinit(ctx);
+    return ret;
+}
+
+void uart_dma_deinit(uart_dma_ctx_t *ctx) {
+    if (!ctx) {
+        return;
+    }
+
+    if (ctx->rx_task) {
+        vTaskDelete(ctx->rx_task);
+    }
+    if (ctx->uhci) {
+        uhci_del_controller(ctx->uhci);
+    }
+    if (ctx->chunks) {
+        vQueueDelete(ctx->chunks);
+    }
+    for (int i = 0; i < CONFIG_UART_DMA_BUF_COUNT; i++) {
+        heap_caps_free(ctx->bufs[i]);
+    }
+    free(ctx);
+}
+
+size_t uart_dma_peek(uart_dma_ctx_t *ctx, const uint8_t **data) {
+    while (!ctx->have_chunk) {
+        if (xQueueReceive(ctx->chunks, &ctx->cur, 0) != pdTRUE) {
+            return 0;
+        }
+        ctx->have_chunk = true;
+
+        // Transactions can end on an idle line with nothing new in them
+        if (ctx->cur.len == 0) {
+            uart_dma_release(ctx, 0);
+        }
+    }
+
+    *data = ctx->cur.data;
+    return ctx->cur.len;
+}
+
+void uart_dma_release(uart_dma_ctx_t *ctx, size_t len) {
+    if (!ctx->have_chunk) {
+        return;
+    }
+    if (len < ctx->cur.len) {
+        ctx->cur.data += len;
+        ctx->cur.len -= len;
+        return;
+    }
+    ctx->have_chunk = false;
+
+    if (ctx->cur.last) {
+        ctx->buf_busy[ctx->cur.buf_idx] = false;
+        xTaskNotifyGive(ctx->rx_task);
+    }
+}
+
+int uart_dma_write(uart_dma_ctx_t *ctx, const uint8_t *data, size_t len) {
+    if (ctx->tx_busy) {
+        return 0;
+    }
+
+    ctx->tx_busy = true;
+    esp_err_t ret = uhci_transmit(ctx->uhci, (uint8_t *)data, len);
+    if (ret != ESP_OK) {
+        ctx->tx_busy = false;
+        ESP_LOGW(TAG, "UART%d uhci_transmit failed: %s", ctx->uart_port, esp_err_to_name(ret));
+        return -1;
+    }
+    return len;
+}
+
+bool uart_dma_tx_busy(uart_dma_ctx_t *ctx) {
+    return ctx->tx_busy;
+}
+
+uint32_t uart_dma_get_dropped(uart_dma_ctx_t *ctx) {
+    return ctx->dropped;
+}
+
+#else /* !UART_DMA_SUPPORTED */
+
+esp_err_t uart_dma_init(int uart_port, uart_dma_ctx_t **ret_ctx) {
+    ESP_LOGE(TAG, "UART%d DMA mode requires a UHCI-capable chip and ESP-IDF v5.5+", uart_port);
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void uart_dma_deinit(uart_dma_ctx_t *ctx) {
+}
+
+size_t uart_dma_peek(uart_dma_ctx_t *ctx, const uint8_t **data) {
+    return 0;
+}
+
+void uart_dma_release(uart_dma_ctx_t *ctx, size_t len) {
+}
+
+int uart_dma_write(uart_dma_ctx_t *ctx, const uint8_t *data, size_t len) {
+    return -1;
+}
+
+bool uart_dma_tx_busy(uart_dma_ctx_t *ctx) {
+    return false;
+}
+
+uint32_t uart_dma_get_dropped(uart_dma_ctx_t *ctx) {
+    return 0;
+}
+
+#endif /* UART_DMA_SUPPORTED */
@@ -0,0 +1,105 @@
+/**
+ * @file uart_dma.h
+ * @brief UHCI/GDMA streaming backend for UART bridges
+ *
+ * Streams UART RX straight into large DMA buffers and hands the filled
+ * regions to the TCP side without copying them, instead of moving bytes
+ * through the interrupt-driven UART driver. TX is sent asynchronously by
+ * DMA from the caller's buffer.
+ *
+ * Only available on chips with a UHCI controller and ESP-IDF v5.5 or
+ * later; elsewhere every function returns ESP_ERR_NOT_SUPPORTED.
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "esp_idf_version.h"
+#include "soc/soc_caps.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(SOC_UHCI_SUPPORTED) && SOC_UHCI_SUPPORTED && \
+    ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 5, 0)
+#define UART_DMA_SUPPORTED 1
+#else
+#define UART_DMA_SUPPORTED 0
+#endif
+
+/**
+ * @brief Opaque DMA streaming context for one UART
+ */
+typedef struct uart_dma_ctx uart_dma_ctx_t;
+
+/**
+ * @brief Start DMA streaming on a UART
+ *
+ * The UART must already be configured with uart_param_config() and
+ * uart_set_pin(), and must not have the UART driver installed.
+ *
+ * @param uart_port UART number
+ * @param ret_ctx Receives the new context
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if unavailable, or another error code
+ */
+esp_err_t uart_dma_init(int uart_port, uart_dma_ctx_t **ret_ctx);
+
+/**
+ * @brief Stop DMA streaming and free all resources
+ *
+ * @param ctx Context from uart_dma_init() (NULL is ignored)
+ */
+void uart_dma_deinit(uart_dma_ctx_t *ctx);
+
+/**
+ * @brief Get the oldest received chunk without copying it
+ *
+ * The chunk stays valid until uart_dma_release(). Calling this again
+ * before releasing returns the same chunk, less any part already
+ * released.
+ *
+ * @param ctx DMA context
+ * @param data Receives a pointer into the DMA buffer
+ * @return Number of bytes in the chunk, 0 if nothing has been received
+ */
+size_t uart_dma_peek(uart_dma_ctx_t *ctx, const uint8_t **data);
+
+/**
+ * @brief Release the start of the chunk returned by uart_dma_peek()
+ *
+ * After a partial send, release what was sent; the rest is returned by
+ * the next uart_dma_peek(). Once every chunk of a DMA buffer is released,
+ * the buffer is handed back to the receiver.
+ *
+ * @param ctx DMA context
+ * @param len Number of bytes to release (capped at the chunk length)
+ */
+void uart_dma_release(uart_dma_ctx_t *ctx, size_t len);
+
+/**
+ * @brief Start an asynchronous DMA transmit
+ *
+ * The data must stay untouched until uart_dma_tx_busy() returns false.
+ *
+ * @param ctx DMA context
+ * @param data Data to send (DMA-capable memory)
+ * @param len Number of bytes
+ * @return len on success, 0 if a transmit is still in progress, -1 on error
+ */
+int uart_dma_write(uart_dma_ctx_t *ctx, const uint8_t *data, size_t len);
+
+/**
+ * @brief Check whether a DMA transmit is still in progress
+ *
+ * @param ctx DMA context
+ * @return true while the last transmit has not completed
+ */
+bool uart_dma_tx_busy(uart_dma_ctx_t *ctx);
+
+/**
+ * @brief Get the number of received chunks dropped for lack of queue space
+ *
+ * @param ctx DMA context
+ * @return Dropped chunk count
+ */
+uint32_t uart_dma_get_dropped(uart_dma_ctx_t *ctx);
@@ -1,32 +1,481 @@
 #include "uart_manager.h"
+#include "uart_tap.h"
 #include "driver/uart.h"
+#include "driver/gpio.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "soc/soc_caps.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_intr_alloc.h"
+#include "esp_idf_version.h"
+#include "nvs.h"
 #include "sdkconfig.h"
 #include <string.h>
 #include <stdlib.h>
+#include <inttypes.h>
+#include <stdio.h>
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#include "hal/uart_ll.h"
+#endif
 
 static const char *TAG = "UARTManager";
 
+/** Software flow control characters */
+#define UART_XON  0x11
+#define UART_XOFF 0x13
+
+/*
+ * RX FIFO levels at which the UART sends XOFF/XON by itself. The bridge
+ * pauses the target from its forwarding backlog (uart_flow_update), so
+ * the hardware only steps in when the FIFO is about to overflow.
+ */
+#define SW_FLOW_XOFF_THRESH (SOC_UART_FIFO_LEN - 1)
+#define SW_FLOW_XON_THRESH  (SOC_UART_FIFO_LEN / 2)
+
+/** TX buffer space held back for the ring buffer's per-item headers */
+#define TX_RING_MARGIN 64
+
+/*
+ * Main loop passes of line time queued in the driver's TX buffer. The
+ * driver can't drop that buffer, so this bounds how long a flushed or
+ * urgent write waits behind data already queued.
+ */
+#define TX_QUEUE_PASSES 2
+
+/*
+ * Hardware flow control mode and RTS threshold for each bridge, from the
+ * per-UART Kconfig choice. The threshold is only configurable when RTS is
+ * in use, so fall back to a sane default otherwise.
+ */
+#if defined(CONFIG_UART1_FLOW_CTRL_CTS_RTS)
+#define UART1_FLOW_CTRL UART_HW_FLOWCTRL_CTS_RTS
+#elif defined(CONFIG_UART1_FLOW_CTRL_RTS)
+#define UART1_FLOW_CTRL UART_HW_FLOWCTRL_RTS
+#elif defined(CONFIG_UART1_FLOW_CTRL_CTS)
+#define UART1_FLOW_CTRL UART_HW_FLOWCTRL_CTS
+#else
+#define UART1_FLOW_CTRL UART_HW_FLOWCTRL_DISABLE
+#endif
+#ifdef CONFIG_UART1_RX_FLOW_THRESH
+#define UART1_RX_FLOW_THRESH CONFIG_UART1_RX_FLOW_THRESH
+#else
+#define UART1_RX_FLOW_THRESH 100
+#endif
+
+#if defined(CONFIG_UART2_FLOW_CTRL_CTS_RTS)
+#define UART2_FLOW_CTRL UART_HW_FLOWCTRL_CTS_RTS
+#elif defined(CONFIG_UART2_FLOW_CTRL_RTS)
+#define UART2_FLOW_CTRL UART_HW_FLOWCTRL_RTS
+#elif defined(CONFIG_UART2_FLOW_CTRL_CTS)
+#define UART2_FLOW_CTRL UART_HW_FLOWCTRL_CTS
+#else
+#define UART2_FLOW_CTRL UART_HW_FLOWCTRL_DISABLE
+#endif
+#ifdef CONFIG_UART2_RX_FLOW_THRESH
+#define UART2_RX_FLOW_THRESH CONFIG_UART2_RX_FLOW_THRESH
+#else
+#define UART2_RX_FLOW_THRESH 100
+#endif
+
+#if defined(CONFIG_UART3_FLOW_CTRL_CTS_RTS)
+#define UART3_FLOW_CTRL UART_HW_FLOWCTRL_CTS_RTS
+#elif defined(CONFIG_UART3_FLOW_CTRL_RTS)
+#define UART3_FLOW_CTRL UART_HW_FLOWCTRL_RTS
+#elif defined(CONFIG_UART3_FLOW_CTRL_CTS)
+#define UART3_FLOW_CTRL UART_HW_FLOWCTRL_CTS
+#else
+#define UART3_FLOW_CTRL UART_HW_FLOWCTRL_DISABLE
+#endif
+#ifdef CONFIG_UART3_RX_FLOW_THRESH
+#define UART3_RX_FLOW_THRESH CONFIG_UART3_RX_FLOW_THRESH
+#else
+#define UART3_RX_FLOW_THRESH 100
+#endif
+
+#if defined(CONFIG_UART4_FLOW_CTRL_CTS_RTS)
+#define UART4_FLOW_CTRL UART_HW_FLOWCTRL_CTS_RTS
+#elif defined(CONFIG_UART4_FLOW_CTRL_RTS)
+#define UART4_FLOW_CTRL UART_HW_FLOWCTRL_RTS
+#elif defined(CONFIG_UART4_FLOW_CTRL_CTS)
+#define UART4_FLOW_CTRL UART_HW_FLOWCTRL_CTS
+#else
+#define UART4_FLOW_CTRL UART_HW_FLOWCTRL_DISABLE
+#endif
+#ifdef CONFIG_UART4_RX_FLOW_THRESH
+#define UART4_RX_FLOW_THRESH CONFIG_UART4_RX_FLOW_THRESH
+#else
+#define UART4_RX_FLOW_THRESH 100
+#endif
+
+/* DTR pin for each bridge; only configurable with RFC 2217 enabled */
+#ifdef CONFIG_UART1_DTR_PIN
+#define UART1_DTR_PIN CONFIG_UART1_DTR_PIN
+#else
+#define UART1_DTR_PIN -1
+#endif
+#ifdef CONFIG_UART2_DTR_PIN
+#define UART2_DTR_PIN CONFIG_UART2_DTR_PIN
+#else
+#define UART2_DTR_PIN -1
+#endif
+#ifdef CONFIG_UART3_DTR_PIN
+#define UART3_DTR_PIN CONFIG_UART3_DTR_PIN
+#else
+#define UART3_DTR_PIN -1
+#endif
+#ifdef CONFIG_UART4_DTR_PIN
+#define UART4_DTR_PIN CONFIG_UART4_DTR_PIN
+#else
+#define UART4_DTR_PIN -1
+#endif
+
+/**
+ * Settings of a UART whose bridge menu is disabled in Kconfig. It can be
+ * enabled at runtime once pins and a TCP port have been set.
+ */
+#define BRIDGE_UNCONFIGURED {                                       \
+        .enabled = false,                                           \
+        .tx_pin = -1,                                               \
+        .rx_pin = -1,                                               \
+        .rts_pin = -1,                                              \
+        .cts_pin = -1,                                              \
+        .dtr_pin = -1,                                              \
+        .baud_rate = 115200,                                        \
+        .tcp_port = 0,                                              \
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,                      \
+        .rx_flow_thresh = 100,                                      \
+        .fifo = { .rxfifo_full_thresh = 120, .rx_timeout = 10,      \
+                  .txfifo_empty_thresh = 10 },                      \
+    }
+
+/**
+ * Bridge settings from Kconfig, one entry per UART, used for bridges
+ * without settings saved in NVS.
+ */
+static const uart_bridge_config_t kconfig_defaults[CONFIG_AVAILABLE_BRIDGE_UARTS] = {
+#if CONFIG_ENABLE_UART_BRIDGES >= 1
+    [0] = {
+        .enabled = true,
+        .tx_pin = CONFIG_UART1_TX_PIN,
+        .rx_pin = CONFIG_UART1_RX_PIN,
+        .rts_pin = CONFIG_UART1_RTS_PIN,
+        .cts_pin = CONFIG_UART1_CTS_PIN,
+        .dtr_pin = UART1_DTR_PIN,
+        .baud_rate = CONFIG_UART1_BAUD_RATE,
+        .tcp_port = CONFIG_UART1_TCP_PORT,
+        .flow_ctrl = UART1_FLOW_CTRL,
+        .rx_flow_thresh = UART1_RX_FLOW_THRESH,
+#ifdef CONFIG_UART1_SW_FLOW_CTRL
+        .sw_flow = true,
+#endif
+#ifdef CONFIG_UART1_DMA_MODE
+        .dma_mode = true,
+#endif
+#ifdef CONFIG_UART1_RFC2217
+        .rfc2217 = true,
+#endif
+#ifdef CONFIG_UART1_TLS
+        .tls = true,
+#endif
+#ifdef CONFIG_UART1_NOISE
+        .noise = true,
+#endif
+        .fifo = {
+            .rxfifo_full_thresh = CONFIG_UART1_RXFIFO_FULL_THRESH,
+            .rx_timeout = CONFIG_UART1_RX_TIMEOUT,
+            .txfifo_empty_thresh = CONFIG_UART1_TXFIFO_EMPTY_THRESH,
+        },
+        .pacing = {
+            .char_delay_us = CONFIG_UART1_PACE_CHAR_DELAY_US,
+            .line_delay_us = CONFIG_UART1_PACE_LINE_DELAY_MS * 1000,
+            .block_size = CONFIG_UART1_PACE_BLOCK_SIZE,
+            .block_delay_us = CONFIG_UART1_PACE_BLOCK_DELAY_MS * 1000,
+        },
+    },
+#elif CONFIG_AVAILABLE_BRIDGE_UARTS >= 1
+    [0] = BRIDGE_UNCONFIGURED,
+#endif
+#if CONFIG_ENABLE_UART_BRIDGES >= 2 && CONFIG_AVAILABLE_BRIDGE_UARTS >= 2
+    [1] = {
+        .enabled = true,
+        .tx_pin = CONFIG_UART2_TX_PIN,
+        .rx_pin = CONFIG_UART2_RX_PIN,
+        .rts_pin = CONFIG_UART2_RTS_PIN,
+        .cts_pin = CONFIG_UART2_CTS_PIN,
+        .dtr_pin = UART2_DTR_PIN,
+        .baud_rate = CONFIG_UART2_BAUD_RATE,
+        .tcp_port = CONFIG_UART2_TCP_PORT,
+        .flow_ctrl = UART2_FLOW_CTRL,
+        .rx_flow_thresh = UART2_RX_FLOW_THRESH,
+#ifdef CONFIG_UART2_SW_FLOW_CTRL
+        .sw_flow = true,
+#endif
+#ifdef CONFIG_UART2_DMA_MODE
+        .dma_mode = true,
+#endif
+#ifdef CONFIG_UART2_RFC2217
+        .rfc2217 = true,
+#endif
+#ifdef CONFIG_UART2_TLS
+        .tls = true,
+#endif
+#ifdef CONFIG_UART2_NOISE
+        .noise = true,
+#endif
+        .fifo = {
+            .rxfifo_full_thresh = CONFIG_UART2_RXFIFO_FULL_THRESH,
+            .rx_timeout = CONFIG_UART2_RX_TIMEOUT,
+            .txfifo_empty_thresh = CONFIG_UART2_TXFIFO_EMPTY_THRESH,
+        },
+        .pacing = {
+            .char_delay_us = CONFIG_UART2_PACE_CHAR_DELAY_US,
+            .line_delay_us = CONFIG_UART2_PACE_LINE_DELAY_MS * 1000,
+            .block_size = CONFIG_UART2_PACE_BLOCK_SIZE,
+            .block_delay_us = CONFIG_UART2_PACE_BLOCK_DELAY_MS * 1000,
+        },
+    },
+#elif CONFIG_AVAILABLE_BRIDGE_UARTS >= 2
+    [1] = BRIDGE_UNCONFIGURED,
+#endif
+#if CONFIG_ENABLE_UART_BRIDGES >= 3 && CONFIG_AVAILABLE_BRIDGE_UARTS >= 3
+    [2] = {
+        .enabled = true,
+        .tx_pin = CONFIG_UART3_TX_PIN,
+        .rx_pin = CONFIG_UART3_RX_PIN,
+        .rts_pin = CONFIG_UART3_RTS_PIN,
+        .cts_pin = CONFIG_UART3_CTS_PIN,
+        .dtr_pin = UART3_DTR_PIN,
+        .baud_rate = CONFIG_UART3_BAUD_RATE,
+        .tcp_port = CONFIG_UART3_TCP_PORT,
+        .flow_ctrl = UART3_FLOW_CTRL,
+        .rx_flow_thresh = UART3_RX_FLOW_THRESH,
+#ifdef CONFIG_UART3_SW_FLOW_CTRL
+        .sw_flow = true,
+#endif
+#ifdef CONFIG_UART3_DMA_MODE
+        .dma_mode = true,
+#endif
+#ifdef CONFIG_UART3_RFC2217
+        .rfc2217 = true,
+#endif
+#ifdef CONFIG_UART3_TLS
+        .tls = true,
+#endif
+#ifdef CONFIG_UART3_NOISE
+        .noise = true,
+#endif
+        .fifo = {
+            .rxfifo_full_thresh = CONFIG_UART3_RXFIFO_FULL_THRESH,
+            .rx_timeout = CONFIG_UART3_RX_TIMEOUT,
+            .txfifo_empty_thresh = CONFIG_UART3_TXFIFO_EMPTY_THRESH,
+        },
+        .pacing = {
+            .char_delay_us = CONFIG_UART3_PACE_CHAR_DELAY_US,
+            .line_delay_us = CONFIG_UART3_PACE_LINE_DELAY_MS * 1000,
+            .block_size = CONFIG_UART3_PACE_BLOCK_SIZE,
+            .block_delay_us = CONFIG_UART3_PACE_BLOCK_DELAY_MS * 1000,
+        },
+    },
+#elif CONFIG_AVAILABLE_BRIDGE_UARTS >= 3
+    [2] = BRIDGE_UNCONFIGURED,
+#endif
+#if CONFIG_ENABLE_UART_BRIDGES >= 4 && CONFIG_AVAILABLE_BRIDGE_UARTS >= 4
+    [3] = {
+        .enabled = true,
+        .tx_pin = CONFIG_UART4_TX_PIN,
+        .rx_pin = CONFIG_UART4_RX_PIN,
+        .rts_pin = CONFIG_UART4_RTS_PIN,
+        .cts_pin = CONFIG_UART4_CTS_PIN,
+        .dtr_pin = UART4_DTR_PIN,
+        .baud_rate = CONFIG_UART4_BAUD_RATE,
+        .tcp_port = CONFIG_UART4_TCP_PORT,
+        .flow_ctrl = UART4_FLOW_CTRL,
+        .rx_flow_thresh = UART4_RX_FLOW_THRESH,
+#ifdef CONFIG_UART4_SW_FLOW_CTRL
+        .sw_flow = true,
+#endif
+#ifdef CONFIG_UART4_DMA_MODE
+        .dma_mode = true,
+#endif
+#ifdef CONFIG_UART4_RFC2217
+        .rfc2217 = true,
+#endif
+#ifdef CONFIG_UART4_TLS
+        .tls = true,
+#endif
+#ifdef CONFIG_UART4_NOISE
+        .noise = true,
+#endif
+        .fifo = {
+            .rxfifo_full_thresh = CONFIG_UART4_RXFIFO_FULL_THRESH,
+            .rx_timeout = CONFIG_UART4_RX_TIMEOUT,
+            .txfifo_empty_thresh = CONFIG_UART4_TXFIFO_EMPTY_THRESH,
+        },
+        .pacing = {
+            .char_delay_us = CONFIG_UART4_PACE_CHAR_DELAY_US,
+            .line_delay_us = CONFIG_UART4_PACE_LINE_DELAY_MS * 1000,
+            .block_size = CONFIG_UART4_PACE_BLOCK_SIZE,
+            .block_delay_us = CONFIG_UART4_PACE_BLOCK_DELAY_MS * 1000,
+        },
+    },
+#elif CONFIG_AVAILABLE_BRIDGE_UARTS >= 4
+    [3] = BRIDGE_UNCONFIGURED,
+#endif
+};
+
+/** NVS namespace and key prefix of saved bridge settings */
+#define BRIDGE_NVS_NAMESPACE "bridges"
+#define BRIDGE_NVS_KEY_FMT   "bridge%d"
+
+/**
+ * Layout version of saved settings. Bump when uart_bridge_config_t
+ * changes; saved settings of another version are ignored.
+ */
+#define BRIDGE_CONFIG_VERSION 3
+
+/**
+ * @brief Bridge settings as stored in NVS
+ */
+typedef struct {
+    uint32_t version;            // BRIDGE_CONFIG_VERSION
+    uart_bridge_config_t config;
+} stored_bridge_config_t;
+
 /**
  * Array of bridge instances - one for each UART being managed.
  * UART0 is reserved for debug, so bridges start from UART1.
  */
 static uart_bridge_t bridges[CONFIG_AVAILABLE_BRIDGE_UARTS];
 
+/**
+ * Current settings of each bridge, applied by init_bridge().
+ */
+static uart_bridge_config_t bridge_configs[CONFIG_AVAILABLE_BRIDGE_UARTS];
+
 /**
  * Tracks the number of successfully initialized bridges.
  * Used to report status and determine if initialization succeeded.
  */
 static int active_bridges = 0;
 
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+/** Masks the UART ISR while a TX FIFO is reset */
+static portMUX_TYPE fifo_lock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+/** Poll interval while a paced write is held by XOFF */
+#define PACE_HOLD_POLL_US 1000
+
+/** Size of a pacer's queue of data for the target */
+#define PACE_QUEUE_LEN CONFIG_UART_BUF_SIZE
+
+/**
+ * @brief State of a bridge's paced writes
+ *
+ * Data to pace out is copied into a ring queue, so the bridge keeps
+ * reading the client (and acting on its Telnet commands) while earlier
+ * data is still being paced. The timer callback writes one segment (the
+ * bytes up to the next gap) and re-arms itself for when that segment has
+ * left the wire plus the gap. busy stays set until the queue is empty and
+ * the last gap has elapsed, so later data is spaced correctly too.
+ *
+ * The main task only moves head and the timer callback only tail; both
+ * are read and written under lock. A flush moves tail itself and bumps
+ * gen, so a segment in flight doesn't move it back.
+ */
+struct uart_pacer {
+    uart_bridge_t *bridge;
+    esp_timer_handle_t timer;  // Fires when the next segment is due
+    portMUX_TYPE lock;         // Guards head, tail, gen, busy and the bridge's line_stats
+    size_t head;               // Next free byte in queue
+    size_t tail;               // Next byte to write
+    uint32_t gen;              // Bumped when the queue is flushed
+    uint32_t block_count;      // Bytes written in the current block
+    uint32_t symbol_ns;        // Line time of one character
+    bool busy;                 // Timer running or about to run
+    uint8_t queue[PACE_QUEUE_LEN];
+};
+
+/**
+ * @brief Count bytes written to the target
+ *
+ * The pacer's timer callback counts from the esp_timer task, so while a
+ * bridge has a pacer its line stats are only touched under the pacer's
+ * lock.
+ *
+ * @param bridge Pointer to the bridge instance
+ * @param n Number of bytes written
+ */
+static void count_tx(uart_bridge_t *bridge, size_t n) {
+    uart_pacer_t *p = bridge->pacer;
+    if (p) {
+        portENTER_CRITICAL(&p->lock);
+        bridge->line_stats.tx_bytes += n;
+        portEXIT_CRITICAL(&p->lock);
+    } else {
+        bridge->line_stats.tx_bytes += n;
+    }
+}
+
+/**
+ * @brief Get the number of bytes waiting in a pacer's queue
+ */
+static inline size_t pace_queued(const uart_pacer_t *p) {
+    return (p->head + PACE_QUEUE_LEN - p->tail) % PACE_QUEUE_LEN;
+}
+
+/* ----------------- Function prototypes ----------------- */
+static esp_err_t apply_sw_flow(int uart_port, bool enable);
+static size_t tx_ring_room(int uart_port);
+static uint32_t char_time_ns(int port);
+static void deinit_uart(uart_bridge_t *bridge);
+static esp_err_t apply_fifo_config(int uart_port, const uart_fifo_config_t *cfg);
+static void break_timer_cb(void *arg);
+static void load_config(int bridge_idx);
+static bool pacing_enabled(const uart_pacing_config_t *cfg);
+static esp_err_t pacer_create(uart_bridge_t *bridge);
+static void pacer_delete(uart_bridge_t *bridge);
+static size_t pacer_cancel(uart_bridge_t *bridge);
+static int pacer_queue(uart_bridge_t *bridge, const uint8_t *data, size_t len);
+
+/**
+ * @brief Release the UART driver or DMA streaming context of a bridge
+ *
+ * @param bridge Pointer to the bridge instance
+ */
+static void deinit_uart(uart_bridge_t *bridge) {
+    if (bridge->dma_mode) {
+        uart_dma_deinit(bridge->dma);
+        bridge->dma = NULL;
+    } else {
+        uart_driver_delete(bridge->uart_port);
+        bridge->uart_queue = NULL;
+    }
+}
+
+/**
+ * @brief Assign the bridge's GPIO pins to its UART signals
+ *
+ * A tap input only listens, so its TX pin is left alone.
+ *
+ * @param bridge Pointer to the bridge instance
+ * @return ESP_OK on success, error code on failure
+ */
+static esp_err_t set_uart_pins(uart_bridge_t *bridge) {
+    return uart_set_pin(bridge->uart_port,
+                        bridge->tap ? UART_PIN_NO_CHANGE : bridge->tx_pin, bridge->rx_pin,
+                        bridge->flow.rts_pin >= 0 ? bridge->flow.rts_pin : UART_PIN_NO_CHANGE,
+                        bridge->flow.cts_pin >= 0 ? bridge->flow.cts_pin : UART_PIN_NO_CHANGE);
+}
+
 /**
  * @brief Initialize UART hardware for a bridge
  *
  * Configures and initializes the UART hardware with specified parameters.
- * Sets up the UART driver, parameters, and pin assignments.
+ * Sets up the UART driver (or the DMA streaming backend), parameters, and
+ * pin assignments.
  *
  * @param bridge Pointer to the bridge instance to initialize
  * @return ESP_OK on success, error code on failure
@@ -37,29 +486,56 @@ static esp_err_t init_uart(uart_bridge_t *bridge) {
         .data_bits = UART_DATA_8_BITS,
         .parity    = UART_PARITY_DISABLE,
         .stop_bits = UART_STOP_BITS_1,
-        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .flow_ctrl = bridge->flow.flow_ctrl,
+        .rx_flow_ctrl_thresh = bridge->flow.rx_flow_thresh,
     };
 
-    ESP_LOGI(TAG, "Initializing UART%d (TX:%d, RX:%d, baud:%d)",
-             bridge->uart_port, bridge->tx_pin, bridge->rx_pin, bridge->baud_rate);
+    ESP_LOGI(TAG, "Initializing UART%d (TX:%d, RX:%d, RTS:%d, CTS:%d, baud:%d, flow:%d)",
+             bridge->uart_port, bridge->tx_pin, bridge->rx_pin, bridge->flow.rts_pin,
+             bridge->flow.cts_pin, bridge->baud_rate, bridge->flow.flow_ctrl);
 
-    // Install UART driver with appropriate buffer sizes
-    esp_err_t ret = uart_driver_install(bridge->uart_port, CONFIG_UART_BUF_SIZE,
-                                       CONFIG_UART_BUF_SIZE, 0, NULL, 0);
-    if (ret != ESP_OK) return ret;
+    esp_err_t ret;
+    if (!bridge->dma_mode) {
+        // Install UART driver with appropriate buffer sizes
+        ret = uart_driver_install(bridge->uart_port, CONFIG_UART_BUF_SIZE,
+                                  CONFIG_UART_BUF_SIZE, UART_EVENT_QUEUE_LEN,
+                                  &bridge->uart_queue, UART_INTR_ALLOC_FLAGS);
+        if (ret != ESP_OK) return ret;
+    }
 
     // Configure UART parameters (baud rate, data bits, etc.)
     ret = uart_param_config(bridge->uart_port, &uart_config);
     if (ret != ESP_OK) {
-        uart_driver_delete(bridge->uart_port);
+        deinit_uart(bridge);
         return ret;
     }
 
     // Assign GPIO pins to UART signals
-    ret = uart_set_pin(bridge->uart_port, bridge->tx_pin, bridge->rx_pin,
-                       UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    ret = set_uart_pins(bridge);
     if (ret != ESP_OK) {
-        uart_driver_delete(bridge->uart_port);
+        deinit_uart(bridge);
+        return ret;
+    }
+
+    if (bridge->dtr_pin >= 0) {
+        // DTR is a plain GPIO, released (high) until a client asserts it
+        gpio_reset_pin(bridge->dtr_pin);
+        gpio_set_direction(bridge->dtr_pin, GPIO_MODE_OUTPUT);
+        gpio_set_level(bridge->dtr_pin, 1);
+    }
+
+    if (bridge->dma_mode) {
+        // Hand the configured UART to the UHCI controller
+        ret = uart_dma_init(bridge->uart_port, &bridge->dma);
+    } else {
+        // Override the driver's default FIFO interrupt thresholds
+        ret = apply_fifo_config(bridge->uart_port, &bridge->fifo);
+        if (ret == ESP_OK && bridge->flow.sw_flow) {
+            ret = apply_sw_flow(bridge->uart_port, true);
+        }
+        if (ret != ESP_OK) {
+            deinit_uart(bridge);
+        }
     }
 
     return ret;
@@ -68,7 +544,7 @@ static esp_err_t init_uart(uart_bridge_t *bridge) {
 /**
  * @brief Initialize a single bridge instance
  *
- * Sets up a bridge structure with configuration from menuconfig,
+ * Sets up a bridge structure from its entry in bridge_configs,
  * allocates memory for buffers, and initializes the UART hardware.
  *
  * @param bridge_idx Index of the bridge to initialize (0-based)
@@ -83,60 +559,62 @@ static esp_err_t init_bridge(int bridge_idx) {
     // UART number is bridge_idx + 1 (skipping UART0 which is reserved for debug)
     int uart_num = bridge_idx + 1;
     uart_bridge_t *bridge = &bridges[bridge_idx];
+    const uart_bridge_config_t *cfg = &bridge_configs[bridge_idx];
 
-    // Configure the bridge based on UART number using Kconfig settings
-    switch (uart_num) {
-        case 1: // UART1
-            bridge->uart_port = UART_NUM_1;
-            bridge->tx_pin = CONFIG_UART1_TX_PIN;
-            bridge->rx_pin = CONFIG_UART1_RX_PIN;
-            bridge->baud_rate = CONFIG_UART1_BAUD_RATE;
-            bridge->tcp_port = CONFIG_UART1_TCP_PORT;
-            break;
-
-    #if UART_NUM_MAX > 2
-        case 2: // UART2
-            bridge->uart_port = UART_NUM_2;
-            bridge->tx_pin = CONFIG_UART2_TX_PIN;
-            bridge->rx_pin = CONFIG_UART2_RX_PIN;
-            bridge->baud_rate = CONFIG_UART2_BAUD_RATE;
-            bridge->tcp_port = CONFIG_UART2_TCP_PORT;
-            break;
-    #endif
-
-    #if UART_NUM_MAX > 3
-        case 3: // UART3
-            bridge->uart_port = UART_NUM_3;
-            bridge->tx_pin = CONFIG_UART3_TX_PIN;
-            bridge->rx_pin = CONFIG_UART3_RX_PIN;
-            bridge->baud_rate = CONFIG_UART3_BAUD_RATE;
-            bridge->tcp_port = CONFIG_UART3_TCP_PORT;
-            break;
-    #endif
-
-    #if UART_NUM_MAX > 4
-        case 4: // UART4
-            bridge->uart_port = UART_NUM_4;
-            bridge->tx_pin = CONFIG_UART4_TX_PIN;
-            bridge->rx_pin = CONFIG_UART4_RX_PIN;
-            bridge->baud_rate = CONFIG_UART4_BAUD_RATE;
-            bridge->tcp_port = CONFIG_UART4_TCP_PORT;
-            break;
-    #endif
+    // Start from a clean slate; the bridge may be restarting
+    memset(bridge, 0, sizeof(*bridge));
+    bridge->server_sock = -1;
+    bridge->uart_port = UART_NUM_1 + bridge_idx;
+    bridge->tx_pin = cfg->tx_pin;
+    bridge->rx_pin = cfg->rx_pin;
+    bridge->baud_rate = cfg->baud_rate;
+    bridge->tcp_port = cfg->tcp_port;
+    bridge->flow.rts_pin = cfg->rts_pin;
+    bridge->flow.cts_pin = cfg->cts_pin;
+    bridge->flow.flow_ctrl = cfg->flow_ctrl;
+    bridge->flow.rx_flow_thresh = cfg->rx_flow_thresh;
+    bridge->flow.sw_flow = cfg->sw_flow;
+    bridge->fifo = cfg->fifo;
+    bridge->pacing = cfg->pacing;
+    bridge->dma_mode = cfg->dma_mode;
+    bridge->rfc2217 = cfg->rfc2217;
+    bridge->tls = cfg->tls;
+    bridge->noise = cfg->noise;
+    bridge->dtr_pin = cfg->rfc2217 ? cfg->dtr_pin : -1;
 
-        default:
-            ESP_LOGE(TAG, "Unsupported UART number: %d", uart_num);
-            return ESP_ERR_INVALID_ARG;
+#if defined(CONFIG_UART_TAP_MODE)
+    if (uart_num <= 2) {
+        // Passive tap input: receive only, never influence the link
+        bridge->tap = true;
+        bridge->rfc2217 = false;
+        bridge->flow.sw_flow = false;
+        bridge->flow.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+        bridge->flow.rts_pin = -1;
+        bridge->flow.cts_pin = -1;
+        bridge->dtr_pin = -1;
     }
+#endif
+
+    bridge->flow.high_water = CONFIG_UART_FLOW_HIGH_WATER;
+    bridge->flow.low_water = CONFIG_UART_FLOW_LOW_WATER;
+    bridge->rx_paused = false;
 
-    // Allocate data buffers for this bridge
-    bridge->uart_buf = malloc(CONFIG_UART_BUF_SIZE);
-    bridge->tcp_buf = malloc(CONFIG_UART_BUF_SIZE);
+    // Allocate data buffers for this bridge. In DMA mode, UART data is
+    // forwarded straight from the DMA buffers and TX is sent by DMA.
+    if (bridge->dma_mode) {
+        bridge->uart_buf = NULL;
+        bridge->tcp_buf = heap_caps_malloc(CONFIG_UART_BUF_SIZE, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    } else {
+        bridge->uart_buf = malloc(CONFIG_UART_BUF_SIZE);
+        bridge->tcp_buf = malloc(CONFIG_UART_BUF_SIZE);
+    }
 
-    if (!bridge->uart_buf || !bridge->tcp_buf) {
+    if ((!bridge->dma_mode && !bridge->uart_buf) || !bridge->tcp_buf) {
         ESP_LOGE(TAG, "Failed to allocate buffers for UART%d bridge", uart_num);
         free(bridge->uart_buf);  // Safe even if NULL
         free(bridge->tcp_buf);   // Safe even if NULL
+        bridge->uart_buf = NULL;
+        bridge->tcp_buf = NULL;
         return ESP_ERR_NO_MEM;
     }
 
@@ -147,15 +625,35 @@ static esp_err_t init_bridge(int bridge_idx) {
                  uart_num, esp_err_to_name(ret));
         free(bridge->uart_buf);
         free(bridge->tcp_buf);
+        bridge->uart_buf = NULL;
+        bridge->tcp_buf = NULL;
         return ret;
     }
 
+    if (bridge->rfc2217) {
+        // Ends breaks started with uart_send_break() without blocking
+        const esp_timer_create_args_t timer_args = {
+            .callback = break_timer_cb,
+            .arg = bridge,
+            .name = "uart_break",
+        };
+        if (esp_timer_create(&timer_args, &bridge->break_timer) != ESP_OK) {
+            ESP_LOGW(TAG, "UART%d break timer unavailable", uart_num);
+            bridge->break_timer = NULL;
+        }
+    }
+
+    if (pacing_enabled(&bridge->pacing)) {
+        if (bridge->dma_mode || bridge->tap) {
+            ESP_LOGW(TAG, "UART%d TX pacing ignored in %s mode", uart_num,
+                     bridge->dma_mode ? "DMA" : "tap");
+        } else if (pacer_create(bridge) != ESP_OK) {
+            ESP_LOGW(TAG, "UART%d TX pacing unavailable, sending unpaced", uart_num);
+        }
+    }
+
     // Initialize remaining bridge fields to safe defaults
-    bridge->server_sock = -1;
-    bridge->client_sock = -1;
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
-    bridge->tls_handle = NULL;
-#endif
+    bridge->line_stats.last_error_type = -1;
 
     // Mark the bridge as enabled and ready for use
     bridge->enabled = true;
@@ -165,20 +663,62 @@ static esp_err_t init_bridge(int bridge_idx) {
     return ESP_OK;
 }
 
+/**
+ * @brief Stop a bridge and release its UART and buffers
+ *
+ * The bridge's sockets must already be closed.
+ *
+ * @param bridge_idx Index of the bridge to stop (0-based)
+ */
+static void deinit_bridge(int bridge_idx) {
+    uart_bridge_t *bridge = &bridges[bridge_idx];
+    if (!bridge->enabled) {
+        return;
+    }
+
+    if (bridge->break_timer) {
+        esp_timer_stop(bridge->break_timer);
+        esp_timer_delete(bridge->break_timer);
+        bridge->break_timer = NULL;
+    }
+    pacer_delete(bridge);
+
+    // Clean up UART hardware
+    deinit_uart(bridge);
+
+    // Free allocated buffers
+    free(bridge->uart_buf);
+    free(bridge->tcp_buf);
+    bridge->uart_buf = NULL;
+    bridge->tcp_buf = NULL;
+
+    bridge->enabled = false;
+}
+
+/**
+ * @brief Count the bridges currently running
+ */
+static void update_active_count(void) {
+    active_bridges = 0;
+    for (int i = 0; i < CONFIG_AVAILABLE_BRIDGE_UARTS; i++) {
+        if (bridges[i].enabled) {
+            active_bridges++;
+        }
+    }
+}
+
 /* -------------- Public API Implementation -------------- */
 
 /**
  * @brief Initialize all configured UART bridges
  *
- * Initializes each UART bridge based on Kconfig settings, allocating
- * necessary resources and configuring the hardware.
+ * Initializes each enabled UART bridge from its saved (NVS) or Kconfig
+ * settings, allocating necessary resources and configuring the hardware.
  *
  * @return ESP_OK if at least one bridge initialized successfully, ESP_FAIL otherwise
  */
 esp_err_t uart_manager_init(void) {
-    // Get number of bridges to initialize from configuration
-    int num_bridges = CONFIG_ENABLE_UART_BRIDGES;
-    int max_available = CONFIG_AVAILABLE_BRIDGE_UARTS;
+    int configured = 0;
     active_bridges = 0;
 
     // Initialize bridge array to safe values
@@ -187,20 +727,15 @@ esp_err_t uart_manager_init(void) {
         bridges[i].enabled = false;
         bridges[i].uart_port = -1;
         bridges[i].server_sock = -1;
-        bridges[i].client_sock = -1;
     }
 
-    // Ensure we don't exceed available UARTs
-    if (num_bridges > max_available) {
-        ESP_LOGW(TAG, "Requested %d bridges, but only %d available. Limiting to %d.",
-                 num_bridges, max_available, max_available);
-        num_bridges = max_available;
-    }
-
-    ESP_LOGI(TAG, "Initializing %d UART bridges", num_bridges);
-
-    // Initialize each bridge
-    for (int i = 0; i < num_bridges; i++) {
+    // Initialize each bridge from its saved or default settings
+    for (int i = 0; i < CONFIG_AVAILABLE_BRIDGE_UARTS; i++) {
+        load_config(i);
+        if (!bridge_configs[i].enabled) {
+            continue;
+        }
+        configured++;
         if (init_bridge(i) == ESP_OK) {
             active_bridges++;
         }
@@ -213,7 +748,18 @@ esp_err_t uart_manager_init(void) {
     }
 
     ESP_LOGI(TAG, "Successfully initialized %d/%d bridges",
-             active_bridges, num_bridges);
+             active_bridges, configured);
+
+#if defined(CONFIG_UART_TAP_MODE)
+    if (bridges[0].enabled && bridges[1].enabled) {
+        esp_err_t ret = uart_tap_init(&bridges[0], &bridges[1]);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start passive tap: %s", esp_err_to_name(ret));
+        }
+    } else {
+        ESP_LOGE(TAG, "Passive tap needs both UART1 and UART2");
+    }
+#endif
 
     return ESP_OK;
 }
@@ -248,17 +794,12 @@ void uart_manager_handle_connections(void) {
  * deleting UART drivers and freeing allocated memory.
  */
 void uart_manager_cleanup(void) {
-    for (int i = 0; i < CONFIG_AVAILABLE_BRIDGE_UARTS; i++) {
-        if (bridges[i].enabled) {
-            // Clean up UART hardware
-            uart_driver_delete(bridges[i].uart_port);
-
-            // Free allocated buffers
-            free(bridges[i].uart_buf);
-            free(bridges[i].tcp_buf);
+#if defined(CONFIG_UART_TAP_MODE)
+    uart_tap_deinit();
+#endif
 
-            bridges[i].enabled = false;
-        }
+    for (int i = 0; i < CONFIG_AVAILABLE_BRIDGE_UARTS; i++) {
+        deinit_bridge(i);
     }
 
     active_bridges = 0;
@@ -299,12 +840,16 @@ uart_bridge_t* uart_manager_get_instances(void) {
  * @param timeout_ms Timeout in milliseconds
  * @return Number of bytes read, or -1 on error
  */
-int uart_read_data(uart_bridge_t *bridge, uint8_t *buffer, size_t max_len, uint32_t timeout_ms) {
-    if (!bridge || !bridge->enabled || !buffer || max_len == 0) {
+int UART_HOT_ATTR uart_read_data(uart_bridge_t *bridge, uint8_t *buffer, size_t max_len, uint32_t timeout_ms) {
+    if (!bridge || !bridge->enabled || bridge->dma_mode || !buffer || max_len == 0) {
         return -1;
     }
 
-    return uart_read_bytes(bridge->uart_port, buffer, max_len, pdMS_TO_TICKS(timeout_ms));
+    int len = uart_read_bytes(bridge->uart_port, buffer, max_len, pdMS_TO_TICKS(timeout_ms));
+    if (len > 0) {
+        bridge->line_stats.rx_bytes += len;
+    }
+    return len;
 }
 
 /**
@@ -317,12 +862,21 @@ int uart_read_data(uart_bridge_t *bridge, uint8_t *buffer, size_t max_len, uint3
  * @param len Length of data to write
  * @return Number of bytes written, or -1 on error
  */
-int uart_write_data(uart_bridge_t *bridge, const uint8_t *data, size_t len) {
+int UART_HOT_ATTR uart_write_data(uart_bridge_t *bridge, const uint8_t *data, size_t len) {
     if (!bridge || !bridge->enabled || !data || len == 0) {
         return -1;
     }
 
-    return uart_write_bytes(bridge->uart_port, (const char *)data, len);
+    if (bridge->pacer && pacing_enabled(&bridge->pacing)) {
+        return pacer_queue(bridge, data, len);  // Counts tx_bytes as it goes
+    }
+
+    int written = bridge->dma_mode ? uart_dma_write(bridge->dma, data, len)
+                                   : uart_write_bytes(bridge->uart_port, (const char *)data, len);
+    if (written > 0) {
+        count_tx(bridge, written);
+    }
+    return written;
 }
 
 /**
@@ -332,10 +886,1169 @@ int uart_write_data(uart_bridge_t *bridge, const uint8_t *data, size_t len) {
  * @param available Pointer to store the number of available bytes
  * @return ESP_OK on success, error code otherwise
  */
-esp_err_t uart_get_available_bytes(uart_bridge_t *bridge, size_t *available) {
+esp_err_t UART_HOT_ATTR uart_get_available_bytes(uart_bridge_t *bridge, size_t *available) {
     if (!bridge || !bridge->enabled || !available) {
         return ESP_ERR_INVALID_ARG;
     }
+    if (bridge->dma_mode) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
 
     return uart_get_buffered_data_len(bridge->uart_port, available);
 }
+
+/**
+ * @brief Get the oldest DMA-received chunk in place
+ *
+ * @param bridge Pointer to the bridge instance
+ * @param data Receives a pointer to the data
+ * @return Number of bytes available, 0 if none or not in DMA mode
+ */
+size_t uart_peek_rx(uart_bridge_t *bridge, const uint8_t **data) {
+    if (!bridge || !bridge->enabled || !bridge->dma_mode || !data) {
+        return 0;
+    }
+
+    return uart_dma_peek(bridge->dma, data);
+}
+
+/**
+ * @brief Release the start of the chunk returned by uart_peek_rx()
+ *
+ * @param bridge Pointer to the bridge instance
+ * @param len Number of bytes to release
+ */
+void uart_release_rx(uart_bridge_t *bridge, size_t len) {
+    if (!bridge || !bridge->enabled || !bridge->dma_mode) {
+        return;
+    }
+
+    const uint8_t *data;
+    size_t chunk_len = uart_dma_peek(bridge->dma, &data);
+    bridge->line_stats.rx_bytes += len < chunk_len ? len : chunk_len;
+    uart_dma_release(bridge->dma, len);
+}
+
+/**
+ * @brief Get how much may be queued in the driver's TX buffer
+ *
+ * TX_QUEUE_PASSES main loop passes of line time, enough to keep the line
+ * busy between passes, but at least one FIFO's worth.
+ *
+ * @param uart_port UART number
+ * @return Queue depth in bytes
+ */
+static size_t UART_HOT_ATTR tx_queue_depth(int uart_port) {
+    const size_t max_depth = CONFIG_UART_BUF_SIZE - TX_RING_MARGIN;
+    uint32_t symbol_ns = char_time_ns(uart_port);  // Baud may change at runtime
+    if (symbol_ns == 0) {
+        return SOC_UART_FIFO_LEN;
+    }
+
+    uint64_t depth = TX_QUEUE_PASSES * CONFIG_TASK_DELAY_MS * 1000000ULL / symbol_ns;
+    if (depth < SOC_UART_FIFO_LEN) {
+        return SOC_UART_FIFO_LEN;
+    }
+    return depth < max_depth ? (size_t)depth : max_depth;
+}
+
+/**
+ * @brief Get free space in the driver's TX buffer
+ *
+ * While the target holds the line (XOFF or CTS) the UART stops sending
+ * and the TX buffer fills up; uart_write_bytes() would then block until
+ * the target lets go. Room is held back for the ring buffer's per-item
+ * headers, so a write of this size never waits, and the buffer is kept
+ * to tx_queue_depth().
+ *
+ * @param uart_port UART number
+ * @return Bytes that can be written without blocking
+ */
+static size_t UART_HOT_ATTR tx_ring_room(int uart_port) {
+    size_t depth = tx_queue_depth(uart_port);
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+    size_t free_bytes = 0;
+    if (uart_get_tx_buffer_free_size(uart_port, &free_bytes) != ESP_OK ||
+        free_bytes <= TX_RING_MARGIN) {
+        return 0;
+    }
+    size_t queued = free_bytes < CONFIG_UART_BUF_SIZE ? CONFIG_UART_BUF_SIZE - free_bytes : 0;
+    if (queued >= depth) {
+        return 0;
+    }
+    size_t room = depth - queued;
+    return room < free_bytes - TX_RING_MARGIN ? room : free_bytes - TX_RING_MARGIN;
+#else
+    // No way to ask for free space: wait until everything queued has gone out
+    return uart_wait_tx_done(uart_port, 0) == ESP_OK ? depth : 0;
+#endif
+}
+
+/**
+ * @brief Get how much data can be written to the target without blocking
+ *
+ * @param bridge Pointer to the bridge instance
+ * @return Most bytes uart_write_data() accepts now, 0 if none
+ */
+size_t UART_HOT_ATTR uart_tx_room(uart_bridge_t *bridge) {
+    if (!bridge || !bridge->enabled) {
+        return 0;
+    }
+    if (bridge->pacer && pacing_enabled(&bridge->pacing)) {
+        uart_pacer_t *p = bridge->pacer;
+        portENTER_CRITICAL(&p->lock);
+        size_t queued = pace_queued(p);
+        portEXIT_CRITICAL(&p->lock);
+        return PACE_QUEUE_LEN - 1 - queued;  // One slot tells full from empty
+    }
+    if (bridge->dma_mode) {
+        return uart_dma_tx_busy(bridge->dma) ? 0 : CONFIG_UART_BUF_SIZE;
+    }
+
+    return tx_ring_room(bridge->uart_port);
+}
+
+/* -------------- Bridge Settings -------------- */
+
+/**
+ * @brief Check a GPIO number for use as a bridge pin
+ *
+ * @param pin GPIO number, or -1
+ * @param output Pin is driven by the bridge
+ * @param optional -1 (not connected) is allowed
+ * @return true if the pin can be used
+ */
+static bool valid_pin(int pin, bool output, bool optional) {
+    if (pin < 0) {
+        return optional;
+    }
+    return output ? GPIO_IS_VALID_OUTPUT_GPIO(pin) : GPIO_IS_VALID_GPIO(pin);
+}
+
+/**
+ * @brief Load a bridge's settings from NVS, falling back to Kconfig
+ *
+ * @param bridge_idx Index of the bridge (0-based)
+ */
+static void load_config(int bridge_idx) {
+    bridge_configs[bridge_idx] = kconfig_defaults[bridge_idx];
+
+    nvs_handle_t nvs;
+    if (nvs_open(BRIDGE_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;  // Nothing saved yet
+    }
+
+    char key[16];
+    snprintf(key, sizeof(key), BRIDGE_NVS_KEY_FMT, bridge_idx + 1);
+    stored_bridge_config_t stored;
+    size_t len = sizeof(stored);
+    esp_err_t ret = nvs_get_blob(nvs, key, &stored, &len);
+    nvs_close(nvs);
+
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        return;
+    }
+    if (ret != ESP_OK || len != sizeof(stored) || stored.version != BRIDGE_CONFIG_VERSION) {
+        ESP_LOGW(TAG, "UART%d saved settings unreadable or from another firmware, using defaults",
+                 bridge_idx + 1);
+        return;
+    }
+    if (uart_manager_check_config(bridge_idx, &stored.config) != ESP_OK) {
+        ESP_LOGW(TAG, "UART%d saved settings invalid, using defaults", bridge_idx + 1);
+        return;
+    }
+
+    bridge_configs[bridge_idx] = stored.config;
+    ESP_LOGI(TAG, "UART%d using saved settings", bridge_idx + 1);
+}
+
+/**
+ * @brief Get the current settings of a bridge
+ *
+ * @param bridge_idx Index of the bridge (0-based)
+ * @param cfg Receives the settings
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t uart_manager_get_config(int bridge_idx, uart_bridge_config_t *cfg) {
+    if (bridge_idx < 0 || bridge_idx >= CONFIG_AVAILABLE_BRIDGE_UARTS || !cfg) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *cfg = bridge_configs[bridge_idx];
+    return ESP_OK;
+}
+
+/**
+ * @brief Get the Kconfig default settings of a bridge
+ *
+ * @param bridge_idx Index of the bridge (0-based)
+ * @param cfg Receives the settings
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t uart_manager_get_default_config(int bridge_idx, uart_bridge_config_t *cfg) {
+    if (bridge_idx < 0 || bridge_idx >= CONFIG_AVAILABLE_BRIDGE_UARTS || !cfg) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *cfg = kconfig_defaults[bridge_idx];
+    return ESP_OK;
+}
+
+/**
+ * @brief Check settings before applying them to a bridge
+ *
+ * @param bridge_idx Index of the bridge (0-based)
+ * @param cfg Settings to check
+ * @return ESP_OK if the settings can be applied, error code otherwise
+ */
+esp_err_t uart_manager_check_config(int bridge_idx, const uart_bridge_config_t *cfg) {
+    if (bridge_idx < 0 || bridge_idx >= CONFIG_AVAILABLE_BRIDGE_UARTS || !cfg) {
+        return ESP_ERR_INVALID_ARG;
+    }
+#if defined(CONFIG_UART_TAP_MODE)
+    if (bridge_idx <= 1) {
+        return ESP_ERR_NOT_SUPPORTED;  // Tap inputs are fixed at build time
+    }
+#endif
+    if (!cfg->enabled) {
+        return ESP_OK;
+    }
+
+    if (!valid_pin(cfg->tx_pin, true, false) || !valid_pin(cfg->rx_pin, false, false) ||
+        !valid_pin(cfg->rts_pin, true, true) || !valid_pin(cfg->cts_pin, false, true) ||
+        !valid_pin(cfg->dtr_pin, true, true)) {
+        ESP_LOGW(TAG, "UART%d: invalid pin", bridge_idx + 1);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (cfg->baud_rate < 300 || cfg->baud_rate > 5000000 ||
+        cfg->tcp_port < 1 || cfg->tcp_port > 65535) {
+        ESP_LOGW(TAG, "UART%d: invalid baud rate or TCP port", bridge_idx + 1);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (cfg->flow_ctrl < UART_HW_FLOWCTRL_DISABLE || cfg->flow_ctrl >= UART_HW_FLOWCTRL_MAX ||
+        cfg->rx_flow_thresh < 1 || cfg->rx_flow_thresh > 127 ||
+        ((cfg->flow_ctrl & UART_HW_FLOWCTRL_RTS) && cfg->rts_pin < 0) ||
+        ((cfg->flow_ctrl & UART_HW_FLOWCTRL_CTS) && cfg->cts_pin < 0)) {
+        ESP_LOGW(TAG, "UART%d: invalid flow control settings", bridge_idx + 1);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (cfg->fifo.rxfifo_full_thresh < 1 || cfg->fifo.rxfifo_full_thresh > 127 ||
+        cfg->fifo.rx_timeout < 0 || cfg->fifo.rx_timeout > 126 ||
+        cfg->fifo.txfifo_empty_thresh < 0 || cfg->fifo.txfifo_empty_thresh > 127) {
+        ESP_LOGW(TAG, "UART%d: invalid FIFO thresholds", bridge_idx + 1);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (cfg->dma_mode && (cfg->sw_flow || cfg->rfc2217)) {
+        ESP_LOGW(TAG, "UART%d: DMA mode excludes XON/XOFF and RFC 2217", bridge_idx + 1);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (cfg->tls && cfg->noise) {
+        ESP_LOGW(TAG, "UART%d: choose TLS or Noise, not both", bridge_idx + 1);
+        return ESP_ERR_INVALID_ARG;
+    }
+#if !defined(CONFIG_SSCTE_TLS_ENABLE)
+    if (cfg->tls) {
+        ESP_LOGW(TAG, "UART%d: TLS is not enabled in this build", bridge_idx + 1);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+#endif
+#if !defined(CONFIG_NOISE_ENABLE)
+    if (cfg->noise) {
+        ESP_LOGW(TAG, "UART%d: Noise is not enabled in this build", bridge_idx + 1);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+#endif
+
+    for (int i = 0; i < CONFIG_AVAILABLE_BRIDGE_UARTS; i++) {
+        if (i != bridge_idx && bridge_configs[i].enabled &&
+            bridge_configs[i].tcp_port == cfg->tcp_port) {
+            ESP_LOGW(TAG, "UART%d: TCP port %d already used by UART%d",
+                     bridge_idx + 1, cfg->tcp_port, i + 1);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Apply new settings to a bridge and restart it
+ *
+ * @param bridge_idx Index of the bridge (0-based)
+ * @param cfg New settings
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t uart_manager_set_config(int bridge_idx, const uart_bridge_config_t *cfg) {
+    esp_err_t ret = uart_manager_check_config(bridge_idx, cfg);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    uart_bridge_t *bridge = &bridges[bridge_idx];
+    if (bridge->server_sock >= 0 || bridge->conn) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uart_bridge_config_t previous = bridge_configs[bridge_idx];
+    bool was_enabled = bridge->enabled;
+
+    deinit_bridge(bridge_idx);
+    bridge_configs[bridge_idx] = *cfg;
+
+    if (cfg->enabled) {
+        ret = init_bridge(bridge_idx);
+        if (ret != ESP_OK) {
+            bridge_configs[bridge_idx] = previous;
+            if (was_enabled && init_bridge(bridge_idx) != ESP_OK) {
+                ESP_LOGE(TAG, "UART%d failed to restart with its previous settings", bridge_idx + 1);
+            }
+        }
+    } else {
+        ESP_LOGI(TAG, "Bridge %d (UART%d) stopped", bridge_idx, bridge_idx + 1);
+    }
+
+    update_active_count();
+    return ret;
+}
+
+/**
+ * @brief Save the current settings of a bridge to NVS
+ *
+ * @param bridge_idx Index of the bridge (0-based)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t uart_manager_save_config(int bridge_idx) {
+    if (bridge_idx < 0 || bridge_idx >= CONFIG_AVAILABLE_BRIDGE_UARTS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    stored_bridge_config_t stored;
+    memset(&stored, 0, sizeof(stored));
+    stored.version = BRIDGE_CONFIG_VERSION;
+    stored.config = bridge_configs[bridge_idx];
+
+    char key[16];
+    snprintf(key, sizeof(key), BRIDGE_NVS_KEY_FMT, bridge_idx + 1);
+
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(BRIDGE_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = nvs_set_blob(nvs, key, &stored, sizeof(stored));
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "UART%d settings saved", bridge_idx + 1);
+    }
+    return ret;
+}
+
+/**
+ * @brief Remove the saved settings of a bridge from NVS
+ *
+ * @param bridge_idx Index of the bridge (0-based)
+ * @return ESP_OK on success (also when nothing was saved), error code otherwise
+ */
+esp_err_t uart_manager_erase_config(int bridge_idx) {
+    if (bridge_idx < 0 || bridge_idx >= CONFIG_AVAILABLE_BRIDGE_UARTS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    char key[16];
+    snprintf(key, sizeof(key), BRIDGE_NVS_KEY_FMT, bridge_idx + 1);
+
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(BRIDGE_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = nvs_erase_key(nvs, key);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        ret = ESP_OK;
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return ret;
+}
+
+/* -------------- FIFO Tuning -------------- */
+
+/**
+ * @brief Program FIFO interrupt thresholds into the UART driver
+ *
+ * @param uart_port UART number
+ * @param cfg Thresholds to apply
+ * @return ESP_OK on success, error code otherwise
+ */
+static esp_err_t apply_fifo_config(int uart_port, const uart_fifo_config_t *cfg) {
+    esp_err_t ret = uart_set_rx_full_threshold(uart_port, cfg->rxfifo_full_thresh);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "UART%d invalid RX FIFO full threshold %d", uart_port, cfg->rxfifo_full_thresh);
+        return ret;
+    }
+
+    ret = uart_set_rx_timeout(uart_port, cfg->rx_timeout);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "UART%d invalid RX timeout %d", uart_port, cfg->rx_timeout);
+        return ret;
+    }
+
+    ret = uart_set_tx_empty_threshold(uart_port, cfg->txfifo_empty_thresh);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "UART%d invalid TX FIFO empty threshold %d", uart_port, cfg->txfifo_empty_thresh);
+    }
+    return ret;
+}
+
+/**
+ * @brief Change FIFO interrupt thresholds for a bridge
+ *
+ * @param bridge Pointer to the bridge instance
+ * @param cfg New thresholds
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t uart_set_fifo_config(uart_bridge_t *bridge, const uart_fifo_config_t *cfg) {
+    if (!bridge || !bridge->enabled || !cfg || cfg->rxfifo_full_thresh < 1 ||
+        cfg->rx_timeout < 0 || cfg->txfifo_empty_thresh < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (bridge->dma_mode) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    esp_err_t ret = apply_fifo_config(bridge->uart_port, cfg);
+    if (ret != ESP_OK) {
+        // Leave the hardware matching the settings we report
+        apply_fifo_config(bridge->uart_port, &bridge->fifo);
+        return ret;
+    }
+
+    bridge->fifo = *cfg;
+    ESP_LOGI(TAG, "UART%d FIFO: rx full %d, rx timeout %d, tx empty %d",
+             bridge->uart_port, cfg->rxfifo_full_thresh, cfg->rx_timeout, cfg->txfifo_empty_thresh);
+    return ESP_OK;
+}
+
+/* -------------- TX Pacing -------------- */
+
+/**
+ * @brief Check whether any pacing gap is configured
+ */
+static bool pacing_enabled(const uart_pacing_config_t *cfg) {
+    return cfg->char_delay_us || cfg->line_delay_us || (cfg->block_size && cfg->block_delay_us);
+}
+
+/**
+ * @brief Get the line time of one character at the current line settings
+ *
+ * @param port UART number
+ * @return Character time in nanoseconds
+ */
+static uint32_t char_time_ns(int port) {
+    uint32_t baud = 0;
+    uart_word_length_t data_bits = UART_DATA_8_BITS;
+    uart_parity_t parity = UART_PARITY_DISABLE;
+    uart_stop_bits_t stop_bits = UART_STOP_BITS_1;
+
+    if (uart_get_baudrate(port, &baud) != ESP_OK || baud == 0) {
+        return 0;
+    }
+    uart_get_word_length(port, &data_bits);
+    uart_get_parity(port, &parity);
+    uart_get_stop_bits(port, &stop_bits);
+
+    // Start bit, data bits, optional parity bit, stop bits (1.5 rounded up)
+    uint32_t bits = 1 + 5 + (uint32_t)data_bits + (parity != UART_PARITY_DISABLE ? 1 : 0) +
+                    (stop_bits == UART_STOP_BITS_1 ? 1 : 2);
+    return (uint32_t)(bits * 1000000000ULL / baud);
+}
+
+/**
+ * @brief Write the next segment of a paced write (esp_timer callback)
+ *
+ * @param arg Pacer
+ */
+static void pace_timer_cb(void *arg) {
+    uart_pacer_t *p = arg;
+    uart_bridge_t *bridge = p->bridge;
+    const uart_pacing_config_t *cfg = &bridge->pacing;
+
+    portENTER_CRITICAL(&p->lock);
+    size_t tail = p->tail;
+    size_t head = p->head;
+    uint32_t gen = p->gen;
+    if (tail == head) {
+        p->busy = false;  // Final gap has elapsed
+    }
+    portEXIT_CRITICAL(&p->lock);
+    if (tail == head) {
+        return;
+    }
+
+    // Held while the target holds the line, without blocking the timer task
+    size_t room = tx_ring_room(bridge->uart_port);
+    if (room == 0) {
+        esp_timer_start_once(p->timer, PACE_HOLD_POLL_US);
+        return;
+    }
+
+    // The segment ends at the first byte that is followed by a gap, where
+    // the TX buffer is full, or where the queue wraps
+    size_t stop = head > tail ? head : PACE_QUEUE_LEN;
+    size_t end = tail;
+    uint32_t gap_us = 0;
+    while (end < stop && gap_us == 0 && end - tail < room) {
+        uint8_t c = p->queue[end++];
+        gap_us = cfg->char_delay_us;
+
+        // CR LF is one line ending, so only the LF gets the gap
+        size_t next = end % PACE_QUEUE_LEN;
+        bool eol = c == '\n' || (c == '\r' && (next == head || p->queue[next] != '\n'));
+        if (eol && cfg->line_delay_us > gap_us) {
+            gap_us = cfg->line_delay_us;
+        }
+        if (cfg->block_size && ++p->block_count >= cfg->block_size) {
+            p->block_count = 0;
+            if (cfg->block_delay_us > gap_us) {
+                gap_us = cfg->block_delay_us;
+            }
+        }
+    }
+
+    size_t n = end - tail;
+    int written = uart_write_bytes(bridge->uart_port, (const char *)p->queue + tail, n);
+
+    portENTER_CRITICAL(&p->lock);
+    if (written > 0) {
+        bridge->line_stats.tx_bytes += written;
+    }
+    if (p->gen == gen) {
+        p->tail = end % PACE_QUEUE_LEN;
+    }
+    portEXIT_CRITICAL(&p->lock);
+
+    uint64_t wire_us = ((uint64_t)n * p->symbol_ns + 999) / 1000;
+    esp_timer_start_once(p->timer, wire_us + gap_us);
+}
+
+/**
+ * @brief Allocate the pacer of a bridge
+ *
+ * @param bridge Pointer to the bridge instance
+ * @return ESP_OK on success, error code otherwise
+ */
+static esp_err_t pacer_create(uart_bridge_t *bridge) {
+    if (bridge->pacer) {
+        return ESP_OK;
+    }
+
+    uart_pacer_t *p = calloc(1, sizeof(*p));
+    if (!p) {
+        return ESP_ERR_NO_MEM;
+    }
+    p->bridge = bridge;
+    portMUX_INITIALIZE(&p->lock);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = pace_timer_cb,
+        .arg = p,
+        .name = "uart_pace",
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &p->timer);
+    if (ret != ESP_OK) {
+        free(p);
+        return ret;
+    }
+
+    bridge->pacer = p;
+    return ESP_OK;
+}
+
+/**
+ * @brief Stop any paced write and free the pacer of a bridge
+ *
+ * @param bridge Pointer to the bridge instance
+ */
+static void pacer_delete(uart_bridge_t *bridge) {
+    if (!bridge->pacer) {
+        return;
+    }
+
+    esp_timer_stop(bridge->pacer->timer);
+    esp_timer_delete(bridge->pacer->timer);
+    free(bridge->pacer);
+    bridge->pacer = NULL;
+}
+
+/**
+ * @brief Drop the data still queued for pacing
+ *
+ * @param bridge Pointer to the bridge instance
+ * @return Number of bytes dropped
+ */
+static size_t pacer_cancel(uart_bridge_t *bridge) {
+    uart_pacer_t *p = bridge->pacer;
+    if (!p) {
+        return 0;
+    }
+
+    // If the timer was armed it won't fire now; if its callback is running
+    // it re-arms itself, finds the queue empty and clears busy
+    bool stopped = esp_timer_stop(p->timer) == ESP_OK;
+
+    portENTER_CRITICAL(&p->lock);
+    size_t dropped = pace_queued(p);
+    p->tail = p->head;
+    p->gen++;
+    if (stopped) {
+        p->busy = false;
+    }
+    portEXIT_CRITICAL(&p->lock);
+    return dropped;
+}
+
+/**
+ * @brief Queue data to be paced out to the target
+ *
+ * If no paced write is in progress, the first segment is written right
+ * away; the rest follow from the timer.
+ *
+ * @param bridge Pointer to the bridge instance
+ * @param data Data to send
+ * @param len Number of bytes
+ * @return Number of bytes accepted (less than len if the queue is full)
+ */
+static int pacer_queue(uart_bridge_t *bridge, const uint8_t *data, size_t len) {
+    uart_pacer_t *p = bridge->pacer;
+
+    // tail only ever moves towards head (timer callback or flush), so the
+    // free space seen here can only grow while it is filled
+    portENTER_CRITICAL(&p->lock);
+    size_t head = p->head;
+    size_t free_bytes = PACE_QUEUE_LEN - 1 - pace_queued(p);
+    portEXIT_CRITICAL(&p->lock);
+
+    if (len > free_bytes) {
+        len = free_bytes;
+    }
+    size_t first = PACE_QUEUE_LEN - head;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(p->queue + head, data, first);
+    memcpy(p->queue, data + first, len - first);
+
+    portENTER_CRITICAL(&p->lock);
+    p->head = (head + len) % PACE_QUEUE_LEN;
+    bool start = !p->busy && len > 0;
+    if (start) {
+        p->busy = true;
+    }
+    portEXIT_CRITICAL(&p->lock);
+
+    if (start) {
+        p->symbol_ns = char_time_ns(bridge->uart_port);  // Baud may change at runtime
+        pace_timer_cb(p);
+    }
+    return len;
+}
+
+/**
+ * @brief Change TX pacing for a bridge
+ *
+ * @param bridge Pointer to the bridge instance
+ * @param cfg New pacing settings
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t uart_set_pacing(uart_bridge_t *bridge, const uart_pacing_config_t *cfg) {
+    if (!bridge || !bridge->enabled || !cfg) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (bridge->dma_mode || bridge->tap) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (bridge->pacer) {
+        uart_pacer_t *p = bridge->pacer;
+        portENTER_CRITICAL(&p->lock);
+        bool busy = p->busy;
+        portEXIT_CRITICAL(&p->lock);
+        if (busy) {
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+
+    if (pacing_enabled(cfg)) {
+        esp_err_t ret = pacer_create(bridge);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        bridge->pacer->block_count = 0;
+    }
+
+    bridge->pacing = *cfg;
+    ESP_LOGI(TAG, "UART%d TX pacing: char %" PRIu32 " us, line %" PRIu32 " us, %" PRIu32
+             " us every %" PRIu32 " bytes", bridge->uart_port, cfg->char_delay_us,
+             cfg->line_delay_us, cfg->block_delay_us, cfg->block_size);
+    return ESP_OK;
+}
+
+/* -------------- Modem Lines -------------- */
+
+/**
+ * @brief Drive the DTR output of a bridge
+ *
+ * @param bridge Pointer to the bridge instance
+ * @param active true to assert DTR (pin low)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t uart_set_dtr(uart_bridge_t *bridge, bool active) {
+    if (!bridge || !bridge->enabled) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (bridge->dtr_pin < 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    return gpio_set_level(bridge->dtr_pin, active ? 0 : 1);
+}
+
+/**
+ * @brief Drive the RTS output of a bridge manually
+ *
+ * @param bridge Pointer to the bridge instance
+ * @param active true to assert RTS (pin low)
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t uart_set_rts_line(uart_bridge_t *bridge, bool active) {
+    if (!bridge || !bridge->enabled) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (bridge->flow.rts_pin < 0 || (bridge->flow.flow_ctrl & UART_HW_FLOWCTRL_RTS)) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    return uart_set_rts(bridge->uart_port, active ? 1 : 0);
+}
+
+/**
+ * @brief Start or stop a break condition on the TX line
+ *
+ * @param bridge Pointer to the bridge instance
+ * @param on true to start the break
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t uart_set_break(uart_bridge_t *bridge, bool on) {
+    if (!bridge || !bridge->enabled) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // An inverted idle TX line is a continuous space, i.e. a break
+    return uart_set_line_inverse(bridge->uart_port,
+                                 on ? UART_SIGNAL_TXD_INV : UART_SIGNAL_INV_DISABLE);
+}
+
+/**
+ * @brief End a timed break (esp_timer callback)
+ *
+ * @param arg Bridge instance
+ */
+static void break_timer_cb(void *arg) {
+    uart_set_break((uart_bridge_t *)arg, false);
+}
+
+/**
+ * @brief Send a break of the given duration without blocking
+ *
+ * @param bridge Pointer to the bridge instance
+ * @param duration_ms Break length in milliseconds
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t uart_send_break(uart_bridge_t *bridge, uint32_t duration_ms) {
+    if (!bridge || !bridge->enabled || duration_ms == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!bridge->break_timer) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    esp_timer_stop(bridge->break_timer);  // Restart a break already in progress
+    esp_err_t ret = uart_set_break(bridge, true);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return esp_timer_start_once(bridge->break_timer, (uint64_t)duration_ms * 1000);
+}
+
+/* -------------- Urgent Data -------------- */
+
+/**
+ * @brief Write data straight into the UART TX FIFO
+ *
+ * @param bridge Pointer to the bridge instance
+ * @param data Data to send
+ * @param len Number of bytes
+ * @return Number of bytes written, or -1 on error
+ */
+int uart_write_urgent(uart_bridge_t *bridge, const uint8_t *data, size_t len) {
+    if (!bridge || !bridge->enabled || bridge->dma_mode || !data || len == 0) {
+        return -1;
+    }
+
+    int written = uart_tx_chars(bridge->uart_port, (const char *)data, len);
+    if (written > 0) {
+        count_tx(bridge, written);
+    }
+    return written;
+}
+
+/**
+ * @brief Discard data queued for the target
+ *
+ * Drops the rest of a paced write and whatever is in the TX FIFO. The
+ * driver has no call to drop its TX buffer; tx_ring_room() keeps that to
+ * TX_QUEUE_PASSES main loop passes of line time, which still go out.
+ * Received data and line settings are left alone.
+ *
+ * @param bridge Pointer to the bridge instance
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t uart_flush_tx(uart_bridge_t *bridge) {
+    if (!bridge || !bridge->enabled) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (bridge->dma_mode || bridge->tap) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    size_t dropped = pacer_cancel(bridge);
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    // The driver's ISR refills the FIFO from its TX buffer. The driver was
+    // installed from the main loop's task, so the ISR runs on this core
+    // and can't step in while interrupts are masked here.
+    uart_dev_t *hw = UART_LL_GET_HW(bridge->uart_port);
+    portENTER_CRITICAL(&fifo_lock);
+    dropped += SOC_UART_FIFO_LEN - uart_ll_get_txfifo_len(hw);
+    uart_ll_txfifo_rst(hw);
+    portEXIT_CRITICAL(&fifo_lock);
+#endif
+
+    bridge->line_stats.tx_discarded += dropped;
+    ESP_LOGD(TAG, "UART%d TX flushed, %u bytes dropped", bridge->uart_port, (unsigned)dropped);
+    return ESP_OK;
+}
+
+/**
+ * @brief Discard data received from the target and not yet forwarded
+ *
+ * @param bridge Pointer to the bridge instance
+ * @return Number of bytes discarded
+ */
+size_t uart_flush_rx(uart_bridge_t *bridge) {
+    if (!bridge || !bridge->enabled || bridge->tap) {
+        return 0;
+    }
+
+    size_t dropped = 0;
+    if (bridge->dma_mode) {
+        const uint8_t *data;
+        size_t len;
+        while ((len = uart_dma_peek(bridge->dma, &data)) > 0) {
+            uart_dma_release(bridge->dma, len);
+            dropped += len;
+        }
+    } else {
+        uart_get_buffered_data_len(bridge->uart_port, &dropped);
+        uart_flush_input(bridge->uart_port);
+    }
+
+    bridge->line_stats.rx_discarded += dropped;
+    ESP_LOGD(TAG, "UART%d RX flushed, %u bytes dropped", bridge->uart_port, (unsigned)dropped);
+    return dropped;
+}
+
+/* -------------- Flow Control -------------- */
+
+/**
+ * @brief Send a flow control character ahead of queued TX data
+ *
+ * Writes straight into the hardware FIFO, bypassing the driver's TX
+ * ring buffer, so the target sees it without waiting for the backlog.
+ *
+ * @param bridge Pointer to the bridge instance
+ * @param c Character to send (XON or XOFF)
+ * @return true if the character was queued in the FIFO
+ */
+static bool send_flow_char(uart_bridge_t *bridge, char c) {
+    return uart_tx_chars(bridge->uart_port, &c, 1) == 1;
+}
+
+/**
+ * @brief Switch the UART's own XON/XOFF handling on or off
+ *
+ * With it on, the UART stops transmitting as soon as the target sends
+ * XOFF and resumes on XON, holding whatever is still in its TX FIFO and
+ * the driver's TX buffer. Both characters are removed from the received
+ * data by the hardware.
+ *
+ * @param uart_port UART number
+ * @param enable true to honour XON/XOFF from the target
+ * @return ESP_OK on success, error code otherwise
+ */
+static esp_err_t apply_sw_flow(int uart_port, bool enable) {
+    return uart_set_sw_flow_ctrl(uart_port, enable, SW_FLOW_XON_THRESH, SW_FLOW_XOFF_THRESH);
+}
+
+/**
+ * @brief Release a stale XOFF from the target
+ *
+ * A target that sent XOFF and was then reset or disconnected never sends
+ * the matching XON, which would stall every later session.
+ *
+ * @param bridge Pointer to the bridge instance
+ */
+void uart_clear_xoff(uart_bridge_t *bridge) {
+    if (!bridge || !bridge->enabled || !bridge->flow.sw_flow) {
+        return;
+    }
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    // Also switches XON/XOFF handling off, so it is enabled again below
+    uart_ll_force_xon(bridge->uart_port);
+#else
+    apply_sw_flow(bridge->uart_port, false);
+#endif
+    apply_sw_flow(bridge->uart_port, true);
+}
+
+/**
+ * @brief Change flow control settings for a bridge
+ *
+ * @param bridge Pointer to the bridge instance
+ * @param cfg New flow control settings
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t uart_set_flow_control(uart_bridge_t *bridge, const uart_flow_config_t *cfg) {
+    if (!bridge || !bridge->enabled || !cfg || cfg->low_water >= cfg->high_water ||
+        cfg->flow_ctrl < UART_HW_FLOWCTRL_DISABLE || cfg->flow_ctrl >= UART_HW_FLOWCTRL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Release any pause before the mode changes underneath it
+    if (bridge->rx_paused) {
+        uart_enable_rx_intr(bridge->uart_port);
+        if (bridge->flow.sw_flow) {
+            send_flow_char(bridge, UART_XON);
+        }
+        bridge->rx_paused = false;
+    }
+
+    esp_err_t ret = uart_set_pin(bridge->uart_port, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE,
+                                 cfg->rts_pin >= 0 ? cfg->rts_pin : UART_PIN_NO_CHANGE,
+                                 cfg->cts_pin >= 0 ? cfg->cts_pin : UART_PIN_NO_CHANGE);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = uart_set_hw_flow_ctrl(bridge->uart_port, cfg->flow_ctrl, cfg->rx_flow_thresh);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = apply_sw_flow(bridge->uart_port, cfg->sw_flow);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    bridge->flow = *cfg;
+    ESP_LOGI(TAG, "UART%d flow control: mode %d, XON/XOFF %s, RTS:%d, CTS:%d, thresh %d, water %u/%u",
+             bridge->uart_port, cfg->flow_ctrl, cfg->sw_flow ? "on" : "off", cfg->rts_pin,
+             cfg->cts_pin, cfg->rx_flow_thresh, (unsigned)cfg->high_water, (unsigned)cfg->low_water);
+    return ESP_OK;
+}
+
+/**
+ * @brief Pause or resume the target based on the forwarding backlog
+ *
+ * With RTS, pausing disables the driver's RX interrupt so the hardware
+ * FIFO stops being drained. Once the FIFO reaches the RTS threshold the
+ * UART deasserts RTS by itself, so no received byte is dropped. With
+ * XON/XOFF, the control character is sent ahead of any queued TX data,
+ * and the UART sends XOFF itself should its RX FIFO still fill up.
+ *
+ * @param bridge Pointer to the bridge instance
+ */
+void uart_flow_update(uart_bridge_t *bridge) {
+    // In DMA mode the UART's own RTS threshold applies whenever no RX buffer is armed
+    if (!bridge || !bridge->enabled || bridge->dma_mode || bridge->tap) {
+        return;
+    }
+
+    bool hw = (bridge->flow.flow_ctrl & UART_HW_FLOWCTRL_RTS) != 0;
+    bool sw = bridge->flow.sw_flow;
+    if (!hw && !sw) {
+        return;
+    }
+
+    size_t backlog = 0;
+    if (uart_get_buffered_data_len(bridge->uart_port, &backlog) != ESP_OK) {
+        return;
+    }
+
+    if (backlog >= bridge->flow.high_water) {
+        if (!bridge->rx_paused) {
+            // If the FIFO is full, try again on the next pass
+            if (sw && !send_flow_char(bridge, UART_XOFF)) {
+                return;
+            }
+            bridge->line_stats.flow_pauses++;
+            bridge->rx_paused = true;
+            ESP_LOGD(TAG, "UART%d backlog %u, pausing target", bridge->uart_port, (unsigned)backlog);
+        }
+        if (hw) {
+            // Re-applied every time: the driver re-enables RX after a buffer-full condition
+            uart_disable_rx_intr(bridge->uart_port);
+        }
+    } else if (bridge->rx_paused && backlog <= bridge->flow.low_water) {
+        if (sw && !send_flow_char(bridge, UART_XON)) {
+            return;
+        }
+        if (hw) {
+            uart_enable_rx_intr(bridge->uart_port);
+        }
+        bridge->rx_paused = false;
+        ESP_LOGD(TAG, "UART%d backlog %u, resuming target", bridge->uart_port, (unsigned)backlog);
+    }
+}
+
+/* -------------- Line Error Accounting -------------- */
+
+/**
+ * @brief Record a line error reported by the UART driver
+ *
+ * The error offset is the number of bytes already read plus whatever is
+ * still waiting in the driver buffer, i.e. the stream position at which
+ * the condition was detected.
+ *
+ * @param bridge Pointer to the bridge instance
+ * @param type Driver event type (uart_event_type_t)
+ */
+static void record_line_error(uart_bridge_t *bridge, int type) {
+    size_t buffered = 0;
+    uart_get_buffered_data_len(bridge->uart_port, &buffered);
+
+    bridge->line_stats.last_error_offset = bridge->line_stats.rx_bytes + buffered;
+    bridge->line_stats.last_error_type = type;
+}
+
+/**
+ * @brief Drain the UART driver event queue for a bridge
+ *
+ * Counts overflow, framing, parity and break events. Data events are
+ * ignored since data is read directly in the forwarding path.
+ *
+ * @param bridge Pointer to the bridge instance
+ */
+void uart_poll_events(uart_bridge_t *bridge) {
+    // Tap inputs are drained by the tap task
+    if (!bridge || !bridge->enabled || !bridge->uart_queue || bridge->tap) {
+        return;
+    }
+
+    uart_event_t event;
+    while (xQueueReceive(bridge->uart_queue, &event, 0) == pdTRUE) {
+        uart_count_event(bridge, event.type);
+    }
+}
+
+/**
+ * @brief Count a UART driver event in the bridge's line statistics
+ *
+ * @param bridge Pointer to the bridge instance
+ * @param event_type Driver event type (uart_event_type_t)
+ */
+void uart_count_event(uart_bridge_t *bridge, int event_type) {
+    switch (event_type) {
+        case UART_FIFO_OVF:
+            bridge->line_stats.fifo_overflow++;
+            record_line_error(bridge, event_type);
+            ESP_LOGW(TAG, "UART%d RX FIFO overflow at offset %" PRIu64,
+                     bridge->uart_port, bridge->line_stats.last_error_offset);
+            break;
+
+        case UART_BUFFER_FULL:
+            bridge->line_stats.buffer_full++;
+            record_line_error(bridge, event_type);
+            ESP_LOGW(TAG, "UART%d RX buffer full at offset %" PRIu64,
+                     bridge->uart_port, bridge->line_stats.last_error_offset);
+            break;
+
+        case UART_FRAME_ERR:
+            bridge->line_stats.frame_errors++;
+            record_line_error(bridge, event_type);
+            ESP_LOGD(TAG, "UART%d framing error", bridge->uart_port);
+            break;
+
+        case UART_PARITY_ERR:
+            bridge->line_stats.parity_errors++;
+            record_line_error(bridge, event_type);
+            ESP_LOGD(TAG, "UART%d parity error", bridge->uart_port);
+            break;
+
+        case UART_BREAK:
+            bridge->line_stats.breaks++;
+            record_line_error(bridge, event_type);
+            ESP_LOGD(TAG, "UART%d break detected", bridge->uart_port);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Copy a bridge's line error counters
+ *
+ * @param bridge Pointer to the bridge instance
+ * @param stats Pointer to store the counters
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG otherwise
+ */
+esp_err_t uart_get_line_stats(uart_bridge_t *bridge, uart_line_stats_t *stats) {
+    if (!bridge || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (bridge->pacer) {
+        portENTER_CRITICAL(&bridge->pacer->lock);
+        *stats = bridge->line_stats;
+        portEXIT_CRITICAL(&bridge->pacer->lock);
+    } else {
+        *stats = bridge->line_stats;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Clear a bridge's line error counters
+ *
+ * @param bridge Pointer to the bridge instance
+ */
+void uart_reset_line_stats(uart_bridge_t *bridge) {
+    if (!bridge) {
+        return;
+    }
+
+    uart_line_stats_t cleared = { .rx_bytes = bridge->line_stats.rx_bytes, .last_error_type = -1 };
+    if (bridge->pacer) {
+        portENTER_CRITICAL(&bridge->pacer->lock);
+        bridge->line_stats = cleared;
+        portEXIT_CRITICAL(&bridge->pacer->lock);
+    } else {
+        bridge->line_stats = cleared;
+    }
+}
@@ -14,10 +14,134 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
-#include "esp_tls.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "uart_dma.h"
+#include "transport.h"
+
+/**
+ * Interrupt allocation flags for the UART drivers. With
+ * CONFIG_UART_HOT_PATH_IN_IRAM the ISR keeps draining the RX FIFO while
+ * the flash cache is disabled for SPIFFS/NVS writes.
+ */
+#if defined(CONFIG_UART_HOT_PATH_IN_IRAM)
+#define UART_INTR_ALLOC_FLAGS ESP_INTR_FLAG_IRAM
+#else
+#define UART_INTR_ALLOC_FLAGS 0
+#endif
+
+/**
+ * Placement of the per-byte forwarding functions. With
+ * CONFIG_UART_HOT_PATH_IN_IRAM they run from IRAM, so they do not miss
+ * in the flash cache after flash operations have evicted it.
+ */
+#if defined(CONFIG_UART_HOT_PATH_IN_IRAM)
+#define UART_HOT_ATTR IRAM_ATTR
+#else
+#define UART_HOT_ATTR
 #endif
 
+/**
+ * Depth of each bridge's UART driver event queue. Events are drained
+ * every main loop iteration, so this only needs to absorb one iteration.
+ */
+#define UART_EVENT_QUEUE_LEN 32
+
+/**
+ * @brief UART line error and overflow counters for a bridge
+ *
+ * Filled from the UART driver event queue. Offsets are positions in the
+ * received byte stream (counted from driver install) at which the driver
+ * reported the condition, so they can be correlated with captured data.
+ */
+typedef struct {
+    uint32_t fifo_overflow;      // Hardware RX FIFO overflowed (UART_FIFO_OVF)
+    uint32_t buffer_full;        // Driver ring buffer full (UART_BUFFER_FULL)
+    uint32_t frame_errors;       // Framing errors (UART_FRAME_ERR)
+    uint32_t parity_errors;      // Parity errors (UART_PARITY_ERR)
+    uint32_t breaks;             // Break conditions detected (UART_BREAK)
+    uint32_t flow_pauses;        // Times the target was paused by flow control
+    uint64_t rx_bytes;           // Total bytes read from the UART
+    uint64_t tx_bytes;           // Total bytes written to the UART
+    uint64_t tx_discarded;       // Bytes for the target dropped by TX flushes
+    uint64_t rx_discarded;       // Bytes for the client dropped by RX flushes
+    uint64_t last_error_offset;  // Stream offset of the most recent error
+    int last_error_type;         // uart_event_type_t of the most recent error (-1 if none)
+} uart_line_stats_t;
+
+/**
+ * @brief Flow control settings for a bridge
+ *
+ * The backlog is the amount of received UART data waiting to be forwarded
+ * to the TCP client. When it reaches high_water the target is paused, and
+ * it is resumed once the backlog drops to low_water.
+ */
+typedef struct {
+    int rts_pin;           // RTS GPIO pin (-1 if not connected)
+    int cts_pin;           // CTS GPIO pin (-1 if not connected)
+    int flow_ctrl;         // Hardware flow control mode (uart_hw_flowcontrol_t)
+    int rx_flow_thresh;    // RX FIFO level at which hardware deasserts RTS
+    size_t high_water;     // Backlog at which the target is paused
+    size_t low_water;      // Backlog at which the target is resumed
+    bool sw_flow;          // XON/XOFF software flow control in both directions
+} uart_flow_config_t;
+
+/**
+ * @brief UART FIFO interrupt thresholds for a bridge
+ *
+ * Trade latency against interrupt load: lower RX thresholds and timeouts
+ * deliver data sooner but raise more interrupts per byte.
+ */
+typedef struct {
+    int rxfifo_full_thresh;  // RX FIFO level (bytes) that raises an RX interrupt
+    int rx_timeout;          // Idle symbol times before a partial FIFO is delivered (0 = off)
+    int txfifo_empty_thresh; // TX FIFO level (bytes) at which it is refilled
+} uart_fifo_config_t;
+
+/**
+ * @brief TX pacing for targets that cannot take data back-to-back
+ *
+ * Gaps are inserted after bytes leave the wire. Where several apply to
+ * the same byte, the longest is used. All zero disables pacing.
+ */
+typedef struct {
+    uint32_t char_delay_us;  // Gap after every byte
+    uint32_t line_delay_us;  // Gap after each line ending (CR, LF or CRLF)
+    uint32_t block_size;     // Bytes per block (0 = no block gaps)
+    uint32_t block_delay_us; // Gap after every block_size bytes
+} uart_pacing_config_t;
+
+/** Paced write state (private to uart_manager.c) */
+typedef struct uart_pacer uart_pacer_t;
+
+/**
+ * @brief Settings of a bridge that can be changed at runtime
+ *
+ * Defaults come from Kconfig. Settings saved with uart_manager_save_config()
+ * are stored in NVS and replace the defaults from the next boot on.
+ */
+typedef struct {
+    bool enabled;                // Bridge is started
+    int tx_pin;                  // TX GPIO pin
+    int rx_pin;                  // RX GPIO pin
+    int rts_pin;                 // RTS GPIO pin (-1 if not connected)
+    int cts_pin;                 // CTS GPIO pin (-1 if not connected)
+    int dtr_pin;                 // DTR GPIO pin for RFC 2217 (-1 if not connected)
+    int baud_rate;               // UART baud rate
+    int tcp_port;                // TCP port number
+    int flow_ctrl;               // Hardware flow control mode (uart_hw_flowcontrol_t)
+    int rx_flow_thresh;          // RX FIFO level at which hardware deasserts RTS
+    bool sw_flow;                // XON/XOFF software flow control
+    bool dma_mode;               // UHCI/GDMA streaming mode
+    bool rfc2217;                // RFC 2217 COM port control
+    bool tls;                    // Clients must use TLS
+    bool noise;                  // Clients must use the Noise channel
+    uart_fifo_config_t fifo;     // FIFO interrupt thresholds
+    uart_pacing_config_t pacing; // TX pacing
+} uart_bridge_config_t;
+
 /**
  * @brief Structure representing a single UART-TCP bridge
  */
@@ -29,26 +153,47 @@ typedef struct {
     int baud_rate;         // UART baud rate
     int tcp_port;          // TCP port number
     bool enabled;          // Whether this bridge is active
+    QueueHandle_t uart_queue; // UART driver event queue (NULL in DMA mode)
+    bool dma_mode;         // Stream through UHCI/GDMA instead of the UART driver
+    uart_dma_ctx_t *dma;   // DMA streaming context (DMA mode only)
+    bool rfc2217;          // Telnet/RFC 2217 COM port control on the TCP port
+    int dtr_pin;           // DTR GPIO pin, active low (-1 if not connected)
+    bool tap;              // Passive tap input (RX only, see uart_tap.h)
+    bool tls;              // Clients must use TLS
+    bool noise;            // Clients must use the Noise channel
+    esp_timer_handle_t break_timer; // Ends timed breaks (RFC 2217 bridges only)
+
+    // FIFO interrupt tuning
+    uart_fifo_config_t fifo; // FIFO thresholds and RX timeout
+
+    // TX pacing
+    uart_pacing_config_t pacing; // Gaps in data sent to the target
+    uart_pacer_t *pacer;   // Paced write in progress (NULL until pacing is used)
+
+    // Flow control
+    uart_flow_config_t flow; // Flow control settings
+    bool rx_paused;        // Target currently paused by flow control
+
+    // Statistics
+    uart_line_stats_t line_stats; // Line error and overflow counters
 
     // Buffers
-    uint8_t *uart_buf;     // Buffer for UART → TCP direction
+    uint8_t *uart_buf;     // Buffer for UART → TCP direction (unused in DMA mode)
     uint8_t *tcp_buf;      // Buffer for TCP → UART direction
 
     // TCP server
     int server_sock;       // Listening socket
-    int client_sock;       // Connected client socket (-1 if none)
-
-    // TLS support (if globally enabled in the build)
-#if defined(CONFIG_SSCTE_TLS_ENABLE)
-    esp_tls_t *tls_handle; // TLS connection handle (NULL if not using TLS)
-#endif
+    const transport_ops_t *transport; // Transport of the connected client
+    void *conn;            // Connected client (NULL if none)
+    int64_t coalesce_since_us; // When UART data started waiting for a fuller record (0 if none)
 } uart_bridge_t;
 
 /**
  * @brief Initialize all configured UART bridges
  *
- * Initializes UART bridges based on Kconfig settings.
- * The number of bridges is determined by CONFIG_ENABLE_UART_BRIDGES.
+ * Initializes UART bridges from the settings saved in NVS, or from Kconfig
+ * for bridges without saved settings. By default the first
+ * CONFIG_ENABLE_UART_BRIDGES bridges are enabled.
  *
  * @return ESP_OK on success, error code on failure
  */
@@ -89,15 +234,82 @@ int uart_manager_get_active_count(void);
 /**
  * @brief Get the array of bridge instances
  *
+ * The array has CONFIG_AVAILABLE_BRIDGE_UARTS entries; disabled bridges
+ * may sit between enabled ones, so check each entry's enabled flag.
+ *
  * @return Pointer to the array of bridge instances
  */
 uart_bridge_t* uart_manager_get_instances(void);
 
+/**
+ * @brief Get the current settings of a bridge
+ *
+ * @param bridge_idx    Bridge index (0 for UART1).
+ * @param cfg           Receives the settings.
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t uart_manager_get_config(int bridge_idx, uart_bridge_config_t *cfg);
+
+/**
+ * @brief Get the Kconfig default settings of a bridge
+ *
+ * @param bridge_idx    Bridge index (0 for UART1).
+ * @param cfg           Receives the settings.
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t uart_manager_get_default_config(int bridge_idx, uart_bridge_config_t *cfg);
+
+/**
+ * @brief Check settings before applying them to a bridge
+ *
+ * Rejects invalid pins, rates and thresholds, mode combinations that are
+ * not supported, and TCP ports used by another enabled bridge.
+ *
+ * @param bridge_idx    Bridge index (0 for UART1).
+ * @param cfg           Settings to check.
+ * @return ESP_OK if the settings can be applied, ESP_ERR_INVALID_ARG or
+ *         ESP_ERR_NOT_SUPPORTED otherwise.
+ */
+esp_err_t uart_manager_check_config(int bridge_idx, const uart_bridge_config_t *cfg);
+
+/**
+ * @brief Apply new settings to a bridge and restart it
+ *
+ * Reinstalls the bridge's UART driver (or DMA context) with the new
+ * settings; other bridges are not touched. The caller must have closed
+ * the bridge's client and listening socket. If the restart fails, the
+ * previous settings are restored.
+ *
+ * @param bridge_idx    Bridge index (0 for UART1).
+ * @param cfg           New settings.
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t uart_manager_set_config(int bridge_idx, const uart_bridge_config_t *cfg);
+
+/**
+ * @brief Save the current settings of a bridge to NVS
+ *
+ * @param bridge_idx    Bridge index (0 for UART1).
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t uart_manager_save_config(int bridge_idx);
+
+/**
+ * @brief Remove the saved settings of a bridge from NVS
+ *
+ * The Kconfig defaults are used again from the next boot on.
+ *
+ * @param bridge_idx    Bridge index (0 for UART1).
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t uart_manager_erase_config(int bridge_idx);
+
 /**
  * @brief Read data from a UART bridge.
  *
  * Attempts to read up to max_len bytes from the UART associated with the given bridge.
  * Blocks for up to timeout_ms milliseconds if no data is immediately available.
+ * Not available in DMA mode; use uart_peek_rx()/uart_release_rx() instead.
  *
  * @param bridge    Pointer to the UART bridge instance.
  * @param buffer    Buffer to store the received data.
@@ -111,6 +323,9 @@ int uart_read_data(uart_bridge_t *bridge, uint8_t *buffer, size_t max_len, uint3
  * @brief Write data to a UART bridge.
  *
  * Sends the specified data to the UART associated with the given bridge.
+ * In DMA mode the transfer is asynchronous: data must stay untouched until
+ * uart_tx_room() is non-zero again. With TX pacing enabled, data is copied
+ * into the pacing queue and fewer than len bytes are taken if it is full.
  *
  * @param bridge    Pointer to the UART bridge instance.
  * @param data      Pointer to the data to send.
@@ -131,3 +346,219 @@ int uart_write_data(uart_bridge_t *bridge, const uint8_t *data, size_t len);
  */
 esp_err_t uart_get_available_bytes(uart_bridge_t *bridge, size_t *available);
 
+/**
+ * @brief Get received data in place (DMA mode).
+ *
+ * Returns the oldest chunk received by DMA without copying it. The data
+ * stays valid until uart_release_rx(). Always returns 0 in driver mode.
+ *
+ * @param bridge    Pointer to the UART bridge instance.
+ * @param data      Receives a pointer to the data.
+ * @return Number of bytes available at *data.
+ */
+size_t uart_peek_rx(uart_bridge_t *bridge, const uint8_t **data);
+
+/**
+ * @brief Release the chunk returned by uart_peek_rx() (DMA mode).
+ *
+ * Releasing less than the whole chunk leaves the rest for the next
+ * uart_peek_rx().
+ *
+ * @param bridge    Pointer to the UART bridge instance.
+ * @param len       Number of bytes to release from the start of the chunk.
+ */
+void uart_release_rx(uart_bridge_t *bridge, size_t len);
+
+/**
+ * @brief Get how much data the bridge can accept for the target.
+ *
+ * Writing no more than this never blocks. 0 while the target holds the
+ * line with XOFF or CTS and the TX buffer is full, or while a DMA transmit
+ * from the previous call is still in progress. With TX pacing enabled,
+ * the free space in the pacing queue.
+ *
+ * @param bridge    Pointer to the UART bridge instance.
+ * @return Most bytes uart_write_data() accepts now.
+ */
+size_t uart_tx_room(uart_bridge_t *bridge);
+
+/**
+ * @brief Let the UART transmit again after an XOFF from the target.
+ *
+ * For a new client session: a target that sent XOFF and was then reset
+ * never sends the matching XON. No-op unless XON/XOFF is enabled.
+ *
+ * @param bridge    Pointer to the UART bridge instance.
+ */
+void uart_clear_xoff(uart_bridge_t *bridge);
+
+/**
+ * @brief Change a bridge's FIFO interrupt thresholds at runtime.
+ *
+ * Not supported in DMA mode, where received data is delimited by line
+ * idle detection in the UHCI controller instead.
+ *
+ * @param bridge    Pointer to the UART bridge instance.
+ * @param cfg       New thresholds.
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t uart_set_fifo_config(uart_bridge_t *bridge, const uart_fifo_config_t *cfg);
+
+/**
+ * @brief Change a bridge's TX pacing at runtime.
+ *
+ * Paced data is written from a timer, so the caller never waits for the
+ * gaps. Not supported in DMA mode or on tap inputs.
+ *
+ * @param bridge    Pointer to the UART bridge instance.
+ * @param cfg       New pacing settings (all zero to disable).
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE while a paced write is
+ *         in progress, or another error code on failure.
+ */
+esp_err_t uart_set_pacing(uart_bridge_t *bridge, const uart_pacing_config_t *cfg);
+
+/**
+ * @brief Drive the DTR output of a bridge.
+ *
+ * @param bridge    Pointer to the UART bridge instance.
+ * @param active    true to assert DTR (pin low), false to release it.
+ * @return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if no DTR pin is configured.
+ */
+esp_err_t uart_set_dtr(uart_bridge_t *bridge, bool active);
+
+/**
+ * @brief Drive the RTS output of a bridge manually.
+ *
+ * Only possible while hardware RTS flow control is disabled.
+ *
+ * @param bridge    Pointer to the UART bridge instance.
+ * @param active    true to assert RTS (pin low), false to release it.
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t uart_set_rts_line(uart_bridge_t *bridge, bool active);
+
+/**
+ * @brief Start or stop a break condition on the bridge's TX line.
+ *
+ * The TX line is held low by inverting its idle level until the break is
+ * stopped.
+ *
+ * @param bridge    Pointer to the UART bridge instance.
+ * @param on        true to start the break, false to end it.
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t uart_set_break(uart_bridge_t *bridge, bool on);
+
+/**
+ * @brief Send a break of the given duration without blocking.
+ *
+ * The break is ended from a timer, so the caller returns immediately.
+ * Only available on bridges with RFC 2217 enabled.
+ *
+ * @param bridge        Pointer to the UART bridge instance.
+ * @param duration_ms   Break length in milliseconds.
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t uart_send_break(uart_bridge_t *bridge, uint32_t duration_ms);
+
+/**
+ * @brief Write urgent data ahead of everything queued for the target.
+ *
+ * Writes straight into the UART TX FIFO, bypassing the driver's TX buffer.
+ * Only as many bytes as fit in the FIFO are written.
+ *
+ * @param bridge    Pointer to the UART bridge instance.
+ * @param data      Data to send.
+ * @param len       Number of bytes.
+ * @return Number of bytes written, or -1 on error.
+ */
+int uart_write_urgent(uart_bridge_t *bridge, const uint8_t *data, size_t len);
+
+/**
+ * @brief Discard data queued for the target.
+ *
+ * Drops a paced write in progress and the TX FIFO, and counts them in
+ * tx_discarded. The driver's TX buffer is kept short and still goes out
+ * (a few main loop passes of line time). Received data, RX flow control
+ * state and line settings are untouched.
+ *
+ * @param bridge    Pointer to the UART bridge instance.
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t uart_flush_tx(uart_bridge_t *bridge);
+
+/**
+ * @brief Discard data received from the target and not yet forwarded.
+ *
+ * Empties the driver's RX buffer, or releases all DMA chunks, and counts
+ * the bytes in rx_discarded. Data for the target is untouched.
+ *
+ * @param bridge    Pointer to the UART bridge instance.
+ * @return Number of bytes discarded.
+ */
+size_t uart_flush_rx(uart_bridge_t *bridge);
+
+/**
+ * @brief Change a bridge's flow control settings at runtime.
+ *
+ * Reassigns the RTS/CTS pins and reprograms the UART's hardware flow
+ * control. Any pause currently in effect is released first.
+ *
+ * @param bridge    Pointer to the UART bridge instance.
+ * @param cfg       New flow control settings.
+ * @return ESP_OK on success, or an error code on failure.
+ */
+esp_err_t uart_set_flow_control(uart_bridge_t *bridge, const uart_flow_config_t *cfg);
+
+/**
+ * @brief Apply backlog-based flow control for a bridge.
+ *
+ * With RTS or XON/XOFF flow control enabled, pauses the target once the
+ * received data waiting to be forwarded reaches the high-water mark, and
+ * resumes it at the low-water mark. Should be called regularly from the
+ * main loop.
+ *
+ * @param bridge    Pointer to the UART bridge instance.
+ */
+void uart_flow_update(uart_bridge_t *bridge);
+
+/**
+ * @brief Drain pending UART driver events for a bridge.
+ *
+ * Updates the bridge's line error and overflow counters from the driver
+ * event queue without blocking. Should be called regularly from the main
+ * loop, whether or not a client is connected.
+ *
+ * @param bridge    Pointer to the UART bridge instance.
+ */
+void uart_poll_events(uart_bridge_t *bridge);
+
+/**
+ * @brief Count a UART driver event in a bridge's line error counters.
+ *
+ * Used by uart_poll_events() and by tasks that consume a bridge's event
+ * queue themselves. Events other than line errors are ignored.
+ *
+ * @param bridge        Pointer to the UART bridge instance.
+ * @param event_type    Driver event type (uart_event_type_t).
+ */
+void uart_count_event(uart_bridge_t *bridge, int event_type);
+
+/**
+ * @brief Get a snapshot of a bridge's line error counters.
+ *
+ * @param bridge    Pointer to the UART bridge instance.
+ * @param stats     Pointer to store the counters.
+ * @return ESP_OK on success, or ESP_ERR_INVALID_ARG on invalid parameters.
+ */
+esp_err_t uart_get_line_stats(uart_bridge_t *bridge, uart_line_stats_t *stats);
+
+/**
+ * @brief Reset a bridge's line error counters.
+ *
+ * The received byte count is preserved so error offsets stay meaningful.
+ *
+ * @param bridge    Pointer to the UART bridge instance.
+ */
+void uart_reset_line_stats(uart_bridge_t *bridge);
+
@@ -0,0 +1,273 @@
+/*
+ * uart_tap.c
+ *
+ * Passive tap: merges the RX data of two bridges into one record stream.
+ *
+ * A dedicated task waits on both bridges' UART event queues through a
+ * queue set, so data is picked up as soon as either driver delivers it,
+ * regardless of how busy the main loop is. Each read becomes a record in
+ * a stream buffer, which the main loop drains to the TCP client.
+ *
+ * Thread safety: uart_tap_read() and uart_tap_reset() must be called from
+ * the main loop only; the tap task is the only writer of the stream.
+ */
+
+#include "uart_tap.h"
+#include "driver/uart.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/stream_buffer.h"
+#include "sdkconfig.h"
+#include <string.h>
+
+static const char *TAG = "UARTTap";
+
+#if defined(CONFIG_UART_TAP_MODE)
+
+/** Largest payload in a single record */
+#define TAP_CHUNK_MAX 512
+
+/** UART symbol length in bits; tap inputs always run 8N1 */
+#define TAP_SYMBOL_BITS 10
+
+/**
+ * @brief State of one tap input
+ */
+typedef struct {
+    uart_bridge_t *bridge;
+    uint8_t dir;                   // UART_TAP_DIR_*
+    uint8_t flags;                 // Flags for the next record of this input
+    uint32_t symbol_ns;            // Line time of one character
+} tap_input_t;
+
+static struct {
+    tap_input_t inputs[2];
+    QueueSetHandle_t set;
+    StreamBufferHandle_t stream;
+    TaskHandle_t task;
+    volatile uint32_t dropped;     // Records dropped since boot
+    bool dropped_pending;          // Flag the next record as following a drop
+    uint8_t record[UART_TAP_HEADER_LEN + TAP_CHUNK_MAX]; // Record being built
+} tap;
+
+/**
+ * @brief Store a value little-endian
+ */
+static void put_le(uint8_t *out, uint64_t value, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/**
+ * @brief Queue the record in tap.record for the client
+ *
+ * A record that does not fit is dropped as a whole so the stream stays
+ * aligned, and the next record carries UART_TAP_FLAG_DROPPED.
+ *
+ * @param in Input the payload was received on
+ * @param ts_us Timestamp of the first payload byte
+ * @param len Payload length
+ */
+static void emit_record(tap_input_t *in, int64_t ts_us, size_t len) {
+    size_t total = UART_TAP_HEADER_LEN + len;
+
+    if (xStreamBufferSpacesAvailable(tap.stream) < total) {
+        tap.dropped++;
+        tap.dropped_pending = true;
+        return;
+    }
+
+    uint8_t *h = tap.record;
+    h[0] = in->dir;
+    h[1] = in->flags | (tap.dropped_pending ? UART_TAP_FLAG_DROPPED : 0);
+    put_le(h + 2, len, 2);
+    put_le(h + 4, (uint64_t)ts_us, 8);
+
+    xStreamBufferSend(tap.stream, tap.record, total, 0);
+    in->flags = 0;
+    tap.dropped_pending = false;
+}
+
+/**
+ * @brief Turn everything buffered by an input's UART driver into records
+ *
+ * The driver hands data over in bursts, so the first byte is dated back
+ * from the time of the read by the line time of the whole burst.
+ */
+static void drain_input(tap_input_t *in) {
+    int port = in->bridge->uart_port;
+    size_t avail = 0;
+
+    if (uart_get_buffered_data_len(port, &avail) != ESP_OK || avail == 0) {
+        return;
+    }
+
+    int64_t first_us = esp_timer_get_time() - (int64_t)avail * in->symbol_ns / 1000;
+    size_t offset = 0;
+
+    while (avail > 0) {
+        size_t chunk = avail > TAP_CHUNK_MAX ? TAP_CHUNK_MAX : avail;
+        int n = uart_read_bytes(port, tap.record + UART_TAP_HEADER_LEN, chunk, 0);
+        if (n <= 0) {
+            break;
+        }
+
+        in->bridge->line_stats.rx_bytes += n;
+        emit_record(in, first_us + (int64_t)offset * in->symbol_ns / 1000, n);
+        offset += n;
+        avail -= n;
+    }
+}
+
+/**
+ * @brief Tap task: service whichever input has driver events pending
+ */
+static void tap_task(void *arg) {
+    while (1) {
+        QueueSetMemberHandle_t member = xQueueSelectFromSet(tap.set, portMAX_DELAY);
+        tap_input_t *in = (member == tap.inputs[0].bridge->uart_queue) ?
+                          &tap.inputs[0] : &tap.inputs[1];
+
+        uart_event_t event;
+        if (xQueueReceive(member, &event, 0) != pdTRUE) {
+            continue;
+        }
+
+        if (event.type != UART_DATA) {
+            uart_count_event(in->bridge, event.type);
+            if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL ||
+                event.type == UART_FRAME_ERR || event.type == UART_PARITY_ERR ||
+                event.type == UART_BREAK) {
+                in->flags |= UART_TAP_FLAG_LINE_ERROR;
+            }
+        }
+
+        // Also drain after overflow events, which stop the driver until read
+        drain_input(in);
+    }
+}
+
+esp_err_t uart_tap_init(uart_bridge_t *a, uart_bridge_t *b) {
+    if (!a || !b || !a->uart_queue || !b->uart_queue) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(&tap, 0, sizeof(tap));
+    uart_bridge_t *bridges[2] = { a, b };
+    for (int i = 0; i < 2; i++) {
+        uint32_t baud = bridges[i]->baud_rate;
+        uart_get_baudrate(bridges[i]->uart_port, &baud);
+        tap.inputs[i].bridge = bridges[i];
+        tap.inputs[i].dir = (i == 0) ? UART_TAP_DIR_A : UART_TAP_DIR_B;
+        tap.inputs[i].symbol_ns = (uint32_t)(TAP_SYMBOL_BITS * 1000000000ULL / baud);
+    }
+
+    tap.stream = xStreamBufferCreate(CONFIG_UART_TAP_BUF_SIZE, 1);
+    tap.set = xQueueCreateSet(2 * UART_EVENT_QUEUE_LEN);
+    if (!tap.stream || !tap.set) {
+        uart_tap_deinit();
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xQueueAddToSet(a->uart_queue, tap.set) != pdPASS ||
+        xQueueAddToSet(b->uart_queue, tap.set) != pdPASS) {
+        uart_tap_deinit();
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Above the main loop so timestamps don't wait for forwarding
+    if (xTaskCreate(tap_task, "uart_tap", 3072, NULL,
+                    uxTaskPriorityGet(NULL) + 1, &tap.task) != pdPASS) {
+        uart_tap_deinit();
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Tapping UART%d (dir %d) and UART%d (dir %d), served on port %d",
+             a->uart_port, UART_TAP_DIR_A, b->uart_port, UART_TAP_DIR_B, a->tcp_port);
+    return ESP_OK;
+}
+
+void uart_tap_deinit(void) {
+    if (tap.task) {
+        vTaskDelete(tap.task);
+    }
+    if (tap.set) {
+        // Queues must be empty to leave the set
+        for (int i = 0; i < 2; i++) {
+            if (tap.inputs[i].bridge && tap.inputs[i].bridge->uart_queue) {
+                xQueueReset(tap.inputs[i].bridge->uart_queue);
+                xQueueRemoveFromSet(tap.inputs[i].bridge->uart_queue, tap.set);
+            }
+        }
+        vQueueDelete(tap.set);
+    }
+    if (tap.stream) {
+        vStreamBufferDelete(tap.stream);
+    }
+    memset(&tap, 0, sizeof(tap));
+}
+
+bool uart_tap_is_output(const uart_bridge_t *bridge) {
+    return bridge && bridge == tap.inputs[0].bridge;
+}
+
+size_t uart_tap_read(uint8_t *buf, size_t max_len) {
+    if (!tap.stream) {
+        return 0;
+    }
+    return xStreamBufferReceive(tap.stream, buf, max_len, 0);
+}
+
+void uart_tap_reset(void) {
+    if (!tap.stream) {
+        return;
+    }
+
+    // Records become visible whole, so discarding exactly what is there
+    // now keeps the stream aligned even while the tap task keeps writing
+    uint8_t scratch[128];
+    size_t pending = xStreamBufferBytesAvailable(tap.stream);
+    while (pending > 0) {
+        size_t n = xStreamBufferReceive(tap.stream, scratch,
+                                        pending < sizeof(scratch) ? pending : sizeof(scratch), 0);
+        if (n == 0) {
+            break;
+        }
+        pending -= n;
+    }
+}
+
+uint32_t uart_tap_get_dropped(void) {
+    return tap.dropped;
+}
+
+#else /* !CONFIG_UART_TAP_MODE */
+
+esp_err_t uart_tap_init(uart_bridge_t *a, uart_bridge_t *b) {
+    ESP_LOGE(TAG, "Passive tap mode is not enabled in this build");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void uart_tap_deinit(void) {
+}
+
+bool uart_tap_is_output(const uart_bridge_t *bridge) {
+    return false;
+}
+
+size_t uart_tap_read(uint8_t *buf, size_t max_len) {
+    return 0;
+}
+
+void uart_tap_reset(void) {
+}
+
+uint32_t uart_tap_get_dropped(void) {
+    return 0;
+}
+
+#endif /* CONFIG_UART_TAP_MODE */
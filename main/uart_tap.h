@@ -0,0 +1,93 @@
+/**
+ * @file uart_tap.h
+ * @brief Passive tap of an existing serial link
+ *
+ * Two bridges' RX inputs monitor the two directions of a serial link
+ * without driving it. Everything received is merged into a single stream
+ * of records, in arrival order, for one TCP client.
+ *
+ * Record format (all fields little-endian):
+ *
+ *   offset  size  field
+ *   0       1     direction (UART_TAP_DIR_*)
+ *   1       1     flags (UART_TAP_FLAG_*)
+ *   2       2     payload length in bytes
+ *   4       8     timestamp of the first payload byte, in microseconds
+ *                 since boot
+ *   12      len   payload
+ *
+ * Timestamps are derived from when the UART driver delivered the data,
+ * minus the line time of the bytes, so their resolution is bounded by the
+ * bridge's RX timeout and FIFO full threshold.
+ */
+
+#pragma once
+
+#include "uart_manager.h"
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/** Size of a record header */
+#define UART_TAP_HEADER_LEN 12
+
+/** Data received on the first tap input (UART1) */
+#define UART_TAP_DIR_A 0
+/** Data received on the second tap input (UART2) */
+#define UART_TAP_DIR_B 1
+
+/** Records were dropped before this one because the client fell behind */
+#define UART_TAP_FLAG_DROPPED     0x01
+/** A line error (overflow, framing, parity, break) preceded this data */
+#define UART_TAP_FLAG_LINE_ERROR  0x02
+
+/**
+ * @brief Start tapping two bridges
+ *
+ * The bridges must have their UART drivers installed and must not be
+ * serviced by the main loop's event polling.
+ *
+ * @param a Bridge receiving direction A
+ * @param b Bridge receiving direction B
+ * @return ESP_OK on success, error code otherwise
+ */
+esp_err_t uart_tap_init(uart_bridge_t *a, uart_bridge_t *b);
+
+/**
+ * @brief Stop tapping and free all resources
+ */
+void uart_tap_deinit(void);
+
+/**
+ * @brief Check whether a bridge's TCP port serves the tap stream
+ *
+ * @param bridge Bridge instance
+ * @return true for the first tap input, false otherwise
+ */
+bool uart_tap_is_output(const uart_bridge_t *bridge);
+
+/**
+ * @brief Read the next part of the record stream without blocking
+ *
+ * Records may be split across calls.
+ *
+ * @param buf Buffer to receive the data
+ * @param max_len Capacity of buf
+ * @return Number of bytes copied
+ */
+size_t uart_tap_read(uint8_t *buf, size_t max_len);
+
+/**
+ * @brief Discard records not yet read
+ *
+ * Called when a new client connects so it starts with live data.
+ */
+void uart_tap_reset(void);
+
+/**
+ * @brief Get the number of records dropped because the buffer was full
+ *
+ * @return Dropped record count since boot
+ */
+uint32_t uart_tap_get_dropped(void);
@@ -1,4 +1,5 @@
 #include "wifi_manager.h"
+#include "diagnostics.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
@@ -25,7 +26,11 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
     if (event_base == WIFI_EVENT) {
         if (event_id == WIFI_EVENT_STA_START) {
             ESP_LOGI(TAG, "WiFi started, connecting to AP");
+            diag_boot_begin(DIAG_BOOT_WIFI_ASSOC);
             esp_wifi_connect();
+        } else if (event_id == WIFI_EVENT_STA_CONNECTED) {
+            diag_boot_end(DIAG_BOOT_WIFI_ASSOC);
+            diag_boot_begin(DIAG_BOOT_WIFI_DHCP);
         } else if (event_id == WIFI_EVENT_STA_DISCONNECTED) {
             if (wifi_connected) {
                 wifi_connected = false;
@@ -41,6 +46,7 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
         if (event != NULL) {
             ESP_LOGI(TAG, "Connected to WiFi, IP: " IPSTR, IP2STR(&event->ip_info.ip));
             wifi_connected = true;
+            diag_boot_end(DIAG_BOOT_WIFI_DHCP);
         }
     }
 }
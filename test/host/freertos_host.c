@@ -0,0 +1,155 @@
+/*
+ * freertos_host.c
+ *
+ * The few FreeRTOS calls the firmware under test makes, on pthreads.
+ * Tasks are detached threads; a task's notification value is a counter
+ * guarded by one global lock. "FromISR" variants are plain calls.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct host_task {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    uint32_t notify;
+};
+
+struct host_queue {
+    size_t len;
+    size_t item_size;
+    size_t head;
+    size_t count;
+    uint8_t items[];
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t notified = PTHREAD_COND_INITIALIZER;
+static __thread struct host_task *current;
+
+/* ----------------- Tasks ----------------- */
+
+static void *task_main(void *arg) {
+    struct host_task *task = arg;
+    current = task;
+    task->fn(task->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                       UBaseType_t prio, TaskHandle_t *ret) {
+    struct host_task *task = calloc(1, sizeof(*task));
+    if (!task) {
+        return pdFALSE;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    if (pthread_create(&task->thread, NULL, task_main, task) != 0) {
+        free(task);
+        return pdFALSE;
+    }
+    *ret = task;
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    // The task only ever waits in ulTaskNotifyTake(), a cancellation point
+    pthread_cancel(task->thread);
+    pthread_join(task->thread, NULL);
+    free(task);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    struct timespec ts = { .tv_sec = ticks / 1000, .tv_nsec = (ticks % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+    return 1;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return current;
+}
+
+/* ----------------- Task notifications ----------------- */
+
+static void unlock_on_cancel(void *arg) {
+    pthread_mutex_unlock(&lock);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+    pthread_mutex_lock(&lock);
+    pthread_cleanup_push(unlock_on_cancel, NULL);
+    while (current->notify == 0) {
+        pthread_cond_wait(&notified, &lock);
+    }
+    pthread_cleanup_pop(0);
+    uint32_t value = current->notify;
+    current->notify = clear ? 0 : value - 1;
+    pthread_mutex_unlock(&lock);
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    pthread_mutex_lock(&lock);
+    task->notify++;
+    pthread_cond_broadcast(&notified);
+    pthread_mutex_unlock(&lock);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken) {
+    xTaskNotifyGive(task);
+}
+
+/* ----------------- Queues ----------------- */
+
+QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t item_size) {
+    struct host_queue *q = calloc(1, sizeof(*q) + (size_t)len * item_size);
+    if (q) {
+        q->len = len;
+        q->item_size = item_size;
+    }
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t q) {
+    free(q);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks) {
+    pthread_mutex_lock(&lock);
+    BaseType_t ok = q->count > 0;
+    if (ok) {
+        memcpy(item, q->items + q->head * q->item_size, q->item_size);
+        q->head = (q->head + 1) % q->len;
+        q->count--;
+    }
+    pthread_mutex_unlock(&lock);
+    return ok;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item, BaseType_t *woken) {
+    pthread_mutex_lock(&lock);
+    BaseType_t ok = q->count < q->len;
+    if (ok) {
+        memcpy(q->items + (q->head + q->count) % q->len * q->item_size, item, q->item_size);
+        q->count++;
+    }
+    pthread_mutex_unlock(&lock);
+    return ok;
+}
+
+UBaseType_t uxQueueMessagesWaitingFromISR(QueueHandle_t q) {
+    pthread_mutex_lock(&lock);
+    UBaseType_t count = q->count;
+    pthread_mutex_unlock(&lock);
+    return count;
+}
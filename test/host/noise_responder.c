@@ -0,0 +1,114 @@
+/*
+ * noise_responder.c
+ *
+ * Host harness for the Noise channel: runs main/noise_server.c on a
+ * loopback socket and echoes whatever each client sends, so
+ * test_noise_interop.py can drive it with tools/noise_client.py.
+ *
+ * Usage: noise_responder <uart> <connections>
+ *
+ * Reads noise.key and noise_clients.txt from the working directory,
+ * prints "port <n>" once listening, serves <connections> clients one
+ * after the other as UART<uart> and exits with 0 if noise_server_init()
+ * succeeded.
+ */
+
+#include "noise_server.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * @brief Listen on an ephemeral loopback port
+ *
+ * @return Listening socket, or -1 on error
+ */
+static int listen_loopback(int *port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t len = sizeof(addr);
+    if (sock < 0 || bind(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(sock, 4) != 0 || getsockname(sock, (struct sockaddr *)&addr, &len) != 0) {
+        perror("listen");
+        return -1;
+    }
+    *port = ntohs(addr.sin_port);
+    return sock;
+}
+
+/**
+ * @brief Echo decrypted data back until the client leaves or errs
+ *
+ * Reads don't block, so the socket is polled between them as the
+ * bridge's main loop would come back to it on its next pass.
+ */
+static void echo(noise_session_t *session) {
+    uint8_t buf[4096];
+    while (1) {
+        int n = noise_session_read(session, buf, sizeof(buf));
+        if (n == -EAGAIN) {
+            struct pollfd pfd = { .fd = noise_session_get_sockfd(session), .events = POLLIN };
+            poll(&pfd, 1, -1);
+            continue;
+        }
+        if (n <= 0) {
+            fprintf(stderr, "session ended: %d\n", n);
+            return;
+        }
+        if (noise_session_write(session, buf, n) != n) {
+            fprintf(stderr, "write failed\n");
+            return;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <uart> <connections>\n", argv[0]);
+        return 2;
+    }
+    int uart = atoi(argv[1]);
+    int connections = atoi(argv[2]);
+
+    if (noise_server_init() != ESP_OK) {
+        return 1;
+    }
+    int port;
+    int listener = listen_loopback(&port);
+    if (listener < 0) {
+        return 1;
+    }
+    printf("port %d\n", port);
+    fflush(stdout);
+
+    for (int i = 0; i < connections; i++) {
+        int sock = accept(listener, NULL, NULL);
+        if (sock < 0) {
+            perror("accept");
+            return 1;
+        }
+        noise_session_t *session = noise_server_accept(sock, uart);
+        if (!session) {
+            close(sock);
+            continue;
+        }
+        echo(session);
+        noise_session_close(session);
+    }
+
+    noise_stats_t st;
+    noise_server_get_stats(&st);
+    fprintf(stderr, "handshakes %u, failed %u, open %d\n",
+            (unsigned)st.handshakes, (unsigned)st.failed, st.open);
+    close(listener);
+    noise_server_deinit();
+    return st.open == 0 ? 0 : 1;
+}
@@ -0,0 +1,20 @@
+/* Host stand-in for ESP-IDF's esp_heap_caps.h */
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MALLOC_CAP_DMA      (1 << 3)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+static inline void *heap_caps_aligned_calloc(size_t alignment, size_t n, size_t size, int caps) {
+    void *p = aligned_alloc(alignment, (n * size + alignment - 1) / alignment * alignment);
+    if (p) {
+        memset(p, 0, n * size);
+    }
+    return p;
+}
+
+static inline void heap_caps_free(void *p) {
+    free(p);
+}
@@ -0,0 +1,5 @@
+/* Host stand-in for ESP-IDF's esp_idf_version.h: new enough for DMA mode */
+#pragma once
+
+#define ESP_IDF_VERSION_VAL(major, minor, patch) (((major) << 16) | ((minor) << 8) | (patch))
+#define ESP_IDF_VERSION ESP_IDF_VERSION_VAL(5, 5, 0)
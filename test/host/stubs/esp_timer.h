@@ -0,0 +1,13 @@
+/* Host stand-in for ESP-IDF's esp_timer.h */
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+typedef struct esp_timer *esp_timer_handle_t;
+
+static inline int64_t esp_timer_get_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,12 @@
+/* Host stand-in for lwIP's BSD socket API */
+#pragma once
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+static inline char *inet_ntoa_r(struct in_addr addr, char *buf, int len) {
+    return (char *)inet_ntop(AF_INET, &addr, buf, len);
+}
@@ -0,0 +1,15 @@
+/* Configuration for the host tests (see test/host/CMakeLists.txt) */
+#pragma once
+
+// CONFIG_NOISE_ENABLE is set only for the targets that build the Noise channel
+#define CONFIG_NOISE_KEY_PATH "noise.key"            // Relative to the test's working directory
+#define CONFIG_NOISE_CLIENTS_PATH "noise_clients.txt"
+#define CONFIG_NOISE_MAX_CLIENTS 8
+#define CONFIG_NOISE_MAX_MESSAGE 1024
+#define CONFIG_HANDSHAKE_TIMEOUT_MS 3000
+
+#define CONFIG_AVAILABLE_BRIDGE_UARTS 2
+#define CONFIG_UART_BUF_SIZE 4096
+#define CONFIG_UART_READ_TIMEOUT_MS 20
+#define CONFIG_UART_DMA_BUF_SIZE 1024
+#define CONFIG_UART_DMA_BUF_COUNT 3
@@ -0,0 +1,4 @@
+/* Host stand-in for ESP-IDF's soc/soc_caps.h: a chip with UHCI */
+#pragma once
+
+#define SOC_UHCI_SUPPORTED 1
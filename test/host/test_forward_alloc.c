@@ -0,0 +1,332 @@
+/*
+ * test_forward_alloc.c
+ *
+ * Host test for the allocation-free forwarding path: a plain TCP bridge
+ * runs main/tcp_server.c and main/transport.c over a loopback socket
+ * while data flows both ways, and any heap allocation made during a
+ * forwarding pass after the warm-up fails the test.
+ *
+ * This is the host counterpart of CONFIG_DIAG_ALLOC_CHECK. The same
+ * diag_alloc_*() marks the firmware places around each forwarding pass
+ * arm the check here. malloc, calloc and realloc are wrapped at link
+ * time (--wrap), so only calls from the firmware sources are counted.
+ * The UART side is faked by a byte queue in each direction.
+ */
+
+#include "tcp_server.h"
+#include "uart_manager.h"
+#include "rfc2217.h"
+#include "uart_tap.h"
+#include "admission.h"
+#include "diagnostics.h"
+#include "sdkconfig.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Forwarding passes after a client connects before allocations count */
+#define WARMUP_PASSES 10
+
+/** Forwarding passes checked with data flowing */
+#define STEADY_PASSES 200
+
+static int failures;
+
+#define CHECK(cond)                                                    \
+    do {                                                               \
+        if (!(cond)) {                                                 \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__,     \
+                    __LINE__, #cond);                                  \
+            failures++;                                                \
+        }                                                              \
+    } while (0)
+
+/* ----------------- Counting allocator ----------------- */
+
+static struct {
+    bool in_pass;        // Inside diag_alloc_region_begin()/end()
+    int passes;          // Passes since the last warm-up reset
+    int total;           // Allocations by the firmware since start
+    int steady;          // Allocations in a pass after warm-up
+} allocs;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+
+static void count_alloc(size_t size) {
+    allocs.total++;
+    if (allocs.in_pass && allocs.passes > WARMUP_PASSES) {
+        allocs.steady++;
+        fprintf(stderr, "allocation of %zu bytes in forwarding pass %d\n", size, allocs.passes);
+    }
+}
+
+void *__wrap_malloc(size_t size) {
+    count_alloc(size);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    count_alloc(n * size);
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t size) {
+    count_alloc(size);
+    return __real_realloc(p, size);
+}
+
+void diag_alloc_warmup_reset(void) {
+    allocs.passes = 0;
+}
+
+void diag_alloc_region_begin(int uart_port) {
+    allocs.in_pass = true;
+    allocs.passes++;
+}
+
+void diag_alloc_region_end(void) {
+    allocs.in_pass = false;
+}
+
+void diag_op_begin(int uart_port, diag_op_t op) {
+}
+
+void diag_op_end(void) {
+}
+
+/* ----------------- Fake UART ----------------- */
+
+static uart_bridge_t bridges[CONFIG_AVAILABLE_BRIDGE_UARTS];
+static uint8_t uart_buf[CONFIG_UART_BUF_SIZE];
+static uint8_t tcp_buf[CONFIG_UART_BUF_SIZE];
+
+static struct {
+    uint8_t rx[1 << 16];     // Sent by the target, read by the bridge
+    size_t rx_len;
+    size_t rx_off;
+    uint8_t tx[1 << 16];     // Written to the target by the bridge
+    size_t tx_len;
+    size_t tx_room;          // What uart_tx_room() reports
+} target;
+
+uart_bridge_t *uart_manager_get_instances(void) {
+    return bridges;
+}
+
+int uart_manager_get_active_count(void) {
+    return 1;
+}
+
+esp_err_t uart_manager_get_config(int bridge_idx, uart_bridge_config_t *cfg) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t uart_manager_check_config(int bridge_idx, const uart_bridge_config_t *cfg) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t uart_manager_set_config(int bridge_idx, const uart_bridge_config_t *cfg) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void uart_poll_events(uart_bridge_t *bridge) {
+}
+
+void uart_flow_update(uart_bridge_t *bridge) {
+}
+
+void uart_clear_xoff(uart_bridge_t *bridge) {
+}
+
+size_t uart_tx_room(uart_bridge_t *bridge) {
+    size_t left = sizeof(target.tx) - target.tx_len;
+    return target.tx_room < left ? target.tx_room : left;
+}
+
+int uart_write_data(uart_bridge_t *bridge, const uint8_t *data, size_t len) {
+    memcpy(target.tx + target.tx_len, data, len);
+    target.tx_len += len;
+    return (int)len;
+}
+
+esp_err_t uart_get_available_bytes(uart_bridge_t *bridge, size_t *available) {
+    *available = target.rx_len - target.rx_off;
+    return ESP_OK;
+}
+
+int uart_read_data(uart_bridge_t *bridge, uint8_t *buffer, size_t max_len, uint32_t timeout_ms) {
+    size_t n = target.rx_len - target.rx_off;
+    if (n > max_len) {
+        n = max_len;
+    }
+    memcpy(buffer, target.rx + target.rx_off, n);
+    target.rx_off += n;
+    return (int)n;
+}
+
+size_t uart_peek_rx(uart_bridge_t *bridge, const uint8_t **data) {
+    return 0;
+}
+
+void uart_release_rx(uart_bridge_t *bridge, size_t len) {
+}
+
+/* ----------------- Other collaborators ----------------- */
+
+void rfc2217_begin(uart_bridge_t *bridge) {
+}
+
+void rfc2217_end(uart_bridge_t *bridge) {
+}
+
+int rfc2217_process(uart_bridge_t *bridge, uint8_t *buf, int len, rfc2217_send_fn send) {
+    return len;
+}
+
+int rfc2217_escape(uart_bridge_t *bridge, uint8_t *buf, int len) {
+    return len;
+}
+
+bool rfc2217_is_suspended(uart_bridge_t *bridge) {
+    return false;
+}
+
+bool uart_tap_is_output(const uart_bridge_t *bridge) {
+    return false;
+}
+
+size_t uart_tap_read(uint8_t *buf, size_t max_len) {
+    return 0;
+}
+
+void uart_tap_reset(void) {
+}
+
+bool admission_check(uint32_t addr) {
+    return true;
+}
+
+/* ----------------- Test ----------------- */
+
+static void sleep_ms(int ms) {
+    nanosleep(&(struct timespec){ .tv_nsec = ms * 1000000L }, NULL);
+}
+
+/**
+ * @brief Connect a client to the bridge's listening socket
+ *
+ * @return Client socket, or -1 on error
+ */
+static int connect_client(const uart_bridge_t *bridge) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    if (getsockname(bridge->server_sock, (struct sockaddr *)&addr, &len) != 0) {
+        return -1;
+    }
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock >= 0 && connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/**
+ * @brief Receive whatever the bridge has sent so far, without blocking
+ */
+static size_t drain_client(int sock, uint8_t *buf, size_t have, size_t size) {
+    int n;
+    while (have < size && (n = recv(sock, buf + have, size - have, MSG_DONTWAIT)) > 0) {
+        have += n;
+    }
+    return have;
+}
+
+int main(void) {
+    for (int i = 0; i < CONFIG_AVAILABLE_BRIDGE_UARTS; i++) {
+        bridges[i].server_sock = -1;
+    }
+    bridges[0] = (uart_bridge_t){
+        .uart_port = 1,
+        .tcp_port = 0,           // Any free port
+        .enabled = true,
+        .uart_buf = uart_buf,
+        .tcp_buf = tcp_buf,
+        .server_sock = -1,
+    };
+    uart_bridge_t *bridge = &bridges[0];
+
+    if (tcp_server_init(NULL) != ESP_OK) {
+        fprintf(stderr, "tcp_server_init() failed\n");
+        return 1;
+    }
+
+    int client = connect_client(bridge);
+    CHECK(client >= 0);
+    for (int i = 0; i < 100 && !bridge->conn; i++) {
+        tcp_handle_new_connections();
+        sleep_ms(1);
+    }
+    CHECK(bridge->conn != NULL);
+    // Accepting allocates the connection, which shows the wrappers work
+    CHECK(allocs.total > 0);
+
+    // Data both ways, with the target now and then taking little or nothing
+    static uint8_t sent[1 << 16], got[1 << 16];
+    size_t sent_len = 0, got_len = 0;
+    for (int pass = 0; pass < STEADY_PASSES; pass++) {
+        int n = snprintf((char *)sent + sent_len, sizeof(sent) - sent_len, "client %d\r\n", pass);
+        CHECK(send(client, sent + sent_len, n, 0) == n);
+        sent_len += n;
+
+        n = snprintf((char *)target.rx + target.rx_len, sizeof(target.rx) - target.rx_len,
+                     "target line %d\r\n", pass);
+        target.rx_len += n;
+
+        target.tx_room = pass % 5 == 0 ? 0 : pass % 5 == 1 ? 7 : CONFIG_UART_BUF_SIZE;
+        tcp_process_data();
+        got_len = drain_client(client, got, got_len, sizeof(got));
+    }
+
+    // Let the rest through
+    target.tx_room = CONFIG_UART_BUF_SIZE;
+    for (int i = 0; i < 100 && (target.tx_len < sent_len || got_len < target.rx_len); i++) {
+        tcp_process_data();
+        sleep_ms(1);
+        got_len = drain_client(client, got, got_len, sizeof(got));
+    }
+
+    int passes = allocs.passes;
+    CHECK(passes > WARMUP_PASSES + STEADY_PASSES / 2);
+    CHECK(allocs.steady == 0);
+    CHECK(target.tx_len == sent_len && memcmp(target.tx, sent, sent_len) == 0);
+    CHECK(got_len == target.rx_len && memcmp(got, target.rx, got_len) == 0);
+
+    // A client leaving with data still waiting for it is cleaned up
+    target.rx_len += snprintf((char *)target.rx + target.rx_len,
+                              sizeof(target.rx) - target.rx_len, "unsent");
+    close(client);
+    for (int i = 0; i < 100 && bridge->conn; i++) {
+        tcp_process_data();
+        sleep_ms(1);
+    }
+    CHECK(bridge->conn == NULL);
+
+    tcp_cleanup();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ok, %d forwarding passes, none allocating after warm-up\n", passes);
+    return 0;
+}
@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""Drive the bridge's Noise responder with tools/noise_client.py.
+
+Usage: test_noise_interop.py <path to noise_responder>
+
+Runs main/noise_server.c (built for the host as noise_responder) against
+the initiator in tools/noise_client.py: handshake and echo, messages
+split at the bridge's message limit, a message arriving in pieces, and
+the cases the bridge must refuse. Exits with 77 (skipped) if the
+"cryptography" package is missing.
+"""
+
+import os
+import socket
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "..", "tools"))
+try:
+    import noise_client as nc
+    from cryptography.hazmat.primitives import serialization
+    from cryptography.hazmat.primitives.asymmetric.x25519 import X25519PrivateKey
+except ImportError as e:
+    print(f"skipped: {e}")
+    sys.exit(77)
+
+UART = 1
+MAX_MESSAGE = 1024  # CONFIG_NOISE_MAX_MESSAGE in stubs/sdkconfig.h
+
+
+def private_hex(key):
+    return key.private_bytes(serialization.Encoding.Raw, serialization.PrivateFormat.Raw,
+                             serialization.NoEncryption()).hex()
+
+
+def connect(port, key, server_pub):
+    sock = socket.create_connection(("127.0.0.1", port), timeout=10)
+    return sock, nc.NoiseChannel(sock, key, server_pub, MAX_MESSAGE)
+
+
+def recv_exactly(channel, n):
+    data = b""
+    while len(data) < n:
+        chunk = channel.recv()
+        if not chunk:
+            break
+        data += chunk
+    return data
+
+
+def expect_refused(port, key, server_pub, what):
+    sock = socket.create_connection(("127.0.0.1", port), timeout=10)
+    try:
+        nc.NoiseChannel(sock, key, server_pub)
+    except (ConnectionError, ValueError):
+        return
+    finally:
+        sock.close()
+    raise AssertionError(f"{what}: handshake completed")
+
+
+def main():
+    bridge = X25519PrivateKey.generate()
+    client = X25519PrivateKey.generate()
+    elsewhere = X25519PrivateKey.generate()   # only allowed on another UART
+    stranger = X25519PrivateKey.generate()    # not listed at all
+
+    with tempfile.TemporaryDirectory() as tmp:
+        with open(os.path.join(tmp, "noise.key"), "w") as f:
+            f.write("# bridge key\n" + private_hex(bridge) + "\n")
+        with open(os.path.join(tmp, "noise_clients.txt"), "w") as f:
+            f.write(f"client {nc.raw_public(client).hex()}\n")
+            f.write(f"elsewhere {nc.raw_public(elsewhere).hex()} {UART + 1}\n")
+
+        responder = subprocess.Popen([sys.argv[1], str(UART), "6"], cwd=tmp,
+                                     stdout=subprocess.PIPE, text=True)
+        try:
+            port = int(responder.stdout.readline().split()[1])
+            server_pub = nc.raw_public(bridge)
+
+            # Handshake, then echo of a short message
+            sock, channel = connect(port, client, server_pub)
+            channel.send(b"hello")
+            assert recv_exactly(channel, 5) == b"hello", "short echo"
+            sock.close()
+
+            # Data over the bridge's limit comes back split into messages
+            payload = bytes(range(256)) * 20
+            sock, channel = connect(port, client, server_pub)
+            channel.send(payload)
+            got = b""
+            messages = 0
+            while len(got) < len(payload):
+                chunk = channel.recv()
+                assert chunk and len(chunk) <= MAX_MESSAGE, "message size"
+                got += chunk
+                messages += 1
+            assert got == payload, "long echo"
+            assert messages >= len(payload) // MAX_MESSAGE, "split"
+            sock.close()
+
+            # A message that arrives in pieces is put back together
+            sock, channel = connect(port, client, server_pub)
+            ciphertext = channel.tx.encrypt(b"", b"in pieces")
+            frame = struct.pack(">H", len(ciphertext)) + ciphertext
+            for piece in (frame[:1], frame[1:7], frame[7:]):
+                sock.sendall(piece)
+                time.sleep(0.05)
+            assert recv_exactly(channel, 9) == b"in pieces", "split message"
+            sock.close()
+
+            expect_refused(port, stranger, server_pub, "unknown client key")
+            expect_refused(port, elsewhere, server_pub, "client key for another UART")
+
+            # A forged message ends the session
+            sock, channel = connect(port, client, server_pub)
+            nc.send_message(sock, b"\0" * 32)
+            assert channel.recv() == b"", "forged message accepted"
+            sock.close()
+
+            assert responder.wait(timeout=10) == 0, "responder exit status"
+        finally:
+            if responder.poll() is None:
+                responder.kill()
+    print("ok")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,264 @@
+/*
+ * test_uart_dma.c
+ *
+ * Host test for the DMA receive hand-off in main/uart_dma.c: chunks are
+ * peeked in place, sent (possibly in part) and released, and buffers go
+ * back to the pool only once their last chunk is released.
+ *
+ * The UHCI controller is faked here: the test fills the armed buffer and
+ * raises the RX events itself, from its own thread, while the firmware's
+ * RX task re-arms buffers on another thread as it would on target.
+ */
+
+#include "uart_dma.h"
+#include "driver/uhci.h"
+#include "sdkconfig.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CHUNK_QUEUE_LEN (CONFIG_UART_DMA_BUF_COUNT * 8)  // As in uart_dma.c
+
+static int failures;
+
+#define CHECK(cond)                                                    \
+    do {                                                               \
+        if (!(cond)) {                                                 \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__,     \
+                    __LINE__, #cond);                                  \
+            failures++;                                                \
+        }                                                              \
+    } while (0)
+
+/* ----------------- Fake UHCI controller ----------------- */
+
+struct uhci_controller {
+    pthread_mutex_t lock;
+    uhci_event_callbacks_t cbs;
+    void *user_ctx;
+    uint8_t *armed;      // Buffer of the receive in progress, NULL if none
+    size_t fill;         // Bytes already delivered from it
+    int arm_count;       // uhci_receive() calls so far
+};
+
+static struct uhci_controller fake = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+esp_err_t uhci_new_controller(const uhci_controller_config_t *config, uhci_controller_handle_t *ret) {
+    fake.armed = NULL;
+    fake.fill = 0;
+    fake.arm_count = 0;
+    *ret = &fake;
+    return ESP_OK;
+}
+
+esp_err_t uhci_del_controller(uhci_controller_handle_t uhci) {
+    return ESP_OK;
+}
+
+esp_err_t uhci_register_event_callbacks(uhci_controller_handle_t uhci,
+                                        const uhci_event_callbacks_t *cbs, void *user_data) {
+    uhci->cbs = *cbs;
+    uhci->user_ctx = user_data;
+    return ESP_OK;
+}
+
+esp_err_t uhci_receive(uhci_controller_handle_t uhci, uint8_t *buf, size_t size) {
+    pthread_mutex_lock(&uhci->lock);
+    uhci->armed = buf;
+    uhci->fill = 0;
+    uhci->arm_count++;
+    pthread_mutex_unlock(&uhci->lock);
+    return ESP_OK;
+}
+
+esp_err_t uhci_transmit(uhci_controller_handle_t uhci, uint8_t *buf, size_t size) {
+    return ESP_OK;
+}
+
+/**
+ * @brief Wait until the RX task has armed a receive n times in total
+ *
+ * @return Buffer armed last, or NULL on timeout
+ */
+static uint8_t *wait_armed(int n) {
+    for (int i = 0; i < 1000; i++) {
+        pthread_mutex_lock(&fake.lock);
+        uint8_t *armed = fake.arm_count >= n ? fake.armed : NULL;
+        pthread_mutex_unlock(&fake.lock);
+        if (armed) {
+            return armed;
+        }
+        nanosleep(&(struct timespec){ .tv_nsec = 1000000 }, NULL);
+    }
+    return NULL;
+}
+
+static int arm_count(void) {
+    pthread_mutex_lock(&fake.lock);
+    int n = fake.arm_count;
+    pthread_mutex_unlock(&fake.lock);
+    return n;
+}
+
+/**
+ * @brief Receive data into the armed buffer and raise the RX event
+ *
+ * @param data Bytes "received" on the line
+ * @param len Number of bytes
+ * @param last The receive transaction ends with this chunk
+ * @return Where the chunk landed in the DMA buffer
+ */
+static uint8_t *rx(const char *data, size_t len, bool last) {
+    pthread_mutex_lock(&fake.lock);
+    uint8_t *at = fake.armed + fake.fill;
+    memcpy(at, data, len);
+    fake.fill += len;
+    if (last) {
+        fake.armed = NULL;
+    }
+    pthread_mutex_unlock(&fake.lock);
+
+    uhci_rx_event_data_t ev = { .data = at, .recv_size = len };
+    ev.flags.totally_received = last;
+    fake.cbs.on_rx_trans_event(&fake, &ev, fake.user_ctx);
+    return at;
+}
+
+/**
+ * @brief Stand-in for the TCP send: takes at most limit bytes
+ */
+static size_t send_some(char *sink, size_t *sunk, const uint8_t *data, size_t len, size_t limit) {
+    size_t n = len < limit ? len : limit;
+    memcpy(sink + *sunk, data, n);
+    *sunk += n;
+    return n;
+}
+
+/* ----------------- Tests ----------------- */
+
+/**
+ * @brief Chunks are handed out in place and may be sent in several parts
+ */
+static void test_peek_send_release(void) {
+    uart_dma_ctx_t *ctx;
+    CHECK(uart_dma_init(1, &ctx) == ESP_OK);
+    uint8_t *buf0 = wait_armed(1);
+    CHECK(buf0 != NULL);
+
+    uint8_t *hello = rx("hello", 5, false);
+    rx(" world", 6, true);
+
+    char sink[32];
+    size_t sunk = 0;
+    const uint8_t *data;
+
+    // Peeking twice gives the same chunk, straight from the DMA buffer
+    CHECK(uart_dma_peek(ctx, &data) == 5 && data == hello);
+    CHECK(uart_dma_peek(ctx, &data) == 5 && data == hello);
+
+    // Partial send: only what was sent is released
+    size_t n = send_some(sink, &sunk, data, 5, 2);
+    uart_dma_release(ctx, n);
+    CHECK(uart_dma_peek(ctx, &data) == 3 && data == hello + 2);
+    uart_dma_release(ctx, send_some(sink, &sunk, data, 3, 64));
+
+    // The last chunk of the transaction, then nothing
+    size_t len = uart_dma_peek(ctx, &data);
+    CHECK(len == 6);
+    uart_dma_release(ctx, send_some(sink, &sunk, data, len, 64));
+    CHECK(uart_dma_peek(ctx, &data) == 0);
+    CHECK(sunk == 11 && memcmp(sink, "hello world", 11) == 0);
+
+    // The next buffer was armed as soon as the transaction ended
+    uint8_t *buf1 = wait_armed(2);
+    CHECK(buf1 != NULL && buf1 != buf0);
+
+    // An empty transaction (idle line) is skipped
+    rx("", 0, true);
+    CHECK(uart_dma_peek(ctx, &data) == 0);
+    CHECK(uart_dma_get_dropped(ctx) == 0);
+
+    uart_dma_deinit(ctx);
+}
+
+/**
+ * @brief With every buffer holding unsent data, nothing is re-armed
+ */
+static void test_pool_exhaustion(void) {
+    uart_dma_ctx_t *ctx;
+    CHECK(uart_dma_init(1, &ctx) == ESP_OK);
+
+    uint8_t *bufs[CONFIG_UART_DMA_BUF_COUNT];
+    for (int i = 0; i < CONFIG_UART_DMA_BUF_COUNT; i++) {
+        bufs[i] = wait_armed(i + 1);
+        CHECK(bufs[i] != NULL);
+        char c = 'a' + i;
+        rx(&c, 1, true);
+    }
+
+    // The RX task has been woken but has no free buffer to arm
+    nanosleep(&(struct timespec){ .tv_nsec = 20000000 }, NULL);
+    CHECK(arm_count() == CONFIG_UART_DMA_BUF_COUNT);
+
+    // Sending the first buffer's data frees it for the receiver again
+    const uint8_t *data;
+    CHECK(uart_dma_peek(ctx, &data) == 1 && data == bufs[0] && data[0] == 'a');
+    uart_dma_release(ctx, 1);
+    CHECK(wait_armed(CONFIG_UART_DMA_BUF_COUNT + 1) == bufs[0]);
+
+    for (int i = 1; i < CONFIG_UART_DMA_BUF_COUNT; i++) {
+        CHECK(uart_dma_peek(ctx, &data) == 1 && data == bufs[i] && data[0] == 'a' + i);
+        uart_dma_release(ctx, 1);
+    }
+    CHECK(uart_dma_peek(ctx, &data) == 0);
+
+    uart_dma_deinit(ctx);
+}
+
+/**
+ * @brief A full chunk queue drops data but never the end of a buffer
+ */
+static void test_queue_full(void) {
+    uart_dma_ctx_t *ctx;
+    CHECK(uart_dma_init(1, &ctx) == ESP_OK);
+    uint8_t *buf0 = wait_armed(1);
+    CHECK(buf0 != NULL);
+
+    int queued = CHUNK_QUEUE_LEN - CONFIG_UART_DMA_BUF_COUNT;
+    for (int i = 0; i < queued + 5; i++) {
+        rx("x", 1, false);
+    }
+    CHECK(uart_dma_get_dropped(ctx) == 5);
+
+    // The final chunk still gets through, so buffer 0 stays in use until
+    // everything queued from it has been sent
+    rx("z", 1, true);
+    CHECK(uart_dma_get_dropped(ctx) == 5);
+    CHECK(wait_armed(2) != buf0);
+
+    const uint8_t *data;
+    for (int i = 0; i < queued; i++) {
+        CHECK(uart_dma_peek(ctx, &data) == 1 && data == buf0 + i);
+        uart_dma_release(ctx, 1);
+    }
+    CHECK(uart_dma_peek(ctx, &data) == 1 && data[0] == 'z');
+    uart_dma_release(ctx, 1);
+    CHECK(uart_dma_peek(ctx, &data) == 0);
+
+    uart_dma_deinit(ctx);
+}
+
+int main(void) {
+    test_peek_send_release();
+    test_pool_exhaustion();
+    test_queue_full();
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
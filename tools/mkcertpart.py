@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Build the TLS credentials partition image for CONFIG_TLS_CERT_SOURCE_PARTITION.
+
+Takes the server certificate (chain), its private key and optionally the
+client CA, in PEM or DER, and writes a partition image holding them as
+DER so the firmware can parse them in place from memory-mapped flash.
+With --pins, the pinned client fingerprints (CONFIG_TLS_CLIENT_VERIFY_PINNED)
+are stored as well, as text.
+
+    python3 tools/mkcertpart.py --cert certs/server.crt --key certs/server.key \\
+        --ca certs/ca.crt -o certs.bin
+    parttool.py write_partition --partition-name certs --input certs.bin
+
+Layout (little-endian): magic "SCTC", version u16, count u16, then count
+items of type u8, 3 reserved bytes, offset u32, length u32, then the DER
+blobs, each 4-byte aligned. Item types: 1 server certificate (leaf
+first), 2 server key, 3 client CA certificate, 4 client pins.
+
+Encrypted private keys are not supported.
+"""
+
+import argparse
+import base64
+import re
+import struct
+import sys
+
+MAGIC = b"SCTC"
+VERSION = 1
+HEADER = struct.Struct("<4sHH")
+ITEM = struct.Struct("<B3xII")
+
+ITEM_SERVER_CERT = 1
+ITEM_SERVER_KEY = 2
+ITEM_CA_CERT = 3
+ITEM_CLIENT_PINS = 4
+
+PEM_BLOCK = re.compile(rb"-----BEGIN ([A-Z0-9 ]+)-----(.*?)-----END \1-----", re.S)
+PIN = re.compile(r"^(?:[0-9a-fA-F]{2}:?){31}[0-9a-fA-F]{2}$")
+
+
+def read_der(path, what):
+    """Return the DER blobs in a PEM or DER file, in file order."""
+    with open(path, "rb") as f:
+        data = f.read()
+    blocks = PEM_BLOCK.findall(data)
+    if not blocks:
+        return [data]
+    ders = []
+    for label, body in blocks:
+        if b"ENCRYPTED" in label or b"Proc-Type: 4,ENCRYPTED" in body:
+            sys.exit(f"{path}: encrypted {what} is not supported")
+        if label == b"EC PARAMETERS":
+            continue
+        ders.append(base64.b64decode(b"".join(body.split())))
+    return ders
+
+
+def read_pins(path):
+    """Check a fingerprint list and return it as text for the firmware."""
+    with open(path) as f:
+        lines = f.read().splitlines()
+    count = 0
+    for n, line in enumerate(lines, 1):
+        fields = line.split()
+        if not fields or fields[0].startswith("#"):
+            continue
+        if not PIN.match(fields[0]):
+            sys.exit(f"{path}:{n}: not a SHA-256 fingerprint")
+        count += 1
+    if not count:
+        sys.exit(f"{path}: no fingerprints")
+    return ("\n".join(lines) + "\n").encode()
+
+
+def build(items, size):
+    table_len = HEADER.size + ITEM.size * len(items)
+    offset = (table_len + 3) & ~3
+    table = HEADER.pack(MAGIC, VERSION, len(items))
+    blobs = b""
+    for item_type, der in items:
+        table += ITEM.pack(item_type, offset + len(blobs), len(der))
+        blobs += der + b"\0" * (-len(der) % 4)
+    image = table + b"\0" * (offset - table_len) + blobs
+    if size:
+        if len(image) > size:
+            sys.exit(f"credentials take {len(image)} bytes, partition has {size}")
+        image += b"\xff" * (size - len(image))
+    return image
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--cert", required=True, help="server certificate or chain")
+    parser.add_argument("--key", required=True, help="server private key")
+    parser.add_argument("--ca", help="CA certificate(s) for client verification")
+    parser.add_argument("--pins", help="pinned client fingerprints, one per line")
+    parser.add_argument("--size", type=lambda v: int(v, 0), default=0,
+                        help="pad the image to the partition size (e.g. 0x4000)")
+    parser.add_argument("-o", "--output", required=True)
+    args = parser.parse_args()
+
+    items = [(ITEM_SERVER_CERT, der) for der in read_der(args.cert, "certificate")]
+    keys = read_der(args.key, "key")
+    if len(keys) != 1:
+        sys.exit(f"{args.key}: expected exactly one private key")
+    items.append((ITEM_SERVER_KEY, keys[0]))
+    if args.ca:
+        items += [(ITEM_CA_CERT, der) for der in read_der(args.ca, "certificate")]
+    if args.pins:
+        items.append((ITEM_CLIENT_PINS, read_pins(args.pins)))
+
+    image = build(items, args.size)
+    with open(args.output, "wb") as f:
+        f.write(image)
+    print(f"{args.output}: {len(items)} items, {len(image)} bytes")
+
+
+if __name__ == "__main__":
+    main()
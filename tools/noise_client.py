@@ -0,0 +1,303 @@
+#!/usr/bin/env python3
+"""Connect to a bridge port over the Noise channel (CONFIG_NOISE_ENABLE).
+
+Speaks Noise_IK_25519_AESGCM_SHA256 with the framing described in
+main/noise_server.h. Needs the "cryptography" package.
+
+Generate a key pair for a client (or for the bridge), then list the
+client's public key in the bridge's client file and give the client the
+bridge's public key (also logged at boot):
+
+    python3 tools/noise_client.py genkey -o laptop.key
+    python3 tools/noise_client.py connect 192.168.1.50 6969 \\
+        --key laptop.key --server-key 3f1c...e2
+
+bench measures connect latency like tools/tls_ttfb.py, in the same
+format, so the two channels can be compared on the same bridge:
+
+    python3 tools/noise_client.py bench 192.168.1.50 6969 \\
+        --key laptop.key --server-key 3f1c...e2 --count 20 --probe '\\r'
+"""
+
+import argparse
+import hashlib
+import hmac
+import os
+import socket
+import statistics
+import struct
+import sys
+import threading
+import time
+
+from cryptography.hazmat.primitives import serialization
+from cryptography.hazmat.primitives.asymmetric.x25519 import X25519PrivateKey, X25519PublicKey
+from cryptography.hazmat.primitives.ciphers.aead import AESGCM
+
+PROTOCOL_NAME = b"Noise_IK_25519_AESGCM_SHA256"
+KEY_LEN = 32
+TAG_LEN = 16
+MAX_MESSAGE = 1024  # default CONFIG_NOISE_MAX_MESSAGE; the bridge drops longer messages
+
+
+def raw_public(key):
+    return key.public_key().public_bytes(serialization.Encoding.Raw,
+                                         serialization.PublicFormat.Raw)
+
+
+def read_private(path):
+    with open(path) as f:
+        for line in f:
+            fields = line.split()
+            if fields and not fields[0].startswith("#"):
+                return X25519PrivateKey.from_private_bytes(bytes.fromhex(fields[0]))
+    sys.exit(f"{path}: no key")
+
+
+def dh(private, public):
+    return private.exchange(X25519PublicKey.from_public_bytes(public))
+
+
+def nonce(n):
+    return b"\0" * 4 + struct.pack(">Q", n)
+
+
+class CipherState:
+    def __init__(self, key):
+        self.aead = AESGCM(key)
+        self.n = 0
+
+    def encrypt(self, ad, plaintext):
+        out = self.aead.encrypt(nonce(self.n), plaintext, ad)
+        self.n += 1
+        return out
+
+    def decrypt(self, ad, ciphertext):
+        out = self.aead.decrypt(nonce(self.n), ciphertext, ad)
+        self.n += 1
+        return out
+
+
+class SymmetricState:
+    def __init__(self):
+        self.h = PROTOCOL_NAME.ljust(32, b"\0")
+        self.ck = self.h
+        self.cipher = None
+
+    def mix_hash(self, data):
+        self.h = hashlib.sha256(self.h + data).digest()
+
+    def hkdf(self, ikm):
+        temp = hmac.digest(self.ck, ikm, "sha256")
+        out1 = hmac.digest(temp, b"\x01", "sha256")
+        out2 = hmac.digest(temp, out1 + b"\x02", "sha256")
+        return out1, out2
+
+    def mix_key(self, ikm):
+        self.ck, key = self.hkdf(ikm)
+        self.cipher = CipherState(key)
+
+    def encrypt_and_hash(self, plaintext):
+        ciphertext = self.cipher.encrypt(self.h, plaintext)
+        self.mix_hash(ciphertext)
+        return ciphertext
+
+    def decrypt_and_hash(self, ciphertext):
+        plaintext = self.cipher.decrypt(self.h, ciphertext)
+        self.mix_hash(ciphertext)
+        return plaintext
+
+    def split(self):
+        k1, k2 = self.hkdf(b"")
+        return CipherState(k1), CipherState(k2)
+
+
+def recv_exact(sock, n):
+    buf = b""
+    while len(buf) < n:
+        chunk = sock.recv(n - len(buf))
+        if not chunk:
+            raise ConnectionError("connection closed")
+        buf += chunk
+    return buf
+
+
+def recv_message(sock):
+    (length,) = struct.unpack(">H", recv_exact(sock, 2))
+    return recv_exact(sock, length)
+
+
+def send_message(sock, data):
+    sock.sendall(struct.pack(">H", len(data)) + data)
+
+
+class NoiseChannel:
+    """Initiator side of the IK handshake, then framed transport messages."""
+
+    def __init__(self, sock, static_key, server_pub, max_message=MAX_MESSAGE):
+        self.sock = sock
+        self.max_message = max_message
+        ss = SymmetricState()
+        ss.mix_hash(b"")              # empty prologue
+        ss.mix_hash(server_pub)       # <- s
+
+        # -> e, es, s, ss
+        e = X25519PrivateKey.generate()
+        e_pub = raw_public(e)
+        ss.mix_hash(e_pub)
+        ss.mix_key(dh(e, server_pub))
+        msg = e_pub + ss.encrypt_and_hash(raw_public(static_key))
+        ss.mix_key(dh(static_key, server_pub))
+        msg += ss.encrypt_and_hash(b"")
+        send_message(sock, msg)
+
+        # <- e, ee, se
+        reply = recv_message(sock)
+        if len(reply) != KEY_LEN + TAG_LEN:
+            raise ConnectionError("bad handshake reply")
+        re = reply[:KEY_LEN]
+        ss.mix_hash(re)
+        ss.mix_key(dh(e, re))
+        ss.mix_key(dh(static_key, re))
+        ss.decrypt_and_hash(reply[KEY_LEN:])
+        self.tx, self.rx = ss.split()
+
+    def send(self, data):
+        for i in range(0, len(data), self.max_message):
+            send_message(self.sock, self.tx.encrypt(b"", data[i:i + self.max_message]))
+
+    def recv(self):
+        """Return the next message's data, or b"" once the bridge has closed."""
+        try:
+            return self.rx.decrypt(b"", recv_message(self.sock))
+        except ConnectionError:
+            return b""
+
+
+def cmd_genkey(args):
+    key = X25519PrivateKey.generate()
+    private = key.private_bytes(serialization.Encoding.Raw, serialization.PrivateFormat.Raw,
+                                serialization.NoEncryption()).hex()
+    if args.output:
+        fd = os.open(args.output, os.O_WRONLY | os.O_CREAT | os.O_EXCL, 0o600)
+        with os.fdopen(fd, "w") as f:
+            f.write(private + "\n")
+    else:
+        print(f"private {private}")
+    print(f"public  {raw_public(key).hex()}")
+
+
+def cmd_pubkey(args):
+    print(raw_public(read_private(args.key)).hex())
+
+
+def open_channel(args):
+    sock = socket.create_connection((args.host, args.port), timeout=args.timeout)
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    return sock, NoiseChannel(sock, args.static_key, args.server_pub, args.max_message)
+
+
+def cmd_connect(args):
+    sock, channel = open_channel(args)
+    sock.settimeout(None)
+
+    def to_stdout():
+        while True:
+            data = channel.recv()
+            if not data:
+                break
+            sys.stdout.buffer.write(data)
+            sys.stdout.buffer.flush()
+        os._exit(0)
+
+    threading.Thread(target=to_stdout, daemon=True).start()
+    while True:
+        data = sys.stdin.buffer.read1(4096)
+        if not data:
+            break
+        channel.send(data)
+    sock.close()
+
+
+def connect_once(args):
+    t0 = time.perf_counter()
+    sock = socket.create_connection((args.host, args.port), timeout=args.timeout)
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    t_tcp = time.perf_counter()
+    channel = NoiseChannel(sock, args.static_key, args.server_pub, args.max_message)
+    t_hs = time.perf_counter()
+    t_first = t_hs
+    if args.probe:
+        channel.send(args.probe)
+        channel.recv()
+        t_first = time.perf_counter()
+    sock.close()
+    return {"tcp": t_tcp - t0, "handshake": t_hs - t_tcp, "ttfb": t_first - t0}
+
+
+def summarize(label, samples):
+    if not samples:
+        print(f"{label:<22} no samples")
+        return
+    line = f"{label:<22} n={len(samples):<3}"
+    for key in ("tcp", "handshake", "ttfb"):
+        values = sorted(s[key] * 1000 for s in samples)
+        p95 = values[min(len(values) - 1, int(len(values) * 0.95))]
+        line += f"  {key} {statistics.median(values):7.1f}/{p95:7.1f} ms"
+    print(line)
+
+
+def cmd_bench(args):
+    print("median/p95 per phase; ttfb runs from TCP connect to first usable byte")
+    samples = []
+    try:
+        for _ in range(args.count):
+            samples.append(connect_once(args))
+            time.sleep(args.pause)
+    except (OSError, ValueError) as e:
+        print(f"Noise: {e}", file=sys.stderr)
+    summarize("Noise IK", samples)
+    print(f"per-message overhead {2 + TAG_LEN} B")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("genkey", help="generate an X25519 key pair")
+    p.add_argument("-o", "--output", help="write the private key to this file")
+    p.set_defaults(func=cmd_genkey)
+
+    p = sub.add_parser("pubkey", help="print the public key of a private key file")
+    p.add_argument("key")
+    p.set_defaults(func=cmd_pubkey)
+
+    for name, func, help_text in (("connect", cmd_connect, "bridge stdin/stdout to a port"),
+                                  ("bench", cmd_bench, "measure connect latency")):
+        p = sub.add_parser(name, help=help_text)
+        p.add_argument("host")
+        p.add_argument("port", type=int)
+        p.add_argument("--key", required=True, help="client private key file")
+        p.add_argument("--server-key", required=True, help="bridge public key (hex)")
+        p.add_argument("--timeout", type=float, default=10.0)
+        p.add_argument("--max-message", type=int, default=MAX_MESSAGE,
+                       help="the bridge's CONFIG_NOISE_MAX_MESSAGE (default %(default)s)")
+        p.set_defaults(func=func)
+    p.add_argument("--count", type=int, default=10, help="connections")
+    p.add_argument("--probe", help="bytes to send; TTFB waits for the reply")
+    p.add_argument("--pause", type=float, default=0.2,
+                   help="seconds between connections, so the bridge sees the close")
+
+    args = parser.parse_args()
+    if args.command in ("connect", "bench"):
+        args.static_key = read_private(args.key)
+        args.server_pub = bytes.fromhex(args.server_key)
+        if len(args.server_pub) != KEY_LEN:
+            sys.exit("--server-key must be 32 bytes of hex")
+    if getattr(args, "probe", None):
+        args.probe = args.probe.encode().decode("unicode_escape").encode("latin-1")
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""Decode the passive tap record stream from the bridge.
+
+Connects to the tap port (UART1's TCP port with CONFIG_UART_TAP_MODE) and
+prints each record as a timestamped, direction-tagged hex/ASCII dump.
+
+    python3 tools/tap_decode.py 192.168.1.50 6969
+    python3 tools/tap_decode.py 192.168.1.50 6969 --raw capture.bin
+
+Record header (little-endian): direction u8, flags u8, length u16,
+timestamp_us u64, followed by length payload bytes.
+"""
+
+import argparse
+import socket
+import struct
+import sys
+
+HEADER = struct.Struct("<BBHQ")
+DIRECTIONS = {0: "A>", 1: "B>"}
+FLAG_DROPPED = 0x01
+FLAG_LINE_ERROR = 0x02
+
+
+def records(sock, raw_out=None):
+    buf = b""
+    while True:
+        data = sock.recv(65536)
+        if not data:
+            return
+        if raw_out:
+            raw_out.write(data)
+        buf += data
+        while len(buf) >= HEADER.size:
+            direction, flags, length, ts_us = HEADER.unpack_from(buf)
+            if len(buf) < HEADER.size + length:
+                break
+            payload = buf[HEADER.size:HEADER.size + length]
+            buf = buf[HEADER.size + length:]
+            yield direction, flags, ts_us, payload
+
+
+def printable(payload):
+    return "".join(chr(b) if 32 <= b < 127 else "." for b in payload)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host")
+    parser.add_argument("port", type=int)
+    parser.add_argument("--raw", metavar="FILE", help="also save the raw record stream")
+    args = parser.parse_args()
+
+    raw_out = open(args.raw, "wb") if args.raw else None
+    with socket.create_connection((args.host, args.port)) as sock:
+        for direction, flags, ts_us, payload in records(sock, raw_out):
+            notes = []
+            if flags & FLAG_DROPPED:
+                notes.append("records dropped before this one")
+            if flags & FLAG_LINE_ERROR:
+                notes.append("line error")
+            if notes:
+                print("-- " + ", ".join(notes))
+            print("%12.6f %s %s  %s" % (ts_us / 1e6, DIRECTIONS.get(direction, "?>"),
+                                         payload.hex(" "), printable(payload)))
+            sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""Measure TLS connect latency to a bridge port for TLS 1.2 and TLS 1.3.
+
+Opens repeated connections and reports, per protocol version, the TCP
+connect time, the handshake time and the time to first byte: from the
+start of the TCP connect until the serial data is usable. With --probe,
+the probe bytes are sent and the first byte is the target's reply (for
+example a shell prompt after "\\r"). Without --probe, the handshake end
+counts as the first byte. Each version is measured with full handshakes
+and with resumed sessions.
+
+    python3 tools/tls_ttfb.py 192.168.1.50 6969 --count 20
+    python3 tools/tls_ttfb.py esp32.lan 6969 --probe '\\r' \\
+        --cafile ca.crt --cert client.crt --key client.key
+"""
+
+import argparse
+import socket
+import ssl
+import statistics
+import sys
+import time
+
+VERSIONS = {
+    "1.2": ssl.TLSVersion.TLSv1_2,
+    "1.3": ssl.TLSVersion.TLSv1_3,
+}
+
+
+def make_context(args, version):
+    ctx = ssl.SSLContext(ssl.PROTOCOL_TLS_CLIENT)
+    ctx.minimum_version = version
+    ctx.maximum_version = version
+    if args.cafile:
+        ctx.load_verify_locations(args.cafile)
+    else:
+        ctx.check_hostname = False
+        ctx.verify_mode = ssl.CERT_NONE
+    if args.cert:
+        ctx.load_cert_chain(args.cert, args.key)
+    return ctx
+
+
+def pick_up_tickets(tls):
+    """TLS 1.3 tickets arrive after the handshake; read briefly to get them."""
+    tls.settimeout(0.05)
+    try:
+        tls.recv(4096)
+    except (socket.timeout, ssl.SSLWantReadError):
+        pass
+    tls.settimeout(None)
+
+
+def connect_once(args, ctx, session):
+    t0 = time.perf_counter()
+    sock = socket.create_connection((args.host, args.port), timeout=args.timeout)
+    t_tcp = time.perf_counter()
+    tls = ctx.wrap_socket(sock, server_hostname=args.host, session=session)
+    t_hs = time.perf_counter()
+    t_first = t_hs
+    if args.probe:
+        tls.sendall(args.probe)
+        tls.recv(1)
+        t_first = time.perf_counter()
+    pick_up_tickets(tls)
+    result = {
+        "tcp": t_tcp - t0,
+        "handshake": t_hs - t_tcp,
+        "ttfb": t_first - t0,
+        "resumed": tls.session_reused,
+        "session": tls.session,
+    }
+    tls.close()
+    return result
+
+
+def summarize(label, samples):
+    if not samples:
+        print(f"{label:<22} no samples")
+        return
+    line = f"{label:<22} n={len(samples):<3}"
+    for key in ("tcp", "handshake", "ttfb"):
+        values = sorted(s[key] * 1000 for s in samples)
+        p95 = values[min(len(values) - 1, int(len(values) * 0.95))]
+        line += f"  {key} {statistics.median(values):7.1f}/{p95:7.1f} ms"
+    print(line)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host")
+    parser.add_argument("port", type=int)
+    parser.add_argument("--count", type=int, default=10, help="connections per case")
+    parser.add_argument("--versions", default="1.2,1.3", help="comma-separated list")
+    parser.add_argument("--probe", help="bytes to send; TTFB waits for the reply")
+    parser.add_argument("--cafile", help="verify the server against this CA")
+    parser.add_argument("--cert", help="client certificate for mTLS")
+    parser.add_argument("--key", help="client key for mTLS")
+    parser.add_argument("--timeout", type=float, default=10.0)
+    parser.add_argument("--pause", type=float, default=0.2,
+                        help="seconds between connections, so the bridge sees the close")
+    args = parser.parse_args()
+    if args.probe:
+        args.probe = args.probe.encode().decode("unicode_escape").encode("latin-1")
+
+    print("median/p95 per phase; ttfb runs from TCP connect to first usable byte")
+    for name in args.versions.split(","):
+        ctx = make_context(args, VERSIONS[name.strip()])
+        full, resumed = [], []
+        session = None
+        try:
+            for _ in range(args.count):
+                full.append(connect_once(args, ctx, None))
+                time.sleep(args.pause)
+            session = full[-1]["session"]
+            for _ in range(args.count):
+                r = connect_once(args, ctx, session)
+                (resumed if r["resumed"] else full).append(r)
+                session = r["session"] or session
+                time.sleep(args.pause)
+        except (OSError, ssl.SSLError) as e:
+            print(f"TLS {name}: {e}", file=sys.stderr)
+        summarize(f"TLS {name} full", full)
+        summarize(f"TLS {name} resumed", resumed)
+
+
+if __name__ == "__main__":
+    main()